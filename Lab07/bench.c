@@ -0,0 +1,677 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file bench.c
+/// @version 1.0
+///
+/// netsim_bench: benchmarks of the simulator, from a link to a file
+/// transfer across a whole network. Each result is one row:
+///
+///     link_rtt        pipe     payload bytes   us per packet_send/recv round trip
+///     dns_insert      db       shards          names registered per second
+///     dns_lookup      db       shards          names looked up per second
+///     switch_forward  star     fan-out         packets a switch delivers per second
+///     ping_rtt        <net>    0               ms per ping between two hosts
+///     dns_register    <net>    0               registers per second through a server
+///     dns_lookup      <net>    0               lookups per second through a server
+///     goodput         <net>    file bytes      file bytes per second of a download, timed by the receiver
+///
+/// The switch runs alone for switch_forward, with the bench holding the
+/// other end of all its links. The networks are p2p.config and
+/// ring.config and a star generated with a switch, 4 hosts and a DNS
+/// server; their rows come from a script run by man_script.c, in a
+/// directory of their own under /tmp.
+///
+/// Rows go out as CSV or JSON, and may be compared with the rows of an
+/// earlier run: a row more than the tolerance worse than its baseline
+/// counts as a regression and the bench exits with 1.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <ftw.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+#include "main.h"
+#include "net.h"
+#include "host.h"
+#include "switch.h"
+#include "server.h"
+#include "packet.h"
+#include "man_script.h"
+#include "dns_db.h"
+#include "clock.h"
+
+#define BENCH_MAX_ROWS      128
+#define BENCH_MAX_NODES     80
+#define BENCH_TOLERANCE     10.0        /* Percent a row may be worse than its baseline */
+#define BENCH_RTT_RUNS      20000
+#define BENCH_DNS_NAMES     200000
+#define BENCH_FORWARD_MS    1000        /* Time switch_forward is measured at each fan-out */
+#define BENCH_FORWARD_LOSS_MS 500       /* A packet not delivered by then was dropped, its window slot is freed */
+#define BENCH_FORWARD_RING  1024        /* Send times of the packets in flight, by sequence number */
+#define BENCH_SETTLE_MS     1500        /* Time a network is left to build its tree before the script */
+#define BENCH_STAR_HOSTS    4
+#define BENCH_SERVER_ID     100
+
+struct bench_row {
+    char bench[32];
+    char topology[32];
+    int param;
+    double value;
+    char unit[16];
+};
+
+struct bench {
+    struct bench_row row[BENCH_MAX_ROWS];
+    int num_rows;
+    bool quick;                 // Fewer runs and smaller files
+};
+
+// The script lines of a network run, to tell its result rows apart
+struct net_run {
+    const char *topology;
+    const char *config;         // NULL for the generated star
+    int src, dst;
+    bool has_server;
+    int ping_line;
+    int register_line;
+    int lookup_line;
+    int download_line;          // Of the first size, one line per size
+    int num_sizes;
+};
+
+static const char *program_name;
+static const int g_fanouts[] = {2, 4, 8, 16, 32, 64};
+static const int g_sizes[] = {10000, 60000};   // Smaller files take about one pass of the hosts' loops
+
+static void usage(void) {
+    fprintf(stderr, "Usage: %s [-o results file] [-f csv|json] [-b baseline file] [-t tolerance %%] [-q]\n",
+            program_name);
+    exit(EXIT_FAILURE);
+}
+
+// Lower is better for times, higher for rates
+static bool lower_is_better(const char *unit) {
+    return strcmp(unit, "us") == 0 || strcmp(unit, "ms") == 0;
+}
+
+static void add_row(struct bench *b, const char *bench, const char *topology, int param, double value,
+                    const char *unit) {
+    struct bench_row *r;
+
+    if (b->num_rows == BENCH_MAX_ROWS) return;
+    r = &b->row[b->num_rows++];
+    snprintf(r->bench, sizeof(r->bench), "%s", bench);
+    snprintf(r->topology, sizeof(r->topology), "%s", topology);
+    r->param = param;
+    r->value = value;
+    snprintf(r->unit, sizeof(r->unit), "%s", unit);
+    fprintf(stderr, "%-16s %-8s %6d  %14.3f %s\n", bench, topology, param, value, unit);
+}
+
+/* ============================ Rows in files ============================ */
+
+static void write_rows(struct bench *b, FILE *out, enum script_format format) {
+    struct bench_row *r;
+    int k;
+
+    if (format == SCRIPT_CSV) fprintf(out, "bench,topology,param,value,unit\n");
+    else fprintf(out, "[");
+    for (k = 0; k < b->num_rows; k++) {
+        r = &b->row[k];
+        if (format == SCRIPT_CSV) {
+            fprintf(out, "%s,%s,%d,%.3f,%s\n", r->bench, r->topology, r->param, r->value, r->unit);
+        } else {
+            fprintf(out, "%s\n  {\"bench\": \"%s\", \"topology\": \"%s\", \"param\": %d, \"value\": %.3f, "
+                         "\"unit\": \"%s\"}", k == 0 ? "" : ",", r->bench, r->topology, r->param, r->value, r->unit);
+        }
+    }
+    if (format == SCRIPT_JSON) fprintf(out, "\n]\n");
+}
+
+// Rows of an earlier run, in either format
+static int read_rows(FILE *fp, struct bench_row *rows, int max) {
+    char line[256];
+    struct bench_row *r;
+    int n = 0;
+
+    while (n < max && fgets(line, sizeof(line), fp) != NULL) {
+        r = &rows[n];
+        if (sscanf(line, " {\"bench\": \"%31[^\"]\", \"topology\": \"%31[^\"]\", \"param\": %d, \"value\": %lf, "
+                         "\"unit\": \"%15[^\"]\"", r->bench, r->topology, &r->param, &r->value, r->unit) == 5
+            || sscanf(line, "%31[^,],%31[^,],%d,%lf,%15[^,\r\n]", r->bench, r->topology, &r->param, &r->value,
+                      r->unit) == 5) {
+            n++;
+        }
+    }
+    return n;
+}
+
+// Print each row against its baseline, returns the number of regressions
+static int compare_rows(struct bench *b, struct bench_row *base, int num_base, double tolerance) {
+    struct bench_row *r, *old;
+    double change;
+    bool worse;
+    int regressions = 0;
+    int k, i;
+
+    fprintf(stderr, "\nAgainst the baseline, tolerance %.1f%%:\n", tolerance);
+    for (k = 0; k < b->num_rows; k++) {
+        r = &b->row[k];
+        old = NULL;
+        for (i = 0; i < num_base && old == NULL; i++) {
+            if (strcmp(base[i].bench, r->bench) == 0 && strcmp(base[i].topology, r->topology) == 0
+                && base[i].param == r->param) {
+                old = &base[i];
+            }
+        }
+        if (old == NULL || old->value == 0) {
+            fprintf(stderr, "%-16s %-8s %6d  no baseline\n", r->bench, r->topology, r->param);
+            continue;
+        }
+        change = (r->value - old->value) / old->value * 100;
+        worse = lower_is_better(r->unit) ? change > tolerance : change < -tolerance;
+        if (worse) regressions++;
+        fprintf(stderr, "%-16s %-8s %6d  %14.3f vs %14.3f %s  %+7.1f%%%s\n", r->bench, r->topology, r->param,
+                r->value, old->value, r->unit, change, worse ? "  REGRESSED" : "");
+    }
+    return regressions;
+}
+
+/* ================================ Link ================================ */
+
+static void *echo_main(void *arg) {
+    struct net_port *port = (struct net_port *) arg;
+    struct packet p;
+
+    while (packet_recv(port, &p) > 0) packet_send(port, &p);
+    return NULL;
+}
+
+// Round trips of one packet over a pair of blocking pipes, a thread echoing it back
+static void bench_link(struct bench *b, int payload) {
+    struct net_port a, e;
+    struct packet p, q;
+    int fd_ae[2], fd_ea[2];
+    pthread_t thread;
+    uint64_t start;
+    int runs = b->quick ? BENCH_RTT_RUNS / 10 : BENCH_RTT_RUNS;
+    int k;
+
+    if (pipe(fd_ae) < 0 || pipe(fd_ea) < 0) return;
+    memset(&a, 0, sizeof(a));
+    memset(&e, 0, sizeof(e));
+    a.type = e.type = PIPE;
+    a.pipe_send_fd = fd_ae[1];
+    e.pipe_recv_fd = fd_ae[0];
+    e.pipe_send_fd = fd_ea[1];
+    a.pipe_recv_fd = fd_ea[0];
+    if (pthread_create(&thread, NULL, echo_main, &e) != 0) return;
+
+    memset(&p, 0, sizeof(p));
+    p.type = (char) PKT_PING_REQ;
+    p.length = payload;
+    start = clock_us();
+    for (k = 0; k < runs; k++) {
+        packet_send(&a, &p);
+        if (packet_recv(&a, &q) <= 0) break;
+    }
+    add_row(b, "link_rtt", "pipe", payload, (double) (clock_us() - start) / k, "us");
+
+    close(fd_ae[1]);        // The echo thread reads the end of the pipe and returns
+    pthread_join(thread, NULL);
+    close(fd_ae[0]);
+    close(fd_ea[0]);
+    close(fd_ea[1]);
+}
+
+/* ============================= Name table ============================= */
+
+static void bench_dns_db(struct bench *b, int shards) {
+    struct dns_db db;
+    char name[32];
+    uint64_t start;
+    int names = b->quick ? BENCH_DNS_NAMES / 10 : BENCH_DNS_NAMES;
+    int found = 0;
+    int k, len;
+
+    dns_db_init(&db, shards);
+    start = clock_us();
+    for (k = 0; k < names; k++) {
+        len = snprintf(name, sizeof(name), "h%d.rack%d.dc", k, k % 16);
+        dns_db_insert(&db, name, len, k % 100, 0);
+    }
+    add_row(b, "dns_insert", "db", shards, names * 1e6 / (double) (clock_us() - start + 1), "ops/s");
+
+    start = clock_us();
+    for (k = 0; k < names; k++) {
+        len = snprintf(name, sizeof(name), "h%d.rack%d.dc", (k * 7919) % names, ((k * 7919) % names) % 16);
+        if (dns_db_lookup(&db, name, len) >= 0) found++;
+    }
+    add_row(b, "dns_lookup", "db", shards, names * 1e6 / (double) (clock_us() - start + 1), "ops/s");
+    if (found != names) fprintf(stderr, "dns_lookup: found %d of %d names\n", found, names);
+}
+
+/* ============================== Networks ============================== */
+
+// A directory of its own for a run, the nodes write their files in it
+static bool enter_run_dir(char *dir, int size) {
+    snprintf(dir, size, "/tmp/netsim_bench.XXXXXX");
+    return mkdtemp(dir) != NULL && chdir(dir) == 0;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void) st;
+    (void) flag;
+    (void) ftw;
+    return remove(path);
+}
+
+static void remove_run_dir(const char *dir) {
+    if (chdir("/") == 0) nftw(dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// Start every node of the network, returns how many were started
+static int start_nodes(pid_t *pids, int max, bool switches_only) {
+    struct net_node *p_node;
+    pid_t pid;
+    int n = 0;
+
+    for (p_node = net_get_node_list(); p_node != NULL && n < max; p_node = p_node->next) {
+        if (switches_only && p_node->type != SWITCH) continue;
+        pid = fork();
+        if (pid < 0) break;
+        if (pid == 0) {
+            if (p_node->type == HOST) host_main(p_node->id);
+            else if (p_node->type == SWITCH) switch_main(p_node->id);
+            else server_main(p_node->id);
+        }
+        pids[n++] = pid;
+    }
+    return n;
+}
+
+static void stop_nodes(pid_t *pids, int n) {
+    int k;
+
+    for (k = 0; k < n; k++) kill(pids[k], SIGKILL);
+    for (k = 0; k < n; k++) waitpid(pids[k], NULL, 0);
+}
+
+// Run fn in a process of its own, so each network starts from a fresh net_init()
+static void run_apart(struct bench *b, void (*fn)(struct bench *, void *), void *arg) {
+    struct bench_row rows[BENCH_MAX_ROWS];
+    FILE *tmp;
+    pid_t pid;
+    int n, k;
+
+    tmp = tmpfile();    // Rows of the runner
+    if (tmp == NULL) return;
+    fflush(NULL);
+    pid = fork();
+    if (pid == 0) {
+        b->num_rows = 0;
+        fn(b, arg);
+        write_rows(b, tmp, SCRIPT_CSV);
+        fflush(tmp);
+        _exit(0);
+    }
+    if (pid > 0) waitpid(pid, NULL, 0);
+
+    // Take the rows back, they are printed already
+    rewind(tmp);
+    n = read_rows(tmp, rows, BENCH_MAX_ROWS);
+    for (k = 0; k < n && b->num_rows < BENCH_MAX_ROWS; k++) b->row[b->num_rows++] = rows[k];
+    fclose(tmp);
+}
+
+static bool write_star(const char *path, int hosts, bool server) {
+    FILE *fp = fopen(path, "w");
+    int k;
+
+    if (fp == NULL) return false;
+    fprintf(fp, "%d\n", hosts + 1 + (server ? 1 : 0));
+    for (k = 0; k < hosts; k++) fprintf(fp, "H %d\n", k);
+    fprintf(fp, "S %d\n", hosts);
+    if (server) fprintf(fp, "D %d\n", BENCH_SERVER_ID);
+    fprintf(fp, "%d\n", hosts + (server ? 1 : 0));
+    for (k = 0; k < hosts; k++) fprintf(fp, "P %d %d\n", k, hosts);
+    if (server) fprintf(fp, "P %d %d\n", BENCH_SERVER_ID, hosts);
+    return fclose(fp) == 0;
+}
+
+// Packets the switch of a star delivers while the bench keeps a window of them in flight.
+// Each carries a sequence number; one not delivered in BENCH_FORWARD_LOSS_MS counts as
+// dropped and leaves the window, so losses do not stop the sending.
+static void forward_run(struct bench *b, void *arg) {
+    int fanout = *(const int *) arg;
+    struct net_port *port[64];
+    static uint64_t sent_us[BENCH_FORWARD_RING];   // 0 once delivered or given up on
+    struct packet p;
+    char dir[64];
+    pid_t pid;
+    uint64_t start, until, now;
+    uint32_t seq = 0, oldest = 0, got;
+    long delivered = 0;
+    int in_flight = 0;
+    int window = SWITCH_QUEUE_MAX / 2;
+    int ms = b->quick ? BENCH_FORWARD_MS / 2 : BENCH_FORWARD_MS;
+    int src = 0;
+    int k;
+
+    if (!enter_run_dir(dir, sizeof(dir))) return;
+    if (!write_star("star.config", fanout, false)) {
+        remove_run_dir(dir);
+        return;
+    }
+    net_init("star.config");
+    if (start_nodes(&pid, 1, true) != 1) {
+        remove_run_dir(dir);
+        return;
+    }
+    for (k = 0; k < fanout; k++) port[k] = net_get_port_list(k);
+
+    // Each host sends once, so the switch learns where all of them are
+    memset(&p, 0, sizeof(p));
+    p.type = (char) PKT_PING_REQ;
+    p.length = PAYLOAD_MAX;
+    for (k = 0; k < fanout; k++) {
+        p.src = (char) k;
+        p.dst = (char) ((k + 1) % fanout);
+        packet_send(port[k], &p);
+        usleep(TENMILLISEC);
+    }
+    usleep(fanout * 2 * TENMILLISEC);
+    for (k = 0; k < fanout; k++) while (packet_recv(port[k], &p) > 0);
+
+    memset(sent_us, 0, sizeof(sent_us));
+    start = clock_us();
+    until = start + (uint64_t) ms * 1000;
+    while ((now = clock_us()) < until) {
+        // Give up on the oldest packets, in the order they were sent
+        for (; oldest != seq; oldest++) {
+            if (sent_us[oldest % BENCH_FORWARD_RING] == 0) continue;
+            if (now - sent_us[oldest % BENCH_FORWARD_RING] < (uint64_t) BENCH_FORWARD_LOSS_MS * 1000) break;
+            sent_us[oldest % BENCH_FORWARD_RING] = 0;
+            in_flight--;
+        }
+        while (in_flight < window && seq - oldest < BENCH_FORWARD_RING) {
+            p.type = (char) PKT_PING_REQ;
+            p.length = PAYLOAD_MAX;
+            p.src = (char) src;
+            p.dst = (char) ((src + 1) % fanout);
+            memcpy(p.payload, &seq, sizeof(seq));
+            packet_send(port[src], &p);
+            sent_us[seq % BENCH_FORWARD_RING] = now;
+            seq++;
+            in_flight++;
+            src = (src + 1) % fanout;
+        }
+        for (k = 0; k < fanout; k++) {
+            while (packet_recv(port[k], &p) > 0) {
+                if (p.type != (char) PKT_PING_REQ || p.dst != (char) k) continue;
+                delivered++;
+                memcpy(&got, p.payload, sizeof(got));
+                if (got - oldest < seq - oldest && sent_us[got % BENCH_FORWARD_RING] != 0) {
+                    sent_us[got % BENCH_FORWARD_RING] = 0;
+                    in_flight--;
+                }
+            }
+        }
+        usleep(1000);
+    }
+    add_row(b, "switch_forward", "star", fanout, delivered * 1e6 / (double) (clock_us() - start), "pkt/s");
+    stop_nodes(&pid, 1);
+    remove_run_dir(dir);
+}
+
+// A file of pseudo random bytes, so compression does not make the transfer look faster
+static bool write_file(const char *path, int size) {
+    FILE *fp = fopen(path, "w");
+    uint32_t x = 2463534242u;
+    int k;
+
+    if (fp == NULL) return false;
+    for (k = 0; k < size; k++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        fputc((int) (x & 0xff), fp);
+    }
+    return fclose(fp) == 0;
+}
+
+static bool write_script(struct bench *b, struct net_run *run) {
+    FILE *fp = fopen("bench.script", "w");
+    int repeat = b->quick ? 3 : 10;
+    int line = 0;
+    int k;
+
+    if (fp == NULL) return false;
+    fprintf(fp, "dir src on=%d\n", run->src);
+    fprintf(fp, "dir dst on=%d\n", run->dst);
+    fprintf(fp, "sleep %d\n", BENCH_SETTLE_MS);
+    fprintf(fp, "ping %d on=%d\n", run->dst, run->src);       // Teaches the switches both hosts
+    line = 4;
+    fprintf(fp, "ping %d on=%d repeat=%d\n", run->dst, run->src, repeat);
+    run->ping_line = ++line;
+    if (run->has_server) {
+        fprintf(fp, "register bench.%d on=%d\n", run->src, run->src);
+        run->register_line = ++line;
+        fprintf(fp, "lookup bench.%d on=%d repeat=%d\n", run->src, run->dst, repeat);
+        run->lookup_line = ++line;
+    }
+    run->num_sizes = b->quick ? 1 : (int) (sizeof(g_sizes) / sizeof(g_sizes[0]));
+    run->download_line = line + 1;
+    for (k = 0; k < run->num_sizes; k++) {
+        fprintf(fp, "download f%d %d on=%d\n", g_sizes[k], run->src, run->dst);
+        line++;
+    }
+    return fclose(fp) == 0;
+}
+
+// Past a quoted CSV field starting at c
+static const char *skip_quoted(const char *c) {
+    if (*c != '"') return c;
+    for (c++; *c != '\0'; c++) {
+        if (*c != '"') continue;
+        if (c[1] != '"') return c + 1;
+        c++;
+    }
+    return c;
+}
+
+// Average latency of the runs of a script line that worked, 0 if none did
+static double line_ms(const char *results, int line) {
+    const char *c;
+    char status[16];
+    double ms, sum = 0;
+    int row, n, runs = 0;
+
+    for (c = results; c != NULL && *c != '\0'; c = strchr(c, '\n')) {
+        if (*c == '\n') c++;
+        // line,host,run,"command",status,latency_ms,"reply"
+        if (sscanf(c, "%d,%*d,%*d,%n", &row, &n) != 1 || row != line || n == 0) continue;
+        if (sscanf(skip_quoted(c + n), ",%15[^,],%lf", status, &ms) == 2 && strcmp(status, "ok") == 0) {
+            sum += ms;
+            runs++;
+        }
+    }
+    return runs > 0 ? sum / runs : 0;
+}
+
+// Average of the times the receiving host gave for the downloads of a script line, 0 if none worked
+static double line_received_ms(const char *results, int line) {
+    const char *c, *in, *end;
+    char status[16];
+    double ms, sum = 0;
+    int row, n, runs = 0;
+
+    for (c = results; c != NULL && *c != '\0'; c = strchr(c, '\n')) {
+        if (*c == '\n') c++;
+        // line,host,run,"command",status,latency_ms,"Received <file>, <size> bytes in <ms> ms"
+        if (sscanf(c, "%d,%*d,%*d,%n", &row, &n) != 1 || row != line || n == 0) continue;
+        if (sscanf(skip_quoted(c + n), ",%15[^,]", status) != 1 || strcmp(status, "ok") != 0) continue;
+        in = strstr(c + n, " bytes in ");
+        end = strchr(c + n, '\n');
+        if (in != NULL && (end == NULL || in < end) && sscanf(in, " bytes in %lf", &ms) == 1 && ms > 0) {
+            sum += ms;
+            runs++;
+        }
+    }
+    return runs > 0 ? sum / runs : 0;
+}
+
+static double per_second(double ms) {
+    return ms > 0 ? 1000 / ms : 0;
+}
+
+// Ping, DNS and downloads between two hosts of a network, through the manager
+static void net_run(struct bench *b, void *arg) {
+    struct net_run *run = (struct net_run *) arg;
+    pid_t pids[BENCH_MAX_NODES];
+    char config[PATH_MAX];
+    char dir[64];
+    char path[32];
+    char *results = NULL;
+    size_t len = 0;
+    FILE *out;
+    double ms;
+    bool ok;
+    int n, k;
+
+    if (run->config != NULL && realpath(run->config, config) == NULL) {
+        fprintf(stderr, "%s: cannot find %s, run the bench from the build directory\n", program_name, run->config);
+        return;
+    }
+    if (!enter_run_dir(dir, sizeof(dir))) return;
+    if (run->config == NULL) snprintf(config, sizeof(config), "star.config");
+    ok = run->config != NULL || write_star(config, BENCH_STAR_HOSTS, true);
+    ok = ok && mkdir("src", 0755) == 0 && mkdir("dst", 0755) == 0;
+    for (k = 0; ok && k < (int) (sizeof(g_sizes) / sizeof(g_sizes[0])); k++) {
+        snprintf(path, sizeof(path), "src/f%d", g_sizes[k]);
+        ok = write_file(path, g_sizes[k]);
+    }
+    out = ok && write_script(b, run) ? open_memstream(&results, &len) : NULL;
+    if (out == NULL) {
+        fprintf(stderr, "%s: cannot set up the run on %s in %s\n", program_name, run->topology, dir);
+        remove_run_dir(dir);
+        return;
+    }
+
+    net_init(config);
+    n = start_nodes(pids, BENCH_MAX_NODES, false);
+    man_script_run(net_get_man_ports_at_man_list(), "bench.script", out, SCRIPT_CSV);
+    fclose(out);
+    stop_nodes(pids, n);
+    remove_run_dir(dir);
+
+    ms = line_ms(results, run->ping_line);
+    add_row(b, "ping_rtt", run->topology, 0, ms, "ms");
+    if (run->has_server) {
+        add_row(b, "dns_register", run->topology, 0, per_second(line_ms(results, run->register_line)), "ops/s");
+        add_row(b, "dns_lookup", run->topology, 0, per_second(line_ms(results, run->lookup_line)), "ops/s");
+    }
+    for (k = 0; k < run->num_sizes; k++) {
+        ms = line_received_ms(results, run->download_line + k);
+        add_row(b, "goodput", run->topology, g_sizes[k], ms > 0 ? g_sizes[k] * 1000 / ms : 0, "B/s");
+    }
+    free(results);
+}
+
+int main(int argc, char *argv[]) {
+    static struct bench b;
+    struct bench_row base[BENCH_MAX_ROWS];
+    struct net_run runs[] = {
+        {.topology = "p2p", .config = "p2p.config", .src = 0, .dst = 1, .has_server = false},
+        {.topology = "ring", .config = "ring.config", .src = 0, .dst = 2, .has_server = true},
+        {.topology = "star", .config = NULL, .src = 0, .dst = BENCH_STAR_HOSTS - 1, .has_server = true},
+    };
+    enum script_format format = SCRIPT_CSV;
+    const char *results = NULL;
+    const char *baseline = NULL;
+    double tolerance = BENCH_TOLERANCE;
+    int num_base = 0;
+    int regressions;
+    FILE *out = stdout;
+    FILE *fp;
+    int opt;
+    int k;
+
+    program_name = argv[0];
+    while ((opt = getopt(argc, argv, "o:f:b:t:q")) != -1) {
+        switch (opt) {
+            case 'o':
+                results = optarg;
+                break;
+            case 'f':
+                if (strcmp(optarg, "json") == 0) {
+                    format = SCRIPT_JSON;
+                } else if (strcmp(optarg, "csv") != 0) {
+                    fprintf(stderr, "%s: unknown format %s\n", program_name, optarg);
+                    usage();
+                }
+                break;
+            case 'b':
+                baseline = optarg;
+                break;
+            case 't':
+                tolerance = atof(optarg);
+                break;
+            case 'q':
+                b.quick = true;
+                break;
+            default:
+                usage();
+        }
+    }
+    if (optind < argc) usage();
+
+    // Read the baseline first, so a bad path does not cost a whole run
+    if (baseline != NULL) {
+        fp = fopen(baseline, "r");
+        if (fp == NULL) {
+            fprintf(stderr, "%s: cannot read %s\n", program_name, baseline);
+            exit(EXIT_FAILURE);
+        }
+        num_base = read_rows(fp, base, BENCH_MAX_ROWS);
+        fclose(fp);
+    }
+    if (results != NULL) {
+        out = fopen(results, "w");
+        if (out == NULL) {
+            fprintf(stderr, "%s: cannot write %s\n", program_name, results);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    bench_link(&b, 0);
+    bench_link(&b, PAYLOAD_MAX);
+    bench_dns_db(&b, 1);
+    bench_dns_db(&b, 4);
+    for (k = 0; k < (int) (sizeof(g_fanouts) / sizeof(g_fanouts[0])); k++) {
+        run_apart(&b, forward_run, (void *) &g_fanouts[k]);
+    }
+    for (k = 0; k < (int) (sizeof(runs) / sizeof(runs[0])); k++) run_apart(&b, net_run, &runs[k]);
+
+    write_rows(&b, out, format);
+    if (out != stdout) fclose(out);
+    if (baseline == NULL) return 0;
+    regressions = compare_rows(&b, base, num_base, tolerance);
+    fprintf(stderr, "%d of %d rows regressed\n", regressions, b.num_rows);
+    return regressions > 0 ? 1 : 0;
+}
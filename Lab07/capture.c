@@ -0,0 +1,203 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file capture.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "capture.h"
+#include "trace.h"
+
+#define CAPTURE_HEADER      4
+
+struct capture_slot {
+    uint64_t ns;
+    uint8_t len;                    // Of data
+    uint8_t port;
+    char data[PAYLOAD_MAX + 4 + TRACE_BYTES];
+};
+
+struct capture {
+    atomic_uint head __attribute__((aligned(64)));  // Next slot to write out, moved by the writer
+    atomic_uint tail __attribute__((aligned(64)));  // Next slot to fill, moved by the sender
+    atomic_ulong dropped;
+    struct capture_slot *slots;
+    int id;
+    FILE *fp;
+};
+
+// What to capture, set before the nodes are forked
+struct capture_filter {
+    bool node[CAPTURE_MAX_NODES];
+    bool port[CAPTURE_MAX_PORTS];
+    bool type[256];
+};
+
+bool capture_on = false;
+
+static char g_prefix[MAX_NAME_LENGTH];
+static struct capture_filter g_filter;
+static bool g_configured = false;
+static struct capture g_cap;
+
+// Set the ids listed, comma separated, or every one if the list is missing
+static bool parse_list(const char *list, bool *set, int max) {
+    char *end;
+    long v;
+
+    if (list == NULL) {
+        memset(set, true, max * sizeof(bool));
+        return true;
+    }
+    memset(set, false, max * sizeof(bool));
+    while (*list != '\0' && *list != ' ') {
+        v = strtol(list, &end, 10);
+        if (end == list || v < 0 || v >= max) return false;
+        set[v] = true;
+        list = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+bool capture_configure(const char *prefix, const char *filter) {
+    const char *node = NULL, *port = NULL, *type = NULL;
+    const char *c;
+
+    snprintf(g_prefix, sizeof(g_prefix), "%s", prefix);
+    for (c = filter; c != NULL && *c != '\0';) {
+        if (strncmp(c, "node=", 5) == 0) {
+            node = c + 5;
+        } else if (strncmp(c, "port=", 5) == 0) {
+            port = c + 5;
+        } else if (strncmp(c, "type=", 5) == 0) {
+            type = c + 5;
+        } else if (*c != ' ') {
+            return false;
+        }
+        c = strchr(c, ' ');
+        if (c != NULL) c++;
+    }
+    if (!parse_list(node, g_filter.node, CAPTURE_MAX_NODES) || !parse_list(port, g_filter.port, CAPTURE_MAX_PORTS)
+        || !parse_list(type, g_filter.type, 256)) {
+        return false;
+    }
+    g_configured = true;
+    return true;
+}
+
+static void put_u32(FILE *fp, uint32_t v) {
+    fwrite(&v, sizeof(v), 1, fp);
+}
+
+// Write out what the sender put in the ring, returns how many packets
+static int drain(struct capture *cap) {
+    unsigned head = atomic_load_explicit(&cap->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&cap->tail, memory_order_acquire);
+    struct capture_slot *s;
+    char header[CAPTURE_HEADER] = {0};
+    int n = 0;
+
+    for (; head != tail; head++, n++) {
+        s = &cap->slots[head & (CAPTURE_SLOTS - 1)];
+        put_u32(cap->fp, (uint32_t) (s->ns / 1000000000));
+        put_u32(cap->fp, (uint32_t) (s->ns % 1000000000));
+        put_u32(cap->fp, CAPTURE_HEADER + s->len);
+        put_u32(cap->fp, CAPTURE_HEADER + s->len);
+        header[0] = (char) cap->id;
+        header[1] = (char) s->port;
+        fwrite(header, 1, CAPTURE_HEADER, cap->fp);
+        fwrite(s->data, 1, s->len, cap->fp);
+    }
+    atomic_store_explicit(&cap->head, head, memory_order_release);
+    return n;
+}
+
+static void *capture_writer(void *arg) {
+    struct capture *cap = (struct capture *) arg;
+    unsigned long dropped, reported = 0;
+
+    while (true) {
+        // The nodes are killed, not stopped, so whatever was taken out goes to the file now
+        if (drain(cap) > 0) {
+            fflush(cap->fp);
+            continue;
+        }
+        dropped = atomic_load_explicit(&cap->dropped, memory_order_relaxed);
+        if (dropped != reported) {
+            fprintf(stderr, "capture: node %d left out %lu packets, the ring was full\n", cap->id,
+                    dropped - reported);
+            reported = dropped;
+        }
+        usleep(CAPTURE_FLUSH_US);
+    }
+    return NULL;
+}
+
+void capture_start(int id) {
+    char path[MAX_NAME_LENGTH + 32];
+    pthread_t thread;
+
+    if (!g_configured || id < 0 || id >= CAPTURE_MAX_NODES || !g_filter.node[id]) return;
+
+    g_cap.id = id;
+    g_cap.slots = (struct capture_slot *) calloc(CAPTURE_SLOTS, sizeof(struct capture_slot));
+    snprintf(path, sizeof(path), CAPTURE_FILE, g_prefix, id);
+    g_cap.fp = fopen(path, "w");
+    if (g_cap.slots == NULL || g_cap.fp == NULL) {
+        fprintf(stderr, "capture: cannot capture node %d to %s\n", id, path);
+        return;
+    }
+
+    // pcap header, nanosecond timestamps
+    put_u32(g_cap.fp, 0xa1b23c4d);
+    put_u32(g_cap.fp, 2 | (4u << 16));  // Version 2.4
+    put_u32(g_cap.fp, 0);               // GMT offset
+    put_u32(g_cap.fp, 0);               // Timestamp accuracy
+    put_u32(g_cap.fp, CAPTURE_HEADER + PAYLOAD_MAX + 4 + TRACE_BYTES);
+    put_u32(g_cap.fp, CAPTURE_LINKTYPE);
+    fflush(g_cap.fp);
+
+    atomic_init(&g_cap.head, 0);
+    atomic_init(&g_cap.tail, 0);
+    atomic_init(&g_cap.dropped, 0);
+    if (pthread_create(&thread, NULL, capture_writer, &g_cap) != 0) {
+        fprintf(stderr, "capture: cannot start the writer of node %d\n", id);
+        return;
+    }
+    pthread_detach(thread);
+    capture_on = true;
+}
+
+void capture_packet(int port, const char *msg, int len) {
+    unsigned tail = atomic_load_explicit(&g_cap.tail, memory_order_relaxed);
+    struct capture_slot *s;
+    struct timespec ts;
+
+    if (port < 0 || port >= CAPTURE_MAX_PORTS || !g_filter.port[port]) return;
+    if (len < 4 || !g_filter.type[(unsigned char) msg[2] & ~PKT_TRACED]) return;
+    if (tail - atomic_load_explicit(&g_cap.head, memory_order_acquire) >= CAPTURE_SLOTS) {
+        atomic_fetch_add_explicit(&g_cap.dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    s = &g_cap.slots[tail & (CAPTURE_SLOTS - 1)];
+    clock_gettime(CLOCK_REALTIME, &ts);
+    s->ns = (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+    s->port = (uint8_t) port;
+    s->len = (uint8_t) (len <= (int) sizeof(s->data) ? len : (int) sizeof(s->data));
+    memcpy(s->data, msg, s->len);
+    atomic_store_explicit(&g_cap.tail, tail + 1, memory_order_release);
+}
@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file capture.h
+/// @version 1.0
+///
+/// Capture of the packets nodes send, to one pcap file per node. The
+/// sending thread only copies the packet and a timestamp into a ring of
+/// fixed slots; a writer thread of the node takes them out and writes
+/// them. Nothing waits on the disk: a packet that finds the ring full is
+/// left out of the capture and counted.
+///
+/// The files use timestamps in nanoseconds and the link type USER0 (147).
+/// Each record is a 4 byte header, then the packet as it goes on the
+/// pipe: src, dst, type, length, payload, then the trace if the packet
+/// has one (trace.h).
+///
+///     byte 0  node that sent it
+///     byte 1  port of the node it went out on
+///     byte 2  0
+///     byte 3  0
+///
+/// The files of all nodes merge into one with mergecap. A filter picks
+/// what is captured: "node=2,3 port=0 type=1,2" keeps the ping packets
+/// switches 2 and 3 send on their port 0; a missing key matches all.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_CAPTURE_H
+#define NETWORK_SIMULATOR_02_CAPTURE_H
+
+#include <stdbool.h>
+
+#include "main.h"
+
+#define CAPTURE_FILE        "%s.%d.pcap"    /* Prefix, node id */
+#define CAPTURE_SLOTS       4096            /* Packets the ring holds; power of two */
+#define CAPTURE_FLUSH_US    10000           /* The writer sleeps this long when the ring is empty */
+#define CAPTURE_LINKTYPE    147             /* LINKTYPE_USER0 */
+#define CAPTURE_MAX_NODES   128             /* Node ids are signed chars */
+#define CAPTURE_MAX_PORTS   64
+
+extern bool capture_on;             // This process captures, checked before every capture_packet()
+
+// Capture to files starting with prefix, what filter matches (NULL for all); before the nodes are forked
+bool capture_configure(const char *prefix, const char *filter);
+
+// Start capturing as node id, if it is to be captured; in the node's process
+void capture_start(int id);
+
+// A packet about to be sent on a port, as it goes on the pipe
+void capture_packet(int port, const char *msg, int len);
+
+#endif //NETWORK_SIMULATOR_02_CAPTURE_H
@@ -0,0 +1,30 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file clock.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <time.h>
+
+#include "clock.h"
+
+uint64_t clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
+
+uint32_t clock_ms(void) {
+    return (uint32_t) (clock_us() / 1000);
+}
+
+uint64_t clock_cpu_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
@@ -0,0 +1,27 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file clock.h
+/// @version 1.0
+///
+/// Monotonic time for timeouts, RTTs and cache expiry, and CPU time used.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_CLOCK_H
+#define NETWORK_SIMULATOR_02_CLOCK_H
+
+#include <stdint.h>
+
+// Milliseconds since an arbitrary start, wraps after about 49 days
+uint32_t clock_ms(void);
+
+// Microseconds since an arbitrary start
+uint64_t clock_us(void);
+
+// Microseconds of CPU time this process has used
+uint64_t clock_cpu_us(void);
+
+#endif //NETWORK_SIMULATOR_02_CLOCK_H
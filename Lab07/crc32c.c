@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file crc32c.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <pthread.h>
+
+#include "crc32c.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_HW_X86
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_HW_ARM
+#endif
+
+#define CRC32C_POLY 0x82F63B78u  // Reflected Castagnoli polynomial
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static uint32_t (*crc_impl)(uint32_t crc, const unsigned char *buf, size_t len) = NULL;
+
+static void crc32c_init_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        }
+        crc_table[i] = c;
+    }
+}
+
+// Table driven fallback, one byte at a time
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *buf, size_t len) {
+    while (len--) {
+        crc = crc_table[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CRC32C_HW_X86
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *buf, size_t len) {
+    uint64_t crc64 = crc;
+    uint64_t word;
+
+    while (len >= sizeof(uint64_t)) {
+        memcpy(&word, buf, sizeof(uint64_t));
+        crc64 = _mm_crc32_u64(crc64, word);
+        buf += sizeof(uint64_t);
+        len -= sizeof(uint64_t);
+    }
+    crc = (uint32_t) crc64;
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *buf++);
+    }
+    return crc;
+}
+#endif
+
+#ifdef CRC32C_HW_ARM
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *buf, size_t len) {
+    uint64_t word;
+
+    while (len >= sizeof(uint64_t)) {
+        memcpy(&word, buf, sizeof(uint64_t));
+        crc = __crc32cd(crc, word);
+        buf += sizeof(uint64_t);
+        len -= sizeof(uint64_t);
+    }
+    while (len--) {
+        crc = __crc32cb(crc, *buf++);
+    }
+    return crc;
+}
+#endif
+
+// Pick the implementation the first time a checksum is needed, once even with DNS workers racing to it
+static void crc32c_select(void) {
+    crc32c_init_table();
+    crc_impl = crc32c_sw;
+#if defined(CRC32C_HW_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc_impl = crc32c_hw;
+    }
+#elif defined(CRC32C_HW_ARM)
+    crc_impl = crc32c_hw;
+#endif
+}
+
+uint32_t crc32c_update(uint32_t crc, const void *buf, size_t len) {
+    pthread_once(&crc_once, crc32c_select);
+    return ~crc_impl(~crc, (const unsigned char *) buf, len);
+}
+
+uint32_t crc32c(const void *buf, size_t len) {
+    return crc32c_update(0, buf, len);
+}
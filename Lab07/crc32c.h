@@ -0,0 +1,26 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file crc32c.h
+/// @version 1.0
+///
+/// CRC32C (Castagnoli) checksums used to protect file transfers.
+/// Uses the SSE4.2 / ARMv8 CRC instructions when the CPU has them.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_CRC32C_H
+#define NETWORK_SIMULATOR_02_CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Continue a running CRC32C. Start with crc = 0.
+uint32_t crc32c_update(uint32_t crc, const void *buf, size_t len);
+
+// CRC32C of a single buffer
+uint32_t crc32c(const void *buf, size_t len);
+
+#endif //NETWORK_SIMULATOR_02_CRC32C_H
@@ -0,0 +1,559 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file dns_db.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dns_db.h"
+#include "crc32c.h"
+
+void dns_db_init(struct dns_db *db, int num_shards) {
+    struct dns_shard *sh;
+
+    memset(db, 0, sizeof(struct dns_db));
+    if (num_shards < 1) num_shards = 1;
+    if (num_shards > DNS_DB_MAX_SHARDS) num_shards = DNS_DB_MAX_SHARDS;
+    db->num_shards = num_shards;
+    atomic_init(&db->now, 0);
+    db->shards = (struct dns_shard *) aligned_alloc(64, num_shards * sizeof(struct dns_shard));
+    for (int i = 0; i < num_shards; i++) {
+        sh = &db->shards[i];
+        memset(sh, 0, sizeof(struct dns_shard));
+        sh->num_buckets = DNS_DB_MIN_BUCKETS;
+        sh->buckets = (struct dns_record **) calloc(sh->num_buckets, sizeof(struct dns_record *));
+        atomic_init(&sh->names, 0);
+        dns_trie_init(&sh->trie);
+    }
+}
+
+// The top bits of the hash pick the shard, the low ones pick the bucket and snapshot slot
+static int shard_index(struct dns_db *db, uint32_t hash) {
+    return (int) (((uint64_t) hash * (uint32_t) db->num_shards) >> 32);
+}
+
+static struct dns_shard *shard_of(struct dns_db *db, uint32_t hash) {
+    return &db->shards[shard_index(db, hash)];
+}
+
+int dns_db_shard(struct dns_db *db, const char *name, int len) {
+    return shard_index(db, crc32c(name, len));
+}
+
+uint32_t dns_db_names(struct dns_db *db) {
+    uint32_t names = 0;
+
+    for (int i = 0; i < db->num_shards; i++) {
+        names += atomic_load_explicit(&db->shards[i].names, memory_order_relaxed);
+    }
+    return names;
+}
+
+void dns_db_set_time(struct dns_db *db, uint32_t now) {
+    atomic_store_explicit(&db->now, now, memory_order_relaxed);
+}
+
+static bool expired(struct dns_db *db, uint32_t expires) {
+    return expires != 0 && expires <= atomic_load_explicit(&db->now, memory_order_relaxed);
+}
+
+// Only the shard's own thread changes the count, others just read it
+static void count_names(struct dns_shard *sh, int change) {
+    atomic_store_explicit(&sh->names, atomic_load_explicit(&sh->names, memory_order_relaxed) + change,
+                          memory_order_relaxed);
+}
+
+static struct dns_record **find_slot(struct dns_shard *sh, const char *name, int len, uint32_t hash) {
+    struct dns_record **rp = &sh->buckets[hash & (sh->num_buckets - 1)];
+
+    while (*rp != NULL) {
+        struct dns_record *r = *rp;
+        if (r->hash == hash && r->len == len && memcmp(r->name, name, len) == 0) break;
+        rp = &r->next;
+    }
+    return rp;
+}
+
+// Double the buckets once there is more than one record per bucket on average
+static void grow(struct dns_shard *sh) {
+    uint32_t new_num = sh->num_buckets * 2;
+    struct dns_record **new_buckets = (struct dns_record **) calloc(new_num, sizeof(struct dns_record *));
+    struct dns_record *r, *next;
+
+    if (new_buckets == NULL) return;
+    for (uint32_t b = 0; b < sh->num_buckets; b++) {
+        for (r = sh->buckets[b]; r != NULL; r = next) {
+            next = r->next;
+            r->next = new_buckets[r->hash & (new_num - 1)];
+            new_buckets[r->hash & (new_num - 1)] = r;
+        }
+    }
+    free(sh->buckets);
+    sh->buckets = new_buckets;
+    sh->num_buckets = new_num;
+}
+
+static void add_record(struct dns_shard *sh, struct dns_record **rp, const char *name, int len, uint32_t hash,
+                       int id, uint32_t expires) {
+    struct dns_record *r = (struct dns_record *) malloc(sizeof(struct dns_record));
+
+    r->name = (char *) malloc(len + 1);
+    memcpy(r->name, name, len);
+    r->name[len] = '\0';
+    r->len = len;
+    r->hash = hash;
+    r->id = id;
+    r->expires = expires;
+    r->next = NULL;
+    *rp = r;
+
+    if (++sh->count > sh->num_buckets) grow(sh);
+}
+
+// Name of a snapshot slot, NULL if the slot is free or points outside the names
+static const char *slot_name(struct dns_db *db, const struct dns_snap_slot *s) {
+    if (s->len == 0 || s->name_off >= db->snap_header->names_size
+        || db->snap_header->names_size - s->name_off <= s->len) {
+        return NULL;
+    }
+    return db->snap_names + s->name_off;
+}
+
+static const struct dns_snap_slot *snap_find(struct dns_db *db, const char *name, int len, uint32_t hash) {
+    uint32_t mask, i, n;
+    const struct dns_snap_slot *s;
+    const char *sname;
+
+    if (db->snap == NULL) return NULL;
+    mask = db->snap_header->num_slots - 1;
+    for (i = hash & mask, n = 0; n <= mask; i = (i + 1) & mask, n++) {
+        s = &db->snap_slots[i];
+        if (s->len == 0) return NULL;
+        if (s->hash != hash || s->len != len) continue;
+        sname = slot_name(db, s);
+        if (sname != NULL && memcmp(sname, name, len) == 0) return s;
+    }
+    return NULL;
+}
+
+int dns_db_lookup(struct dns_db *db, const char *name, int len) {
+    uint32_t hash = crc32c(name, len);
+    struct dns_record *r = *find_slot(shard_of(db, hash), name, len, hash);
+    const struct dns_snap_slot *s;
+
+    // Changes since the snapshot come first
+    if (r != NULL) return r->id >= 0 && !expired(db, r->expires) ? r->id : -1;
+    s = snap_find(db, name, len, hash);
+    return s != NULL && !expired(db, s->expires) ? s->id : -1;
+}
+
+bool dns_db_insert(struct dns_db *db, const char *name, int len, int id, uint32_t expires) {
+    uint32_t hash = crc32c(name, len);
+    struct dns_shard *sh = shard_of(db, hash);
+    struct dns_record **rp = find_slot(sh, name, len, hash);
+    const struct dns_snap_slot *s;
+
+    // An expired name not swept yet is still counted, and is simply taken over
+    if (id < 0 || id >= DNS_DB_MAX_ID) return false;
+    if (*rp != NULL) {
+        if ((*rp)->id != DNS_DB_REMOVED && !expired(db, (*rp)->expires)) return false;
+        if ((*rp)->id == DNS_DB_REMOVED) count_names(sh, 1);
+        (*rp)->id = id;
+        (*rp)->expires = expires;
+    } else {
+        s = snap_find(db, name, len, hash);
+        if (s != NULL && !expired(db, s->expires)) return false;
+        add_record(sh, rp, name, len, hash, id, expires);
+        if (s == NULL) count_names(sh, 1);
+    }
+
+    dns_trie_insert(&sh->trie, name, len, id);
+    return true;
+}
+
+bool dns_db_renew(struct dns_db *db, const char *name, int len, int id, uint32_t expires) {
+    uint32_t hash = crc32c(name, len);
+    struct dns_shard *sh = shard_of(db, hash);
+    struct dns_record **rp = find_slot(sh, name, len, hash);
+    const struct dns_snap_slot *s;
+
+    if (*rp != NULL) {
+        if ((*rp)->id != id || expired(db, (*rp)->expires)) return false;
+        (*rp)->expires = expires;
+        return true;
+    }
+
+    // The snapshot cannot change, a record with the new expiry shadows it
+    s = snap_find(db, name, len, hash);
+    if (s == NULL || s->id != id || expired(db, s->expires)) return false;
+    add_record(sh, rp, name, len, hash, id, expires);
+    return true;
+}
+
+bool dns_db_remove(struct dns_db *db, const char *name, int len) {
+    uint32_t hash = crc32c(name, len);
+    struct dns_shard *sh = shard_of(db, hash);
+    struct dns_record **rp = find_slot(sh, name, len, hash);
+    struct dns_record *r = *rp;
+    bool in_snap = snap_find(db, name, len, hash) != NULL;
+
+    if (r != NULL) {
+        if (r->id == DNS_DB_REMOVED) return false;
+        if (in_snap) {
+            r->id = DNS_DB_REMOVED;     // Keep hiding the snapshot's copy
+        } else {
+            *rp = r->next;
+            sh->count--;
+            free(r->name);
+            free(r);
+        }
+    } else {
+        if (!in_snap) return false;
+        add_record(sh, rp, name, len, hash, DNS_DB_REMOVED, 0);
+    }
+
+    dns_trie_remove(&sh->trie, name, len);
+    count_names(sh, -1);
+    return true;
+}
+
+// Walks the shards' tries one after another as if they were one, leaving out expired names
+struct shard_match {
+    struct dns_db *db;
+    int skip;
+    int reported;
+    bool full;
+    dns_match_fn fn;
+    void *arg;
+};
+
+static bool match_across(void *arg, const char *name, int id) {
+    struct shard_match *m = (struct shard_match *) arg;
+
+    if (dns_db_lookup(m->db, name, (int) strlen(name)) != id) return true;
+    if (m->skip > 0) {
+        m->skip--;
+        return true;
+    }
+    if (!m->fn(m->arg, name, id)) {
+        m->full = true;
+        return false;
+    }
+    m->reported++;
+    return true;
+}
+
+int dns_db_match(struct dns_db *db, const char *pattern, int len, int skip, dns_match_fn fn, void *arg,
+                 bool *more) {
+    struct shard_match m = {db, skip, 0, false, fn, arg};
+
+    dns_db_warm(db, UINT32_MAX);
+    for (int i = 0; i < db->num_shards && !m.full; i++) {
+        dns_trie_match(&db->shards[i].trie, pattern, len, 0, match_across, &m, more);
+    }
+    *more = m.full;
+    return m.reported;
+}
+
+void dns_db_each(struct dns_db *db, dns_each_fn fn, void *arg) {
+    const struct dns_snap_slot *s;
+    const char *name;
+    struct dns_record *r;
+    struct dns_shard *sh;
+
+    if (db->snap != NULL) {
+        for (uint32_t i = 0; i < db->snap_header->num_slots; i++) {
+            s = &db->snap_slots[i];
+            name = slot_name(db, s);
+            if (name == NULL || expired(db, s->expires)
+                || *find_slot(shard_of(db, s->hash), name, s->len, s->hash) != NULL) {
+                continue;
+            }
+            if (!fn(arg, name, s->id, s->expires)) return;
+        }
+    }
+    for (int i = 0; i < db->num_shards; i++) {
+        sh = &db->shards[i];
+        for (uint32_t b = 0; b < sh->num_buckets; b++) {
+            for (r = sh->buckets[b]; r != NULL; r = r->next) {
+                if (r->id < 0 || expired(db, r->expires)) continue;
+                if (!fn(arg, r->name, r->id, r->expires)) return;
+            }
+        }
+    }
+}
+
+bool dns_db_warm_shard(struct dns_db *db, int shard, uint32_t budget) {
+    struct dns_shard *sh = &db->shards[shard];
+    const struct dns_snap_slot *s;
+    const char *name;
+
+    if (db->snap == NULL) return true;
+    while (sh->warm_next < db->snap_header->num_slots && budget > 0) {
+        s = &db->snap_slots[sh->warm_next++];
+        if (shard_index(db, s->hash) != shard) continue;
+        name = slot_name(db, s);
+        if (name == NULL || expired(db, s->expires)) continue;
+        budget--;
+
+        // Names changed since the snapshot were put in the trie when they changed
+        if (*find_slot(sh, name, s->len, s->hash) == NULL) dns_trie_insert(&sh->trie, name, s->len, s->id);
+    }
+    return sh->warm_next >= db->snap_header->num_slots;
+}
+
+uint32_t dns_db_sweep_shard(struct dns_db *db, int shard, uint32_t budget) {
+    struct dns_shard *sh = &db->shards[shard];
+    const struct dns_snap_slot *s;
+    struct dns_record **rp, *r;
+    const char *name;
+    uint32_t dropped = 0;
+    uint32_t num_slots = db->snap != NULL ? db->snap_header->num_slots : 0;
+
+    while (budget > 0) {
+        // The buckets first, then the snapshot, then around again
+        if (sh->sweep_bucket < sh->num_buckets) {
+            rp = &sh->buckets[sh->sweep_bucket++];
+            while ((r = *rp) != NULL) {
+                if (budget > 0) budget--;
+                if (r->id < 0 || !expired(db, r->expires)) {
+                    rp = &r->next;
+                    continue;
+                }
+                dns_trie_remove(&sh->trie, r->name, r->len);
+                count_names(sh, -1);
+                dropped++;
+                if (snap_find(db, r->name, r->len, r->hash) != NULL) {
+                    r->id = DNS_DB_REMOVED;     // Keep hiding the snapshot's copy
+                    rp = &r->next;
+                } else {
+                    *rp = r->next;
+                    sh->count--;
+                    free(r->name);
+                    free(r);
+                }
+            }
+        } else if (sh->sweep_slot < num_slots) {
+            s = &db->snap_slots[sh->sweep_slot++];
+            budget--;
+            if (shard_index(db, s->hash) != shard) continue;
+            name = slot_name(db, s);
+            if (name == NULL || !expired(db, s->expires)) continue;
+            rp = find_slot(sh, name, s->len, s->hash);
+            if (*rp != NULL) continue;      // Changed since, the buckets have it
+            add_record(sh, rp, name, s->len, s->hash, DNS_DB_REMOVED, 0);
+            dns_trie_remove(&sh->trie, name, s->len);
+            count_names(sh, -1);
+            dropped++;
+        } else {
+            sh->sweep_bucket = 0;
+            sh->sweep_slot = 0;
+            break;
+        }
+    }
+    return dropped;
+}
+
+uint32_t dns_db_sweep(struct dns_db *db, uint32_t budget) {
+    uint32_t dropped = 0;
+
+    for (int i = 0; i < db->num_shards; i++) dropped += dns_db_sweep_shard(db, i, budget);
+    return dropped;
+}
+
+bool dns_db_warm(struct dns_db *db, uint32_t budget) {
+    bool done = true;
+
+    for (int i = 0; i < db->num_shards; i++) {
+        if (!dns_db_warm_shard(db, i, budget)) done = false;
+    }
+    return done;
+}
+
+// Map a snapshot file and check its layout, the names are checked as they are used
+static void *snap_map(const char *path, size_t *size) {
+    const struct dns_snap_header *h;
+    struct stat st;
+    void *base;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(struct dns_snap_header)) {
+        close(fd);
+        return NULL;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    h = (const struct dns_snap_header *) base;
+    if (h->magic != DNS_SNAP_MAGIC || h->version != DNS_SNAP_VERSION
+        || h->num_slots == 0 || (h->num_slots & (h->num_slots - 1)) != 0 || h->count > h->num_slots / 2
+        || (uint64_t) st.st_size != sizeof(struct dns_snap_header)
+                                     + (uint64_t) h->num_slots * sizeof(struct dns_snap_slot) + h->names_size) {
+        munmap(base, st.st_size);
+        return NULL;
+    }
+    *size = st.st_size;
+    return base;
+}
+
+static void snap_attach(struct dns_db *db, void *base, size_t size) {
+    db->snap = base;
+    db->snap_size = size;
+    db->snap_header = (const struct dns_snap_header *) base;
+    db->snap_slots = (const struct dns_snap_slot *) (db->snap_header + 1);
+    db->snap_names = (const char *) (db->snap_slots + db->snap_header->num_slots);
+}
+
+bool dns_db_load_snapshot(struct dns_db *db, const char *path) {
+    uint32_t names[DNS_DB_MAX_SHARDS] = {0};
+    size_t size;
+    void *base;
+
+    if (db->snap != NULL || dns_db_names(db) > 0) return false;
+    base = snap_map(path, &size);
+    if (base == NULL) return false;
+    snap_attach(db, base, size);
+
+    // Each shard counts its own names, one pass over the slots when there are several
+    if (db->num_shards == 1) {
+        names[0] = db->snap_header->count;
+    } else {
+        for (uint32_t i = 0; i < db->snap_header->num_slots; i++) {
+            if (db->snap_slots[i].len != 0) names[shard_index(db, db->snap_slots[i].hash)]++;
+        }
+    }
+    for (int i = 0; i < db->num_shards; i++) {
+        atomic_store_explicit(&db->shards[i].names, names[i], memory_order_relaxed);
+        db->shards[i].warm_next = 0;
+    }
+    return true;
+}
+
+struct snap_builder {
+    struct dns_snap_header *header;
+    struct dns_snap_slot *slots;
+    char *names;
+    uint32_t names_size;
+};
+
+static bool size_name(void *arg, const char *name, int id, uint32_t expires) {
+    (void) id;
+    (void) expires;
+    ((struct snap_builder *) arg)->names_size += (uint32_t) strlen(name) + 1;
+    return true;
+}
+
+static bool put_name(void *arg, const char *name, int id, uint32_t expires) {
+    struct snap_builder *b = (struct snap_builder *) arg;
+    uint32_t len = (uint32_t) strlen(name);
+    uint32_t hash = crc32c(name, len);
+    uint32_t mask = b->header->num_slots - 1;
+    uint32_t i = hash & mask;
+
+    while (b->slots[i].len != 0) i = (i + 1) & mask;
+    b->slots[i].hash = hash;
+    b->slots[i].name_off = b->names_size;
+    b->slots[i].expires = expires;
+    b->slots[i].len = (uint8_t) len;
+    b->slots[i].id = (uint8_t) id;
+    memcpy(b->names + b->names_size, name, len + 1);
+    b->names_size += len + 1;
+    b->header->count++;
+    return true;
+}
+
+bool dns_db_write_snapshot(struct dns_db *db, const char *path) {
+    struct snap_builder b = {0};
+    struct dns_record *r, *next;
+    struct dns_shard *sh;
+    char tmp_path[256];
+    uint32_t num_slots = DNS_DB_MIN_BUCKETS;
+    size_t size, done;
+    ssize_t n;
+    void *base;
+    char *buf;
+    int fd;
+
+    // The trie stays as it is, so it has to hold every name first, and none that expired
+    dns_db_warm(db, UINT32_MAX);
+    for (int k = 0; k < db->num_shards; k++) {
+        db->shards[k].sweep_bucket = 0;
+        db->shards[k].sweep_slot = 0;
+    }
+    dns_db_sweep(db, UINT32_MAX);
+
+    while (num_slots < dns_db_names(db) * 2) num_slots *= 2;
+    dns_db_each(db, size_name, &b);
+    size = sizeof(struct dns_snap_header) + (size_t) num_slots * sizeof(struct dns_snap_slot) + b.names_size;
+    buf = (char *) calloc(1, size);
+    if (buf == NULL) return false;
+
+    b.header = (struct dns_snap_header *) buf;
+    b.header->magic = DNS_SNAP_MAGIC;
+    b.header->version = DNS_SNAP_VERSION;
+    b.header->num_slots = num_slots;
+    b.header->names_size = b.names_size;
+    b.slots = (struct dns_snap_slot *) (b.header + 1);
+    b.names = (char *) (b.slots + num_slots);
+    b.names_size = 0;
+    dns_db_each(db, put_name, &b);
+
+    // Write a new file and rename it over the old one, so a crash leaves one or the other
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(buf);
+        return false;
+    }
+    for (done = 0; done < size; done += n) {
+        n = write(fd, buf + done, size - done);
+        if (n <= 0) break;
+    }
+    free(buf);
+    if (done < size || fsync(fd) < 0) {
+        close(fd);
+        unlink(tmp_path);
+        return false;
+    }
+    close(fd);
+    if (rename(tmp_path, path) < 0) {
+        unlink(tmp_path);
+        return false;
+    }
+
+    base = snap_map(path, &size);
+    if (base == NULL) return false;
+
+    // Everything is in the new snapshot now, only the tries are kept
+    for (int k = 0; k < db->num_shards; k++) {
+        sh = &db->shards[k];
+        for (uint32_t i = 0; i < sh->num_buckets; i++) {
+            for (r = sh->buckets[i]; r != NULL; r = next) {
+                next = r->next;
+                free(r->name);
+                free(r);
+            }
+            sh->buckets[i] = NULL;
+        }
+        sh->count = 0;
+    }
+    if (db->snap != NULL) munmap(db->snap, db->snap_size);
+    snap_attach(db, base, size);
+    for (int k = 0; k < db->num_shards; k++) db->shards[k].warm_next = db->snap_header->num_slots;
+    return true;
+}
@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file dns_db.h
+/// @version 1.0
+///
+/// Name table of the DNS server. Names are hashed (CRC32C) into chained
+/// buckets that double when the table gets full, so a lookup costs the
+/// same with ten names or millions. Names match exactly. Every record is
+/// also put in a label trie for wildcard and subtree queries.
+///
+/// The table can sit on top of a snapshot file, which is mapped into
+/// memory as is: it holds an open addressing hash table of the names, so
+/// lookups probe it directly and loading it costs nothing per name. The
+/// chained buckets then only hold the changes made since the snapshot,
+/// with removed snapshot names kept as records of id DNS_DB_REMOVED.
+/// The trie is filled from the snapshot a little at a time by
+/// dns_db_warm(), or all at once by the first pattern query.
+///
+/// Every name holds a lease: it expires at a time in seconds given when
+/// it was registered or renewed (0 never expires). An expired name is
+/// treated as gone right away, but its memory is only given back by
+/// dns_db_sweep(), which looks at a few records per call so the table
+/// never stops answering for long.
+///
+/// The table may be split into shards by name hash, each with its own
+/// buckets and trie over the one shared snapshot. A name only ever
+/// touches its own shard, so threads working on different shards can
+/// look up, insert and remove names without locks. Calls over the whole
+/// table (match, each, snapshots) need every such thread stopped.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_DNS_DB_H
+#define NETWORK_SIMULATOR_02_DNS_DB_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dns_trie.h"
+
+#define DNS_DB_MAX_ID       256     /* Node ids fit in one byte */
+#define DNS_DB_MIN_BUCKETS  64
+#define DNS_DB_REMOVED      (-1)    /* Record shadowing a removed snapshot name */
+#define DNS_DB_MAX_SHARDS   64
+
+#define DNS_SNAP_MAGIC      0x50414e53u     /* "SNAP" */
+#define DNS_SNAP_VERSION    2
+
+// Snapshot file: header, num_slots slots, then the names, each NUL terminated
+struct dns_snap_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;                 // Names in the snapshot
+    uint32_t num_slots;             // Power of two, at least twice count
+    uint32_t names_size;
+};
+
+struct dns_snap_slot {
+    uint32_t hash;
+    uint32_t name_off;              // Into the names
+    uint32_t expires;
+    uint8_t len;                    // 0 if the slot is free
+    uint8_t id;
+    uint16_t unused;
+};
+
+struct dns_record {
+    char *name;
+    int len;
+    uint32_t hash;
+    int id;                         // DNS_DB_REMOVED if the name was removed from the snapshot
+    uint32_t expires;               // Seconds, 0 if never
+    struct dns_record *next;        // Same bucket
+};
+
+// Names whose hash falls in one range, aligned so shards used by different threads share no cache line
+struct dns_shard {
+    struct dns_record **buckets;
+    uint32_t num_buckets;           // Power of two
+    uint32_t count;                 // Records in the buckets
+    atomic_uint names;              // Names registered, snapshot included, read by other threads
+    struct dns_trie trie;
+    uint32_t warm_next;             // Next snapshot slot to look at for the trie
+    uint32_t sweep_bucket;          // Next bucket to look at for expired names
+    uint32_t sweep_slot;            // Next snapshot slot, once the buckets are done
+} __attribute__((aligned(64)));
+
+struct dns_db {
+    struct dns_shard *shards;
+    int num_shards;
+    atomic_uint now;                // Seconds, names with an expiry up to this are gone
+
+    // Mapped snapshot, NULL if there is none
+    void *snap;
+    size_t snap_size;
+    const struct dns_snap_header *snap_header;
+    const struct dns_snap_slot *snap_slots;
+    const char *snap_names;
+};
+
+// Called by dns_db_each() with every name, until it returns false
+typedef bool (*dns_each_fn)(void *arg, const char *name, int id, uint32_t expires);
+
+// An empty table split into num_shards shards
+void dns_db_init(struct dns_db *db, int num_shards);
+
+// Shard a name belongs to
+int dns_db_shard(struct dns_db *db, const char *name, int len);
+
+// Names registered, snapshot included, may be called while other threads change the table
+uint32_t dns_db_names(struct dns_db *db);
+
+// Set the time leases are measured against, may be called while other threads use the table
+void dns_db_set_time(struct dns_db *db, uint32_t now);
+
+// Host id registered under the len bytes at name, -1 if there is none
+int dns_db_lookup(struct dns_db *db, const char *name, int len);
+
+// Returns false if the name is already registered, an expired name may be taken
+bool dns_db_insert(struct dns_db *db, const char *name, int len, int id, uint32_t expires);
+
+// Move the expiry of a name host id holds, returns false if it does not hold it
+bool dns_db_renew(struct dns_db *db, const char *name, int len, int id, uint32_t expires);
+
+// Returns false if the name was not registered
+bool dns_db_remove(struct dns_db *db, const char *name, int len);
+
+// Names matching a pattern such as "*.rack1.dc" or "**.dc", see dns_trie.h
+int dns_db_match(struct dns_db *db, const char *pattern, int len, int skip, dns_match_fn fn, void *arg,
+                 bool *more);
+
+// Call fn for every registered name that has not expired, until it returns false
+void dns_db_each(struct dns_db *db, dns_each_fn fn, void *arg);
+
+// Map a snapshot under an empty table, returns false if there is none or it is damaged
+bool dns_db_load_snapshot(struct dns_db *db, const char *path);
+
+// Write every registered name to a new snapshot and switch the table over to it
+bool dns_db_write_snapshot(struct dns_db *db, const char *path);
+
+// Put up to budget snapshot names in the trie, returns true once they all are
+bool dns_db_warm(struct dns_db *db, uint32_t budget);
+
+// The same for the names of one shard only
+bool dns_db_warm_shard(struct dns_db *db, int shard, uint32_t budget);
+
+// Drop the expired names among the next budget records of a shard, returns how many were dropped
+uint32_t dns_db_sweep_shard(struct dns_db *db, int shard, uint32_t budget);
+
+// The same over every shard
+uint32_t dns_db_sweep(struct dns_db *db, uint32_t budget);
+
+#endif //NETWORK_SIMULATOR_02_DNS_DB_H
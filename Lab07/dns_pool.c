@@ -0,0 +1,456 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file dns_pool.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "dns_pool.h"
+#include "dns_wal.h"
+#include "server.h"
+#include "metrics.h"
+
+struct packet *dns_reply_start(int server_id, struct packet *req, int type) {
+    struct packet *reply = (struct packet *) calloc(1, sizeof(struct packet));
+
+    reply->src = (char) server_id;
+    reply->dst = req->src;
+    reply->type = (char) type;
+    memset(reply->payload, 0, PAYLOAD_MAX);
+    memcpy(reply->payload + PKT_DNS_REQ_ID, req->payload + PKT_DNS_REQ_ID, sizeof(uint16_t));
+    reply->length = PKT_DNS_RECORDS;
+    return reply;
+}
+
+uint32_t dns_lease_expiry(struct dns_db *db) {
+    return atomic_load_explicit(&db->now, memory_order_relaxed) + DNS_LEASE;
+}
+
+void dns_reply_add_lease(struct packet *reply) {
+    uint32_t lease = DNS_LEASE;
+
+    memcpy(reply->payload + reply->length, &lease, sizeof(uint32_t));
+    reply->length += sizeof(uint32_t);
+}
+
+int dns_update_reply_type(int type) {
+    switch (type) {
+        case PKT_DNS_RENEW:
+            return PKT_DNS_RENEW_REPLY;
+        case PKT_DNS_UNREGISTER:
+            return PKT_DNS_UNREGISTER_REPLY;
+        default:
+            return PKT_DNS_REGISTER_REPLY;
+    }
+}
+
+char dns_update_name(struct dns_db *db, int type, const char *name, int len, int id, uint32_t expires,
+                     bool *changed) {
+    int owner;
+
+    *changed = false;
+    if (len > DNS_NAME_MAX) return DNS_REG_TOO_LONG;
+    owner = dns_db_lookup(db, name, len);
+
+    // Only the host holding a name may renew or drop it
+    if (type == PKT_DNS_UNREGISTER) {
+        if (owner != id) return DNS_REG_UNKNOWN;
+        *changed = dns_db_remove(db, name, len);
+        return DNS_REG_OK;
+    }
+    if (type == PKT_DNS_RENEW) {
+        if (owner != id) return DNS_REG_UNKNOWN;
+        *changed = dns_db_renew(db, name, len, id, expires);
+        return DNS_REG_OK;
+    }
+
+    // A host may hold several names, and registering one of its own again renews it
+    if (!dns_name_valid(name, len)) return DNS_REG_INVALID;     // Must be labels like web.rack1.dc
+    if (owner == id) {
+        *changed = dns_db_renew(db, name, len, id, expires);
+        return DNS_REG_OK;
+    }
+    if (owner >= 0) return DNS_REG_TAKEN;
+    *changed = dns_db_insert(db, name, len, id, expires);
+    return DNS_REG_OK;
+}
+
+void dns_answer_lookups(struct dns_db *db, int server_id, struct packet *req, uint64_t records,
+                        dns_send_fn send, void *arg) {
+    struct packet *reply = dns_reply_start(server_id, req, PKT_DNS_LOOKUP_REPLY);
+    int count = (unsigned char) req->payload[PKT_DNS_COUNT];
+    int pos = PKT_DNS_RECORDS;
+    int k, n, id;
+    uint32_t ttl;
+    char *name;
+    char *answer;
+
+    // Answer every name, starting another reply when one is full
+    for (k = 0; k < count && pos < req->length; k++) {
+        n = (unsigned char) req->payload[pos];
+        if (pos + 1 + n > req->length) break;
+        name = req->payload + pos + 1;
+        pos += 1 + n;
+        if (k >= 64 || !(records & (1ull << k))) continue;
+        if (n > DNS_NAME_MAX) continue;     // Could never have been registered
+
+        if (reply->length + (int) DNS_ANSWER_NAME + n > PAYLOAD_MAX) {
+            send(arg, reply);
+            reply = dns_reply_start(server_id, req, PKT_DNS_LOOKUP_REPLY);
+        }
+        answer = reply->payload + reply->length;
+
+        // Exact match on the whole name, -1 if it is not registered
+        id = dns_db_lookup(db, name, n);
+        metrics_add(id < 0 ? &metrics_self()->dns_misses : &metrics_self()->dns_hits, 1);
+        if (id < 0) {
+            answer[DNS_ANSWER_STATUS] = DNS_NOT_FOUND;
+            answer[DNS_ANSWER_HOST_ID] = 0;
+            ttl = DNS_NEGATIVE_TTL;
+        } else {
+            answer[DNS_ANSWER_STATUS] = DNS_FOUND;
+            answer[DNS_ANSWER_HOST_ID] = (char) id;
+            ttl = DNS_TTL;
+        }
+        memcpy(answer + DNS_ANSWER_TTL, &ttl, sizeof(uint32_t));
+
+        // Echo the name so the host can match the answer to its query
+        answer[DNS_ANSWER_NAME_LENGTH] = (char) n;
+        memcpy(answer + DNS_ANSWER_NAME, name, n);
+        reply->length += (int) DNS_ANSWER_NAME + n;
+        reply->payload[PKT_DNS_COUNT]++;
+    }
+    send(arg, reply);
+}
+
+// Record k of a request, NULL if it has fewer
+static char *record(struct packet *pkt, int k, int *len) {
+    int count = (unsigned char) pkt->payload[PKT_DNS_COUNT];
+    int pos = PKT_DNS_RECORDS;
+
+    for (int i = 0; i < count && pos < pkt->length; i++) {
+        *len = (unsigned char) pkt->payload[pos];
+        if (pos + 1 + *len > pkt->length) break;
+        if (i == k) return pkt->payload + pos + 1;
+        pos += 1 + *len;
+    }
+    return NULL;
+}
+
+static void notify(int fd) {
+    char c = 0;
+
+    // The pipe being full is fine, the reader has a byte to wake up on either way
+    if (write(fd, &c, 1) < 0) return;
+}
+
+static void drain(int fd) {
+    char buf[64];
+
+    while (read(fd, buf, sizeof(buf)) == (ssize_t) sizeof(buf));
+}
+
+static void keep_reply(void *arg, struct packet *pkt) {
+    struct dns_task *task = (struct dns_task *) arg;
+
+    if (task->num_replies < DNS_TASK_REPLIES) {
+        task->replies[task->num_replies++] = pkt;
+    } else {
+        free(pkt);
+    }
+}
+
+static void run_task(struct dns_worker *w, struct dns_task *task) {
+    struct dns_db *db = w->pool->db;
+    struct packet *pkt = task->req->packet;
+    char *name;
+    bool changed;
+    int len;
+
+    if (pkt->type == (char) PKT_DNS_LOOKUP) {
+        dns_answer_lookups(db, w->pool->server_id, pkt, task->records, keep_reply, task);
+        return;
+    }
+
+    // Each shard writes the statuses of its own names only
+    for (int k = 0; k < 64; k++) {
+        if (!(task->records & (1ull << k))) continue;
+        name = record(pkt, k, &len);
+        if (name == NULL) break;
+        task->req->reply->payload[PKT_DNS_RECORDS + k] =
+                dns_update_name(db, pkt->type, name, len, (int) (unsigned char) pkt->src, task->req->expires,
+                                &changed);
+        if (changed) task->changed |= 1ull << k;
+    }
+}
+
+static void *worker_main(void *arg) {
+    struct dns_worker *w = (struct dns_worker *) arg;
+    struct dns_pool *pool = w->pool;
+    struct dns_task *task;
+    bool warm = false;
+    bool done = false;
+    uint32_t gen = 0;
+    char buf[64];
+
+    while (true) {
+        task = (struct dns_task *) spsc_pop(&w->in);
+        if (task == NULL) {
+            if (done) {
+                notify(pool->done_fd[1]);
+                done = false;
+            }
+            // Fill the trie from the snapshot while there is nothing else to do
+            if (!warm) {
+                warm = dns_db_warm_shard(pool->db, w->shard, DNS_WARM_NAMES);
+                continue;
+            }
+
+            // Some more expired names, and more again right away if there were many
+            if (atomic_exchange_explicit(&w->sweep, false, memory_order_relaxed)) {
+                if (dns_db_sweep_shard(pool->db, w->shard, DNS_SWEEP_NAMES) >= DNS_SWEEP_NAMES / 4) {
+                    atomic_store_explicit(&w->sweep, true, memory_order_relaxed);
+                }
+                continue;
+            }
+            if (read(w->wake_fd[0], buf, sizeof(buf)) < 0) continue;
+            continue;
+        }
+
+        if (task == &pool->pause) {
+            if (done) {
+                notify(pool->done_fd[1]);
+                done = false;
+            }
+            // Everything done so far is seen by whoever sees the pause
+            atomic_store_explicit(&w->paused_gen, ++gen, memory_order_release);
+            notify(pool->done_fd[1]);
+            while (atomic_load_explicit(&w->resumed_gen, memory_order_acquire) < gen) {
+                if (read(w->wake_fd[0], buf, sizeof(buf)) < 0) continue;
+            }
+            warm = false;       // The table may have a new snapshot
+            continue;
+        }
+
+        run_task(w, task);
+        while (!spsc_push(&w->out, task)) sched_yield();
+        done = true;
+    }
+    return NULL;
+}
+
+bool dns_pool_start(struct dns_pool *pool, struct dns_db *db, int server_id, dns_send_fn send,
+                    dns_changed_fn changed, void *arg) {
+    struct dns_worker *w;
+
+    memset(pool, 0, sizeof(struct dns_pool));
+    pool->db = db;
+    pool->server_id = server_id;
+    pool->num_workers = db->num_shards;
+    pool->send = send;
+    pool->changed = changed;
+    pool->arg = arg;
+    if (pipe(pool->done_fd) < 0) return false;
+    fcntl(pool->done_fd[0], F_SETFL, fcntl(pool->done_fd[0], F_GETFL) | O_NONBLOCK);
+    fcntl(pool->done_fd[1], F_SETFL, fcntl(pool->done_fd[1], F_GETFL) | O_NONBLOCK);
+
+    pool->workers = (struct dns_worker *) aligned_alloc(64, pool->num_workers * sizeof(struct dns_worker));
+    if (pool->workers == NULL) return false;
+    for (int i = 0; i < pool->num_workers; i++) {
+        w = &pool->workers[i];
+        memset(w, 0, sizeof(struct dns_worker));
+        w->pool = pool;
+        w->shard = i;
+        atomic_init(&w->paused_gen, 0);
+        atomic_init(&w->resumed_gen, 0);
+        atomic_init(&w->sweep, false);
+
+        // Room for every outstanding task and a pause
+        if (!spsc_init(&w->in, DNS_POOL_QUEUE + 1) || !spsc_init(&w->out, DNS_POOL_QUEUE)) return false;
+        if (pipe(w->wake_fd) < 0) return false;
+        fcntl(w->wake_fd[1], F_SETFL, fcntl(w->wake_fd[1], F_GETFL) | O_NONBLOCK);
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) return false;
+    }
+    return true;
+}
+
+// A request with no tasks left is answered and freed
+static void finish(struct dns_pool *pool, struct dns_request *req) {
+    if (req->reply != NULL) pool->send(pool->arg, req->reply);
+    free(req->packet);
+    free(req);
+}
+
+bool dns_pool_submit(struct dns_pool *pool, struct packet *pkt) {
+    uint64_t records[DNS_DB_MAX_SHARDS] = {0};
+    struct dns_request *req;
+    struct dns_task *task;
+    struct dns_worker *w;
+    int count, pos, n, k;
+
+    if (pkt->length < PKT_DNS_RECORDS) return false;
+    count = (unsigned char) pkt->payload[PKT_DNS_COUNT];
+    pos = PKT_DNS_RECORDS;
+    for (k = 0; k < count && k < 64 && pos < pkt->length; k++) {
+        n = (unsigned char) pkt->payload[pos];
+        if (pos + 1 + n > pkt->length) break;
+        records[dns_db_shard(pool->db, pkt->payload + pos + 1, n)] |= 1ull << k;
+        pos += 1 + n;
+    }
+
+    // Every worker taking part must have room, so a request is never half taken
+    for (int i = 0; i < pool->num_workers; i++) {
+        if (records[i] != 0 && pool->workers[i].outstanding >= DNS_POOL_QUEUE) {
+            pool->dropped++;
+            return false;
+        }
+    }
+
+    req = (struct dns_request *) malloc(sizeof(struct dns_request));
+    req->packet = pkt;
+    req->reply = NULL;
+    req->expires = 0;
+    req->pending = 0;
+    if (pkt->type != (char) PKT_DNS_LOOKUP) {
+        req->reply = dns_reply_start(pool->server_id, pkt, dns_update_reply_type(pkt->type));
+        req->reply->payload[PKT_DNS_COUNT] = (char) k;
+        req->reply->length = PKT_DNS_RECORDS + k;
+        if (pkt->type != (char) PKT_DNS_UNREGISTER) {
+            req->expires = dns_lease_expiry(pool->db);
+            dns_reply_add_lease(req->reply);     // After the statuses the workers fill in
+        }
+    }
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        if (records[i] == 0) continue;
+        w = &pool->workers[i];
+        task = (struct dns_task *) malloc(sizeof(struct dns_task));
+        task->req = req;
+        task->records = records[i];
+        task->changed = 0;
+        task->num_replies = 0;
+        spsc_push(&w->in, task);
+        w->outstanding++;
+        w->woken = true;
+        req->pending++;
+    }
+
+    // No names at all, the reply is empty
+    if (req->pending == 0) {
+        if (req->reply == NULL) req->reply = dns_reply_start(pool->server_id, pkt, PKT_DNS_LOOKUP_REPLY);
+        finish(pool, req);
+    }
+    return true;
+}
+
+void dns_pool_wake(struct dns_pool *pool) {
+    for (int i = 0; i < pool->num_workers; i++) {
+        if (!pool->workers[i].woken) continue;
+        pool->workers[i].woken = false;
+        notify(pool->workers[i].wake_fd[1]);
+    }
+}
+
+void dns_pool_sweep(struct dns_pool *pool) {
+    for (int i = 0; i < pool->num_workers; i++) {
+        atomic_store_explicit(&pool->workers[i].sweep, true, memory_order_relaxed);
+        notify(pool->workers[i].wake_fd[1]);
+    }
+}
+
+int dns_pool_fd(struct dns_pool *pool) {
+    return pool->done_fd[0];
+}
+
+bool dns_pool_busy(struct dns_pool *pool) {
+    struct spsc_ring *out;
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        out = &pool->workers[i].out;
+        if (atomic_load_explicit(&out->head, memory_order_relaxed)
+            != atomic_load_explicit(&out->tail, memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void dns_pool_collect(struct dns_pool *pool) {
+    struct dns_worker *w;
+    struct dns_task *task;
+    struct dns_request *req;
+    char *name;
+    char op;
+    int len;
+
+    drain(pool->done_fd[0]);
+    for (int i = 0; i < pool->num_workers; i++) {
+        w = &pool->workers[i];
+        while ((task = (struct dns_task *) spsc_pop(&w->out)) != NULL) {
+            w->outstanding--;
+            req = task->req;
+            for (int r = 0; r < task->num_replies; r++) pool->send(pool->arg, task->replies[r]);
+
+            // Logged here, on the one thread that writes the log, before the reply goes out
+            for (int k = 0; k < 64 && task->changed != 0; k++) {
+                if (!(task->changed & (1ull << k))) continue;
+                task->changed &= ~(1ull << k);
+                name = record(req->packet, k, &len);
+                if (name == NULL) continue;
+                op = req->packet->type == (char) PKT_DNS_UNREGISTER ? DNS_WAL_REMOVE : DNS_WAL_ADD;
+                pool->changed(pool->arg, op, name, len, (int) (unsigned char) req->packet->src, req->expires);
+            }
+            if (--req->pending == 0) finish(pool, req);
+            free(task);
+        }
+    }
+}
+
+void dns_pool_pause(struct dns_pool *pool) {
+    struct pollfd pfd;
+    struct dns_worker *w;
+
+    if (pool->paused) return;
+    for (int i = 0; i < pool->num_workers; i++) {
+        w = &pool->workers[i];
+        w->pause_gen++;
+        spsc_push(&w->in, &pool->pause);
+        notify(w->wake_fd[1]);
+        w->woken = false;
+    }
+
+    // Wait for each to reach the pause, after the tasks before it
+    pfd.fd = pool->done_fd[0];
+    pfd.events = POLLIN;
+    for (int i = 0; i < pool->num_workers; i++) {
+        w = &pool->workers[i];
+        while (atomic_load_explicit(&w->paused_gen, memory_order_acquire) != w->pause_gen) {
+            poll(&pfd, 1, 10);
+            drain(pool->done_fd[0]);
+        }
+    }
+    pool->paused = true;
+}
+
+void dns_pool_resume(struct dns_pool *pool) {
+    struct dns_worker *w;
+
+    if (!pool->paused) return;
+    for (int i = 0; i < pool->num_workers; i++) {
+        w = &pool->workers[i];
+        atomic_store_explicit(&w->resumed_gen, w->pause_gen, memory_order_release);
+        notify(w->wake_fd[1]);
+    }
+    pool->paused = false;
+}
@@ -0,0 +1,145 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file dns_pool.h
+/// @version 1.0
+///
+/// Worker threads answering DNS lookups and registrations (renewals and
+/// unregistrations included) for a server.
+/// The name table is split into one shard per worker (see dns_db.h), and
+/// each request is split by the shard of its names: a worker only ever
+/// touches its own shard, so workers never wait on each other.
+///
+/// The server's own thread keeps the links, the log and replication. It
+/// hands each worker its tasks over a lock-free ring and takes the
+/// results back over another, and it alone sends replies and writes the
+/// log, so a registration is logged before it is answered. Lookup
+/// answers go out per shard, several reply packets with the same request
+/// id; a registration reply is put together once every shard is done.
+///
+/// Everything that reads the whole table (pattern queries, replication,
+/// snapshots) is done by the server thread with the workers paused.
+/// Expired names are swept by each worker from its own shard, between
+/// tasks, when the server asks it to.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_DNS_POOL_H
+#define NETWORK_SIMULATOR_02_DNS_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "main.h"
+#include "dns_db.h"
+#include "spsc.h"
+
+#define DNS_POOL_QUEUE      1024                /* Tasks a worker may have outstanding */
+#define DNS_TASK_REPLIES    (PAYLOAD_MAX / 2)   /* A reply per name at most */
+
+// Called with each packet to send
+typedef void (*dns_send_fn)(void *arg, struct packet *pkt);
+
+// Called with each change a request made to the table (DNS_WAL_ADD or DNS_WAL_REMOVE), before it is answered
+typedef void (*dns_changed_fn)(void *arg, char op, const char *name, int len, int id, uint32_t expires);
+
+// One request, split into a task per shard its names fall in
+struct dns_request {
+    struct packet *packet;
+    struct packet *reply;           // Registrations: a status per name, filled in by the workers
+    uint32_t expires;               // Registrations: when the leases given end
+    int pending;                    // Tasks not back yet
+};
+
+struct dns_task {
+    struct dns_request *req;
+    uint64_t records;               // Records of the request in this task's shard, a bit each
+    uint64_t changed;               // Registrations: the records that changed the table
+    int num_replies;
+    struct packet *replies[DNS_TASK_REPLIES];
+};
+
+struct dns_pool;
+
+struct dns_worker {
+    struct dns_pool *pool;
+    int shard;
+    pthread_t thread;
+    struct spsc_ring in;            // Tasks, the pause task included
+    struct spsc_ring out;           // Tasks done
+    int wake_fd[2];                 // A byte is written when tasks were pushed or a pause ends
+    int outstanding;                // Pushed and not back yet, server thread only
+    bool woken;                     // Pushed to since the last wakeup, server thread only
+    atomic_bool sweep;              // Drop the expired names of the shard when idle
+    uint32_t pause_gen;             // Pauses asked for, server thread only
+    atomic_uint paused_gen;         // Pauses the worker has reached
+    atomic_uint resumed_gen;        // Pauses that are over
+} __attribute__((aligned(64)));
+
+struct dns_pool {
+    struct dns_db *db;
+    int server_id;
+    int num_workers;                // One per shard of db
+    struct dns_worker *workers;
+    int done_fd[2];                 // Workers write a byte when they pushed results
+    struct dns_task pause;          // Pushed as is to pause a worker
+    bool paused;
+    dns_send_fn send;
+    dns_changed_fn changed;
+    void *arg;
+    uint32_t dropped;               // Requests dropped because a worker was too far behind
+};
+
+// An empty reply to a batched DNS request, with the same request id
+struct packet *dns_reply_start(int server_id, struct packet *req, int type);
+
+// When a lease given now ends
+uint32_t dns_lease_expiry(struct dns_db *db);
+
+// Append the lease to a registration or renewal reply, after its statuses
+void dns_reply_add_lease(struct packet *reply);
+
+// Reply type of a PKT_DNS_REGISTER, PKT_DNS_RENEW or PKT_DNS_UNREGISTER
+int dns_update_reply_type(int type);
+
+// Register, renew or unregister one name for host id as the request type says, returns its DNS_REG_ status.
+// *changed is set if the table changed, which then has to be logged.
+char dns_update_name(struct dns_db *db, int type, const char *name, int len, int id, uint32_t expires,
+                     bool *changed);
+
+// Answer the names of a PKT_DNS_LOOKUP whose bits are set in records, sending each reply as it fills
+void dns_answer_lookups(struct dns_db *db, int server_id, struct packet *req, uint64_t records,
+                        dns_send_fn send, void *arg);
+
+// Start a worker for every shard of db
+bool dns_pool_start(struct dns_pool *pool, struct dns_db *db, int server_id, dns_send_fn send,
+                    dns_changed_fn changed, void *arg);
+
+// Hand a PKT_DNS_LOOKUP, PKT_DNS_REGISTER, PKT_DNS_RENEW or PKT_DNS_UNREGISTER to the workers,
+// returns false if it has to be dropped
+bool dns_pool_submit(struct dns_pool *pool, struct packet *pkt);
+
+// Wake the workers given tasks since the last call
+void dns_pool_wake(struct dns_pool *pool);
+
+// Readable when there are results to collect
+int dns_pool_fd(struct dns_pool *pool);
+
+// True if results are waiting
+bool dns_pool_busy(struct dns_pool *pool);
+
+// Have every worker sweep expired names from its shard once it is idle
+void dns_pool_sweep(struct dns_pool *pool);
+
+// Send the replies of the tasks done, and log the changes they made
+void dns_pool_collect(struct dns_pool *pool);
+
+// Stop every worker between tasks, so the whole table may be used; does nothing if they are stopped
+void dns_pool_pause(struct dns_pool *pool);
+void dns_pool_resume(struct dns_pool *pool);
+
+#endif //NETWORK_SIMULATOR_02_DNS_POOL_H
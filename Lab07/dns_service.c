@@ -0,0 +1,307 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file dns_service.c
+/// @version 1.0
+///
+/// The DNS service of a server node: lookups, registrations and pattern
+/// queries over the name table, kept on disk by a snapshot and a log and
+/// replicated to the other servers. See service.h for how it is run.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "service.h"
+#include "server.h"
+#include "dns_db.h"
+#include "dns_wal.h"
+#include "dns_pool.h"
+#include "replica.h"
+#include "clock.h"
+
+struct dns_state {
+    struct server *srv;
+    int id;
+
+    // Each server keeps its own files
+    char snapshot_file[64];
+    char wal_file[64];
+    struct dns_db name_table;
+    struct dns_wal wal;
+    struct replication rep;     // Keeps the other DNS servers up to date
+
+    // Lookups and registrations go to a worker per shard of the table, if there are workers
+    struct dns_pool pool;
+    bool use_pool;
+
+    uint32_t requests;          // DNS requests since the last beacon
+    uint32_t beacon_ms;
+    uint32_t sweep_ms;
+    uint64_t cpu_us;            // CPU time used at the last beacon
+    bool warm;                  // Every snapshot name is in the trie
+    bool sweep_more;            // The last sweep found many expired names
+};
+
+static void send_packet(void *arg, struct packet *pkt) {
+    server_send(((struct dns_state *) arg)->srv, pkt);
+}
+
+// A change a registration made goes to the log and the other servers before it is answered
+static void log_change(void *arg, char op, const char *name, int len, int id, uint32_t expires) {
+    struct dns_state *dns = (struct dns_state *) arg;
+
+    dns_wal_append(&dns->wal, op, name, len, id, expires);
+    replication_log(&dns->rep, op, name, len, id, expires);
+}
+
+// Append one match to a PKT_DNS_QUERY_REPLY while there is room
+static bool add_match(void *arg, const char *name, int id) {
+    struct packet *reply = (struct packet *) arg;
+    int len = (int) strlen(name);
+
+    if (reply->length + 2 + len > PAYLOAD_MAX) return false;
+    reply->payload[reply->length] = (char) id;
+    reply->payload[reply->length + 1] = (char) len;
+    memcpy(reply->payload + reply->length + 2, name, len);
+    reply->length += 2 + len;
+    reply->payload[PKT_DNS_MATCH_COUNT]++;
+    return true;
+}
+
+// Tell every host this server is up and how busy it is
+static void send_beacon(struct dns_state *dns, uint32_t load, uint32_t names, uint32_t cpu) {
+    struct packet *pkt = server_packet(dns->srv, BROADCAST_ID, PKT_DNS_BEACON);
+
+    memcpy(pkt->payload + PKT_DNS_BEACON_LOAD, &load, sizeof(uint32_t));
+    memcpy(pkt->payload + PKT_DNS_BEACON_NAMES, &names, sizeof(uint32_t));
+    memcpy(pkt->payload + PKT_DNS_BEACON_CPU, &cpu, sizeof(uint32_t));
+    pkt->length = PKT_DNS_BEACON_LENGTH;
+    server_send(dns->srv, pkt);
+}
+
+// Milliseconds left of a period that started at since
+static int until(uint32_t now, uint32_t since, uint32_t period) {
+    return now - since >= period ? 0 : (int) (period - (now - since));
+}
+
+static void *dns_start(struct server *srv) {
+    struct dns_state *dns = (struct dns_state *) calloc(1, sizeof(struct dns_state));
+    uint32_t now = clock_ms();
+
+    dns->srv = srv;
+    dns->id = server_id(srv);
+
+    // Map the last snapshot and replay the log after it
+    snprintf(dns->snapshot_file, sizeof(dns->snapshot_file), DNS_SNAPSHOT_FILE, dns->id);
+    snprintf(dns->wal_file, sizeof(dns->wal_file), DNS_WAL_FILE, dns->id);
+    dns_db_init(&dns->name_table, DNS_WORKERS > 0 ? DNS_WORKERS : 1);
+    dns_db_set_time(&dns->name_table, (uint32_t) time(NULL));
+    dns_db_load_snapshot(&dns->name_table, dns->snapshot_file);
+    if (!dns_wal_open(&dns->wal, dns->wal_file, &dns->name_table)) {
+        fprintf(stderr, "DNS server: cannot open %s, registrations will not be kept\n", dns->wal_file);
+    }
+    replication_init(&dns->rep, dns->id, send_packet, dns);
+
+    if (DNS_WORKERS > 0) {
+        dns->use_pool = dns_pool_start(&dns->pool, &dns->name_table, dns->id, send_packet, log_change, dns);
+        if (!dns->use_pool) fprintf(stderr, "DNS server: cannot start the workers\n");
+    }
+
+    dns->warm = dns->use_pool;      // The workers fill the tries of their own shards
+    dns->sweep_ms = now;
+    dns->beacon_ms = now - DNS_BEACON_MS;
+    dns->cpu_us = clock_cpu_us();
+    return dns;
+}
+
+// One status per record, in the order of the request, then the lease
+static void update_names(struct dns_state *dns, struct packet *pkt) {
+    struct packet *reply = dns_reply_start(dns->id, pkt, dns_update_reply_type(pkt->type));
+    uint32_t expires = dns_lease_expiry(&dns->name_table);
+    int count = (unsigned char) pkt->payload[PKT_DNS_COUNT];
+    int pos = PKT_DNS_RECORDS;
+    int id = (int) (unsigned char) pkt->src;
+    bool changed;
+    char *name;
+    int k, n;
+
+    for (k = 0; k < count && pos < pkt->length; k++) {
+        n = (unsigned char) pkt->payload[pos];
+        if (pos + 1 + n > pkt->length) break;
+        name = pkt->payload + pos + 1;
+        reply->payload[reply->length++] = dns_update_name(&dns->name_table, pkt->type, name, n, id, expires, &changed);
+        if (changed) {
+            log_change(dns, pkt->type == (char) PKT_DNS_UNREGISTER ? DNS_WAL_REMOVE : DNS_WAL_ADD, name, n, id,
+                       expires);
+        }
+        reply->payload[PKT_DNS_COUNT]++;
+        pos += 1 + n;
+    }
+    if (pkt->type != (char) PKT_DNS_UNREGISTER) dns_reply_add_lease(reply);
+    server_send(dns->srv, reply);
+}
+
+// Walks only the labels the pattern names, across every shard
+static void query(struct dns_state *dns, struct packet *pkt) {
+    struct packet *reply;
+    uint32_t ttl = DNS_TTL;
+    uint16_t skip;
+    bool more;
+
+    if (pkt->length < (int) PKT_DNS_QUERY_PATTERN) return;
+    memcpy(&skip, pkt->payload + PKT_DNS_QUERY_SKIP, sizeof(uint16_t));
+
+    reply = server_packet(dns->srv, (int) (unsigned char) pkt->src, PKT_DNS_QUERY_REPLY);
+    memcpy(reply->payload + PKT_DNS_MATCH_SKIP, &skip, sizeof(uint16_t));
+    reply->payload[PKT_DNS_MATCH_COUNT] = 0;
+    memcpy(reply->payload + PKT_DNS_MATCH_TTL, &ttl, sizeof(uint32_t));
+    reply->length = (int) PKT_DNS_MATCH_LIST;
+
+    if (dns->use_pool) dns_pool_pause(&dns->pool);
+    dns_db_match(&dns->name_table, pkt->payload + PKT_DNS_QUERY_PATTERN, pkt->length - (int) PKT_DNS_QUERY_PATTERN,
+                 skip, add_match, reply, &more);
+    reply->payload[PKT_DNS_MATCH_MORE] = (char) more;
+    server_send(dns->srv, reply);
+}
+
+static void dns_recv(void *state, struct packet *pkt) {
+    struct dns_state *dns = (struct dns_state *) state;
+
+    switch (pkt->type) {
+        case (char) PKT_DNS_REGISTER:
+        case (char) PKT_DNS_RENEW:
+        case (char) PKT_DNS_UNREGISTER:
+        case (char) PKT_DNS_LOOKUP: {
+            dns->requests++;
+            if (dns->use_pool) {
+                // A worker too far behind means the request is dropped, the host asks again
+                if (!dns_pool_submit(&dns->pool, pkt)) free(pkt);
+                return;
+            }
+            if (pkt->type == (char) PKT_DNS_LOOKUP) {
+                dns_answer_lookups(&dns->name_table, dns->id, pkt, UINT64_MAX, send_packet, dns);
+            } else {
+                update_names(dns, pkt);
+            }
+            break;
+        }
+        case (char) PKT_DNS_QUERY: {
+            dns->requests++;
+            query(dns, pkt);
+            break;
+        }
+        case (char) PKT_DNS_REPLICATE: {
+            if (dns->use_pool) dns_pool_pause(&dns->pool);
+            replication_recv(&dns->rep, &dns->name_table, &dns->wal, pkt);
+            break;
+        }
+        case (char) PKT_DNS_REPLICATE_ACK: {
+            replication_recv_ack(&dns->rep, pkt);
+            break;
+        }
+        default:
+            break;
+    }
+    free(pkt);
+}
+
+static void dns_tick(void *state, uint32_t now) {
+    struct dns_state *dns = (struct dns_state *) state;
+    uint64_t cpu;
+
+    // Replies the workers have ready
+    dns_db_set_time(&dns->name_table, (uint32_t) time(NULL));
+    if (dns->use_pool) {
+        dns_pool_collect(&dns->pool);
+        if (replication_wants_table(&dns->rep)) dns_pool_pause(&dns->pool);
+    }
+    replication_tick(&dns->rep, &dns->name_table);
+
+    // Requests per second and CPU use go out in the beacon, hosts use it to pick the least loaded server
+    if (now - dns->beacon_ms >= DNS_BEACON_MS) {
+        cpu = clock_cpu_us();
+        send_beacon(dns, dns->requests * 1000 / (now - dns->beacon_ms), dns_db_names(&dns->name_table),
+                    (uint32_t) ((cpu - dns->cpu_us) / (now - dns->beacon_ms)));
+        dns->requests = 0;
+        dns->beacon_ms = now;
+        dns->cpu_us = cpu;
+    }
+
+    // Fill the trie from the snapshot in the background
+    if (!dns->warm) dns->warm = dns_db_warm(&dns->name_table, DNS_WARM_NAMES);
+
+    // Give back the memory of expired names a little at a time, the workers each sweep their own shard
+    if (now - dns->sweep_ms >= DNS_SWEEP_MS || dns->sweep_more) {
+        dns->sweep_ms = now;
+        if (dns->use_pool) {
+            dns_pool_sweep(&dns->pool);
+        } else {
+            dns->sweep_more = dns_db_sweep(&dns->name_table, DNS_SWEEP_NAMES) >= DNS_SWEEP_NAMES / 4;
+        }
+    }
+
+    // Fold a long log into a new snapshot
+    if (dns->wal.size >= DNS_WAL_COMPACT) {
+        if (dns->use_pool) dns_pool_pause(&dns->pool);
+        if (dns_db_write_snapshot(&dns->name_table, dns->snapshot_file)) dns_wal_reset(&dns->wal);
+    }
+}
+
+// The workers only stop for as long as the table is used as a whole
+static void dns_flush(void *state) {
+    struct dns_state *dns = (struct dns_state *) state;
+
+    if (!dns->use_pool) return;
+    dns_pool_wake(&dns->pool);
+    dns_pool_resume(&dns->pool);
+}
+
+static int dns_wait_ms(void *state, uint32_t now) {
+    struct dns_state *dns = (struct dns_state *) state;
+    int timeout = until(now, dns->beacon_ms, DNS_BEACON_MS);
+    int n;
+
+    if (until(now, dns->sweep_ms, DNS_SWEEP_MS) < timeout) timeout = until(now, dns->sweep_ms, DNS_SWEEP_MS);
+    n = replication_wait_ms(&dns->rep);
+    if (n >= 0 && n < timeout) timeout = n;
+    if (!dns->warm || dns->sweep_more || (dns->use_pool && dns_pool_busy(&dns->pool))) timeout = 0;
+    return timeout;
+}
+
+// Readable when the workers have replies
+static int dns_fd(void *state) {
+    struct dns_state *dns = (struct dns_state *) state;
+
+    return dns->use_pool ? dns_pool_fd(&dns->pool) : -1;
+}
+
+static int dns_report(void *state, char *buf, int size) {
+    struct dns_state *dns = (struct dns_state *) state;
+
+    return snprintf(buf, size, "dns: %u names in %d shards, %u requests since the last beacon%s\n",
+                    dns_db_names(&dns->name_table), dns->name_table.num_shards, dns->requests,
+                    dns->use_pool ? ", workers running" : "");
+}
+
+const struct service dns_service = {
+    .name = "dns",
+    .types = {{PKT_DNS_REGISTER, PKT_DNS_LOOKUP_REPLY},
+              {PKT_DNS_QUERY, PKT_DNS_QUERY_REPLY},
+              {PKT_DNS_REPLICATE, PKT_DNS_RENEW_REPLY}},
+    .start = dns_start,
+    .recv = dns_recv,
+    .tick = dns_tick,
+    .flush = dns_flush,
+    .wait_ms = dns_wait_ms,
+    .fd = dns_fd,
+    .report = dns_report,
+};
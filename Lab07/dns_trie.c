@@ -0,0 +1,249 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file dns_trie.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dns_trie.h"
+#include "crc32c.h"
+
+// Where a query is in its walk of the tree
+struct match_state {
+    const char *labels[DNS_MAX_LABELS];
+    int lens[DNS_MAX_LABELS];
+    int skip;
+    int seen;
+    int reported;
+    bool more;
+    dns_match_fn fn;
+    void *arg;
+};
+
+void dns_trie_init(struct dns_trie *trie) {
+    memset(trie, 0, sizeof(struct dns_trie));
+    trie->root.id = -1;
+}
+
+// Split name into its labels, left to right. Returns the number of labels, -1 if there are too many.
+static int split_labels(const char *name, int len, const char *labels[], int lens[]) {
+    int count = 0;
+    int start = 0;
+
+    for (int i = 0; i <= len; i++) {
+        if (i == len || name[i] == '.') {
+            if (count == DNS_MAX_LABELS) return -1;
+            labels[count] = name + start;
+            lens[count] = i - start;
+            count++;
+            start = i + 1;
+        }
+    }
+    return count;
+}
+
+static bool label_valid(const char *label, int len) {
+    if (len < 1 || len > DNS_MAX_LABEL) return false;
+    for (int i = 0; i < len; i++) {
+        if (!isalnum((unsigned char) label[i]) && label[i] != '-' && label[i] != '_') return false;
+    }
+    return true;
+}
+
+bool dns_name_valid(const char *name, int len) {
+    const char *labels[DNS_MAX_LABELS];
+    int lens[DNS_MAX_LABELS];
+    int count = split_labels(name, len, labels, lens);
+
+    if (count < 1) return false;
+    for (int i = 0; i < count; i++) {
+        if (!label_valid(labels[i], lens[i])) return false;
+    }
+    return true;
+}
+
+static struct trie_node *find_child(struct trie_node *node, const char *label, int len, uint32_t hash) {
+    struct trie_node *c;
+
+    if (node->num_buckets == 0) return NULL;
+    for (c = node->children[hash & (node->num_buckets - 1)]; c != NULL; c = c->next) {
+        if (c->hash == hash && c->len == len && memcmp(c->label, label, len) == 0) return c;
+    }
+    return NULL;
+}
+
+static void link_child(struct trie_node **buckets, uint32_t num_buckets, struct trie_node *c) {
+    c->next = buckets[c->hash & (num_buckets - 1)];
+    buckets[c->hash & (num_buckets - 1)] = c;
+}
+
+// Double the child buckets of node once it has more children than buckets
+static void grow_children(struct trie_node *node) {
+    uint32_t new_num = node->num_buckets == 0 ? DNS_TRIE_MIN_BUCKETS : node->num_buckets * 2;
+    struct trie_node **new_buckets = (struct trie_node **) calloc(new_num, sizeof(struct trie_node *));
+    struct trie_node *c, *next;
+
+    if (new_buckets == NULL) return;
+    for (uint32_t b = 0; b < node->num_buckets; b++) {
+        for (c = node->children[b]; c != NULL; c = next) {
+            next = c->next;
+            link_child(new_buckets, new_num, c);
+        }
+    }
+    free(node->children);
+    node->children = new_buckets;
+    node->num_buckets = new_num;
+}
+
+static struct trie_node *add_child(struct trie_node *node, const char *label, int len, uint32_t hash) {
+    struct trie_node *c = (struct trie_node *) calloc(1, sizeof(struct trie_node));
+
+    c->label = (char *) malloc(len);
+    memcpy(c->label, label, len);
+    c->len = len;
+    c->hash = hash;
+    c->id = -1;
+    c->parent = node;
+
+    if (node->num_children >= node->num_buckets) grow_children(node);
+    link_child(node->children, node->num_buckets, c);
+    node->num_children++;
+    return c;
+}
+
+// Node for name, creating the missing labels when create is set
+static struct trie_node *find_node(struct dns_trie *trie, const char *name, int len, bool create) {
+    const char *labels[DNS_MAX_LABELS];
+    int lens[DNS_MAX_LABELS];
+    struct trie_node *node = &trie->root;
+    struct trie_node *c;
+    int count = split_labels(name, len, labels, lens);
+    uint32_t hash;
+
+    if (count < 1) return NULL;
+    for (int i = count - 1; i >= 0; i--) {
+        hash = crc32c(labels[i], lens[i]);
+        c = find_child(node, labels[i], lens[i], hash);
+        if (c == NULL) {
+            if (!create) return NULL;
+            c = add_child(node, labels[i], lens[i], hash);
+        }
+        node = c;
+    }
+    return node;
+}
+
+void dns_trie_insert(struct dns_trie *trie, const char *name, int len, int id) {
+    struct trie_node *node = find_node(trie, name, len, true);
+
+    if (node == NULL) return;
+    if (node->name == NULL) {
+        node->name = (char *) malloc(len + 1);
+        memcpy(node->name, name, len);
+        node->name[len] = '\0';
+    }
+    node->id = id;
+}
+
+void dns_trie_remove(struct dns_trie *trie, const char *name, int len) {
+    struct trie_node *node = find_node(trie, name, len, false);
+    struct trie_node *parent;
+    struct trie_node **cp;
+
+    if (node == NULL) return;
+    free(node->name);
+    node->name = NULL;
+    node->id = -1;
+
+    // Drop the labels nothing is registered under any more
+    while (node != &trie->root && node->id < 0 && node->num_children == 0) {
+        parent = node->parent;
+        cp = &parent->children[node->hash & (parent->num_buckets - 1)];
+        while (*cp != node) cp = &(*cp)->next;
+        *cp = node->next;
+        parent->num_children--;
+
+        free(node->children);
+        free(node->label);
+        free(node);
+        node = parent;
+    }
+}
+
+static void emit(struct match_state *st, struct trie_node *node) {
+    if (st->seen++ < st->skip) return;
+    if (!st->fn(st->arg, node->name, node->id)) {
+        st->more = true;
+        return;
+    }
+    st->reported++;
+}
+
+// Every name below node
+static void walk_subtree(struct match_state *st, struct trie_node *node) {
+    struct trie_node *c;
+
+    for (uint32_t b = 0; b < node->num_buckets && !st->more; b++) {
+        for (c = node->children[b]; c != NULL && !st->more; c = c->next) {
+            if (c->id >= 0) emit(st, c);
+            walk_subtree(st, c);
+        }
+    }
+}
+
+// Match pattern labels [0, i] against the names below node
+static void walk(struct match_state *st, struct trie_node *node, int i) {
+    struct trie_node *c;
+
+    if (st->more) return;
+    if (i < 0) {
+        if (node->id >= 0) emit(st, node);
+        return;
+    }
+
+    if (i == 0 && st->lens[0] == 2 && memcmp(st->labels[0], "**", 2) == 0) {
+        walk_subtree(st, node);
+    } else if (st->lens[i] == 1 && st->labels[i][0] == '*') {
+        for (uint32_t b = 0; b < node->num_buckets; b++) {
+            for (c = node->children[b]; c != NULL; c = c->next) {
+                walk(st, c, i - 1);
+            }
+        }
+    } else {
+        c = find_child(node, st->labels[i], st->lens[i], crc32c(st->labels[i], st->lens[i]));
+        if (c != NULL) walk(st, c, i - 1);
+    }
+}
+
+int dns_trie_match(struct dns_trie *trie, const char *pattern, int len, int skip,
+                   dns_match_fn fn, void *arg, bool *more) {
+    struct match_state st;
+    int count;
+
+    memset(&st, 0, sizeof(st));
+    *more = false;
+    count = split_labels(pattern, len, st.labels, st.lens);
+    if (count < 1) return 0;
+
+    // Only "*" labels and a leading "**" may stand in for real ones
+    for (int i = 0; i < count; i++) {
+        bool any = st.lens[i] == 1 && st.labels[i][0] == '*';
+        bool all = i == 0 && st.lens[i] == 2 && memcmp(st.labels[i], "**", 2) == 0;
+        if (!any && !all && !label_valid(st.labels[i], st.lens[i])) return 0;
+    }
+
+    st.skip = skip;
+    st.fn = fn;
+    st.arg = arg;
+    walk(&st, &trie->root, count - 1);
+    *more = st.more;
+    return st.reported;
+}
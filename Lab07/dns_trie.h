@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file dns_trie.h
+/// @version 1.0
+///
+/// Domain names as a tree of labels, rightmost label first, so
+/// "web.rack1.dc" is stored under dc -> rack1 -> web. Each node hashes
+/// its children, and a query only visits the nodes its labels name:
+///
+///   web.rack1.dc      exactly that name
+///   web.*.dc          "*" matches any one label
+///   **.rack1.dc       a leading "**" matches every name below rack1.dc
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_DNS_TRIE_H
+#define NETWORK_SIMULATOR_02_DNS_TRIE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DNS_MAX_LABEL       63
+#define DNS_MAX_LABELS      64
+#define DNS_TRIE_MIN_BUCKETS 4
+
+struct trie_node {
+    char *label;
+    int len;
+    uint32_t hash;
+    int id;                         // -1 if no name ends here
+    char *name;                     // Full name when id >= 0
+    struct trie_node *parent;
+    struct trie_node *next;         // Same bucket of the parent
+    struct trie_node **children;
+    uint32_t num_buckets;           // Power of two, 0 until the first child
+    uint32_t num_children;
+};
+
+struct dns_trie {
+    struct trie_node root;
+};
+
+// Called for every name a query matches, returns false when there is no room for more
+typedef bool (*dns_match_fn)(void *arg, const char *name, int id);
+
+void dns_trie_init(struct dns_trie *trie);
+
+// True if name is a valid host name: dot separated labels of letters, digits, '-' and '_'
+bool dns_name_valid(const char *name, int len);
+
+void dns_trie_insert(struct dns_trie *trie, const char *name, int len, int id);
+void dns_trie_remove(struct dns_trie *trie, const char *name, int len);
+
+// Report the matches of pattern after skipping the first skip of them, until fn has no room.
+// Returns the number reported, *more is set if there were others after them.
+int dns_trie_match(struct dns_trie *trie, const char *pattern, int len, int skip,
+                   dns_match_fn fn, void *arg, bool *more);
+
+#endif //NETWORK_SIMULATOR_02_DNS_TRIE_H
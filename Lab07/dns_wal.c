@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file dns_wal.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "dns_wal.h"
+#include "crc32c.h"
+
+// Apply the records in buf to db, returns the length of the part that was whole
+static uint64_t replay(const unsigned char *buf, uint64_t size, struct dns_db *db, uint32_t *records) {
+    uint64_t pos = 0;
+    uint32_t crc, expires;
+    const char *name;
+    int len, id;
+
+    while (pos + DNS_WAL_HEADER <= size) {
+        len = buf[pos + 6];
+        if (pos + DNS_WAL_HEADER + len > size) break;
+        memcpy(&crc, buf + pos, sizeof(uint32_t));
+        if (crc != crc32c(buf + pos + 4, DNS_WAL_HEADER - 4 + len)) break;
+        memcpy(&expires, buf + pos + 7, sizeof(uint32_t));
+        name = (const char *) buf + pos + DNS_WAL_HEADER;
+        id = buf[pos + 5];
+
+        // Adding a name the host already holds renews it
+        if (buf[pos + 4] == DNS_WAL_ADD) {
+            if (!dns_db_insert(db, name, len, id, expires)) dns_db_renew(db, name, len, id, expires);
+        } else if (buf[pos + 4] == DNS_WAL_REMOVE) {
+            dns_db_remove(db, name, len);
+        }
+        pos += DNS_WAL_HEADER + len;
+        (*records)++;
+    }
+    return pos;
+}
+
+bool dns_wal_open(struct dns_wal *wal, const char *path, struct dns_db *db) {
+    unsigned char *buf = NULL;
+    struct stat st;
+    uint64_t done = 0;
+    ssize_t n;
+
+    memset(wal, 0, sizeof(struct dns_wal));
+    wal->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (wal->fd < 0) return false;
+
+    if (fstat(wal->fd, &st) == 0 && st.st_size > 0) {
+        buf = (unsigned char *) malloc(st.st_size);
+        while (buf != NULL && done < (uint64_t) st.st_size) {
+            n = read(wal->fd, buf + done, st.st_size - done);
+            if (n <= 0) break;
+            done += n;
+        }
+        if (buf != NULL) wal->size = replay(buf, done, db, &wal->records);
+        free(buf);
+
+        // Whatever follows the last whole record was cut short by a crash
+        if (wal->size < (uint64_t) st.st_size && ftruncate(wal->fd, (off_t) wal->size) < 0) {
+            close(wal->fd);
+            wal->fd = -1;
+            return false;
+        }
+    }
+    lseek(wal->fd, (off_t) wal->size, SEEK_SET);
+    return true;
+}
+
+bool dns_wal_append(struct dns_wal *wal, char op, const char *name, int len, int id, uint32_t expires) {
+    unsigned char rec[DNS_WAL_HEADER + 255];
+    uint32_t crc;
+
+    if (wal->fd < 0 || len < 0 || len > 255) return false;
+    rec[4] = (unsigned char) op;
+    rec[5] = (unsigned char) id;
+    rec[6] = (unsigned char) len;
+    memcpy(rec + 7, &expires, sizeof(uint32_t));
+    memcpy(rec + DNS_WAL_HEADER, name, len);
+    crc = crc32c(rec + 4, DNS_WAL_HEADER - 4 + len);
+    memcpy(rec, &crc, sizeof(uint32_t));
+
+    // One write per record, so a crash can only tear the last one
+    if (write(wal->fd, rec, DNS_WAL_HEADER + len) != DNS_WAL_HEADER + len) {
+        if (ftruncate(wal->fd, (off_t) wal->size) == 0) lseek(wal->fd, (off_t) wal->size, SEEK_SET);
+        return false;
+    }
+    wal->size += DNS_WAL_HEADER + len;
+    wal->records++;
+    return true;
+}
+
+void dns_wal_reset(struct dns_wal *wal) {
+    if (wal->fd < 0) return;
+    if (ftruncate(wal->fd, 0) == 0) {
+        lseek(wal->fd, 0, SEEK_SET);
+        wal->size = 0;
+        wal->records = 0;
+    }
+}
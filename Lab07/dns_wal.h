@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file dns_wal.h
+/// @version 1.0
+///
+/// Write-ahead log of the DNS server. Every change to the name table is
+/// appended as a record before it is answered:
+///
+///   [crc32c of the rest][op][host id][name length][expiry][name]
+///
+/// A renewed lease is logged as another add of the same name and host.
+/// Names that expire are not logged, their expiry is in their add.
+///
+/// On start the log is replayed over the snapshot; a torn last record is
+/// cut off. Once the log grows past a limit the server writes a new
+/// snapshot and empties the log.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_DNS_WAL_H
+#define NETWORK_SIMULATOR_02_DNS_WAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dns_db.h"
+
+#define DNS_WAL_ADD         'A'
+#define DNS_WAL_REMOVE      'R'
+
+#define DNS_WAL_HEADER      11      /* crc, op, id, length, expiry */
+
+struct dns_wal {
+    int fd;                         // -1 if the log could not be opened
+    uint64_t size;
+    uint32_t records;
+};
+
+// Replay the log at path into db and open it for appending
+bool dns_wal_open(struct dns_wal *wal, const char *path, struct dns_db *db);
+
+// Log one change, returns false if it could not be written
+bool dns_wal_append(struct dns_wal *wal, char op, const char *name, int len, int id, uint32_t expires);
+
+// Empty the log, once a snapshot holds everything in it
+void dns_wal_reset(struct dns_wal *wal);
+
+#endif //NETWORK_SIMULATOR_02_DNS_WAL_H
@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file echo_service.c
+/// @version 1.0
+///
+/// Answers pings and sends back whatever an echo request carries.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "service.h"
+
+static void *echo_start(struct server *srv) {
+    return srv;
+}
+
+static void echo_recv(void *state, struct packet *pkt) {
+    struct server *srv = (struct server *) state;
+    struct packet *reply;
+
+    if (pkt->type == (char) PKT_PING_REQ || pkt->type == (char) PKT_ECHO_REQ) {
+        reply = server_packet(srv, (int) (unsigned char) pkt->src,
+                              pkt->type == (char) PKT_PING_REQ ? PKT_PING_REPLY : PKT_ECHO_REPLY);
+        if (pkt->length > 0 && pkt->length <= PAYLOAD_MAX) {
+            memcpy(reply->payload, pkt->payload, pkt->length);
+            reply->length = pkt->length;
+        }
+        server_send(srv, reply);
+    }
+    free(pkt);
+}
+
+const struct service echo_service = {
+    .name = "echo",
+    .types = {{PKT_PING_REQ, PKT_PING_REPLY},
+              {PKT_ECHO_REQ, PKT_ECHO_REQ + 7}},
+    .start = echo_start,
+    .recv = echo_recv,
+};
@@ -19,154 +19,261 @@
 #include "host.h"
 #include "packet.h"
 #include "main.h"
+#include "transfer.h"
+#include "resolver.h"
+#include "ports.h"
+#include "metrics.h"
+#include "trace.h"
+#include "traffic.h"
+#include "ping.h"
+#include "clock.h"
 
-#define MAX_FILE_BUFFER 1000
 #define MAX_MSG_LENGTH  100
 #define MAX_DIR_NAME    100
 #define MAX_FILE_NAME   100
 #define PKT_PAYLOAD_MAX 100
 #define PING_TIMER      100
 
-/* Types of packets */
-
-struct file_buf {
-    char name[MAX_FILE_NAME];
-    int name_length;
-    char buffer[MAX_FILE_BUFFER + 1];
-    int head;
-    int tail;
-    int occ;
-    FILE *fd;
-};
-
-
 /*
- * File buffer operations
+ * Operations with the manager
  */
 
-/* Initialize file buffer data structure */
-void file_buf_init(struct file_buf *f) {
-    f->head = 0;
-    f->tail = MAX_FILE_BUFFER;
-    f->occ = 0;
-    f->name_length = 0;
-}
-
-/* 
- * Get the file name in the file buffer and store it in name 
- * Terminate the string in name with tne null character
- */
-void file_buf_get_name(struct file_buf *f, char name[]) {
-    int i;
-
-    for (i = 0; i < f->name_length; i++) {
-        name[i] = f->name[i];
-    }
-    name[f->name_length] = '\0';
-}
-
 /*
- *  Put name[] into the file name in the file buffer
- *  length = the length of name[]
+ * Commands from the menu come one per write. The scripted manager tags
+ * each with a request id, "#<id> <command>\n", and may send several in
+ * one go; they are taken one per call.
+ * Returns the length of the command, 0 if there is none.
  */
-void file_buf_put_name(struct file_buf *f, char name[], int length) {
+int get_man_command(struct man_port_at_host *port, char msg[], char *c, uint32_t *tag) {
+    static char buf[MAN_MSG_LENGTH];
+    static int len = 0;
+    char *end;
+    int n;
     int i;
+    int k;
 
-    for (i = 0; i < length; i++) {
-        f->name[i] = name[i];
+    *tag = 0;
+    if (len == 0 || (buf[0] == '#' && memchr(buf, '\n', len) == NULL)) {
+        n = read(port->recv_fd, buf + len, MAN_MSG_LENGTH - 1 - len); /* Get command from manager */
+        if (n > 0) len += n;
+    }
+    if (len == 0) return 0;
+
+    end = memchr(buf, '\n', len);
+    if (end != NULL) {
+        n = (int) (end - buf);
+        k = n + 1;
+    } else if (buf[0] == '#' && len < MAN_MSG_LENGTH - 1) {
+        return 0;   /* The rest of the line is still to come */
+    } else {
+        n = len;
+        k = len;
     }
-    f->name_length = length;
+    memcpy(msg, buf, n);
+    msg[n] = '\0';
+    memmove(buf, buf + k, len - k);
+    len -= k;
+
+    i = 0;
+    if (msg[0] == '#') {
+        *tag = (uint32_t) strtoul(msg + 1, NULL, 10);
+        for (i = 1; i < n && msg[i] != ' '; i++);
+    }
+    for (; msg[i] == ' ' && i < n; i++);
+    *c = msg[i];
+    i++;
+    for (; msg[i] == ' ' && i < n; i++);
+    for (k = 0; k + i < n; k++) {
+        msg[k] = msg[k + i];
+    }
+    msg[k] = '\0';
+    return n;
 }
 
-/*
- *  Add 'length' bytes n string[] to the file buffer
- */
-int file_buf_add(struct file_buf *f, char string[], int length) {
-    int i = 0;
-
-    while (i < length && f->occ < MAX_FILE_BUFFER) {
-        f->tail = (f->tail + 1) % (MAX_FILE_BUFFER + 1);
-        f->buffer[f->tail] = string[i];
-        i++;
-        f->occ++;
-    }
-    return (i);
+/* Answer a manager command, with the tag of the command in front if it had one */
+void man_reply(struct man_port_at_host *port, uint32_t tag, const char *text, int n) {
+    char msg[MAN_MSG_LENGTH + 16];
+    int k = 0;
+
+    if (n < 0) n = 0;
+    if (n > MAN_MSG_LENGTH - 1) n = MAN_MSG_LENGTH - 1;
+    if (tag != 0) k = snprintf(msg, sizeof(msg), "#%u ", tag);
+    memcpy(msg + k, text, n);
+    msg[k + n] = '\0';
+    write(port->send_fd, msg, k + n + 1);
 }
 
 /*
- *  Remove bytes from the file buffer and store it in string[] 
- *  The number of bytes is length.
+ * Operations requested by the manager
  */
-int file_buf_remove(struct file_buf *f, char string[], int length) {
-    int i = 0;
-
-    while (i < length && f->occ > 0) {
-        string[i] = f->buffer[f->head];
-        f->head = (f->head + 1) % (MAX_FILE_BUFFER + 1);
-        i++;
-        f->occ--;
+
+/* Send back state of the host to the manager as a text message */
+void reply_display_host_state(struct man_port_at_host *port, uint32_t tag, char dir[], bool dir_valid, int host_id,
+                              struct transfer_ctx *xfer, struct resolver *res, struct traffic_gen *gen,
+                              struct ping_table *pings) {
+    int n;
+    char reply_msg[MAN_MSG_LENGTH];
+
+    if (dir_valid) {
+        n = sprintf(reply_msg, "%s %d\n", dir, host_id);
+    } else {
+        n = sprintf(reply_msg, "None %d\n", host_id);
     }
+    n += transfer_report(xfer, reply_msg + n, MAN_MSG_LENGTH - n);
+    n += resolver_report(res, reply_msg + n, MAN_MSG_LENGTH - n);
+    n += traffic_report(gen, reply_msg + n, MAN_MSG_LENGTH - n);
+    n += ping_report(pings, reply_msg + n, MAN_MSG_LENGTH - n);
 
-    return (i);
+    man_reply(port, tag, reply_msg, n);
 }
 
 
-/*
- * Operations with the manager
- */
 
-int get_man_command(struct man_port_at_host *port, char msg[], char *c) {
-
-    int n;
-    int i;
-    int k;
+/* Text for a DNS registration status */
+static const char *dns_register_text(int type, char status) {
+    if (type == PKT_DNS_UNREGISTER) {
+        switch (status) {
+            case DNS_REG_OK:
+                return "Successfully unregistered domain name";
+            case DNS_REG_TOO_LONG:
+            case DNS_REG_UNKNOWN:
+                return "Failed to unregister: Not registered by this host";
+            default:
+                return "Failed to parse DNS unregistration response";
+        }
+    }
+    switch (status) {
+        case DNS_REG_OK:
+            return "Successfully registered domain name";
+        case DNS_REG_TOO_LONG:
+            return "Failed to register: Name too long";
+        case DNS_REG_INVALID:
+            return "Failed to register: Name is Invalid";
+        case DNS_REG_TAKEN:
+            return "Failed to register: Already registered";
+        default:
+            return "Failed to parse DNS registration response";
+    }
+}
 
-    n = read(port->recv_fd, msg, MAN_MSG_LENGTH); /* Get command from manager */
-    if (n > 0) {  /* Remove the first char from "msg" */
-        for (i = 0; msg[i] == ' ' && i < n; i++);
-        *c = msg[i];
-        i++;
-        for (; msg[i] == ' ' && i < n; i++);
-        for (k = 0; k + i < n; k++) {
-            msg[k] = msg[k + i];
+/*
+ * Look up a comma separated list of names, one line per name.
+ * Returns 0 while any of them is still waiting for the server.
+ */
+static int dns_lookup_list(struct resolver *res, const char *list, char *reply, int size) {
+    char names[MAX_DNS_NAME_LENGTH + 1];
+    char *name;
+    char *save;
+    bool pending = false;
+    int id, n = 0;
+
+    // Ask for every name before looking at the answers
+    snprintf(names, sizeof(names), "%s", list);
+    for (name = strtok_r(names, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+        if (resolver_lookup(res, name, &id) == RESOLVE_PENDING) pending = true;
+    }
+    if (pending) return 0;
+
+    snprintf(names, sizeof(names), "%s", list);
+    for (name = strtok_r(names, ",", &save); name != NULL && n < size; name = strtok_r(NULL, ",", &save)) {
+        if (resolver_lookup(res, name, &id) == RESOLVE_FOUND) {
+            n += snprintf(reply + n, size - n, "%s is at %i.\n", name, id);
+        } else {
+            n += snprintf(reply + n, size - n, "%s: DNS lookup failed\n", name);
         }
-        msg[k] = '\0';
     }
+    if (n >= size) n = size - 1;
     return n;
-
 }
 
 /*
- * Operations requested by the manager
+ * Build a key-value request from "<server> <get|put|delete> <key> [value]".
+ * Returns NULL if the text is not one.
  */
-
-/* Send back state of the host to the manager as a text message */
-void reply_display_host_state(struct man_port_at_host *port, char dir[], bool dir_valid, int host_id) {
-    int n;
-    char reply_msg[MAX_MSG_LENGTH];
-
-    if (dir_valid) {
-        n = sprintf(reply_msg, "%s %d", dir, host_id);
+static struct packet *kv_request_packet(int host_id, char *msg, uint16_t req_id) {
+    struct packet *pkt;
+    char op[8];
+    char *key;
+    char *value;
+    char *save;
+    int dst, type;
+    int key_len, value_len = 0;
+    int n = 0;
+
+    if (sscanf(msg, "%d %7s %n", &dst, op, &n) != 2 || n == 0) return NULL;
+    if (strcmp(op, "get") == 0) {
+        type = PKT_KV_GET;
+    } else if (strcmp(op, "put") == 0) {
+        type = PKT_KV_PUT;
+    } else if (strcmp(op, "delete") == 0) {
+        type = PKT_KV_DELETE;
     } else {
-        n = sprintf(reply_msg, "None %d", host_id);
+        return NULL;
     }
+    key = strtok_r(msg + n, " ", &save);
+    if (key == NULL) return NULL;
+    key_len = (int) strlen(key);
+    value = strtok_r(NULL, "", &save);
+    if (type == PKT_KV_PUT) {
+        if (value == NULL) return NULL;
+        value_len = (int) strlen(value);
+    }
+    if (PKT_KV_KEY + key_len + value_len > PAYLOAD_MAX || key_len > 255) return NULL;
+
+    pkt = (struct packet *) calloc(1, sizeof(struct packet));
+    pkt->src = (char) host_id;
+    pkt->dst = (char) dst;
+    pkt->type = (char) type;
+    memcpy(pkt->payload + PKT_KV_REQ_ID, &req_id, sizeof(uint16_t));
+    pkt->payload[PKT_KV_KEY_LENGTH] = (char) key_len;
+    memcpy(pkt->payload + PKT_KV_KEY, key, key_len);
+    if (value_len > 0) memcpy(pkt->payload + PKT_KV_KEY + key_len, value, value_len);
+    pkt->length = PKT_KV_KEY + key_len + value_len;
+    return pkt;
+}
 
-    write(port->send_fd, reply_msg, n);
+/* Text for the answer of a key-value store */
+static int kv_reply_text(struct packet *reply, char *msg, int size) {
+    switch (reply->payload[PKT_KV_STATUS]) {
+        case KV_OK:
+            if (reply->length > PKT_KV_VALUE) {
+                return snprintf(msg, size, "%.*s", reply->length - PKT_KV_VALUE, reply->payload + PKT_KV_VALUE);
+            }
+            return snprintf(msg, size, "Done");
+        case KV_NOT_FOUND:
+            return snprintf(msg, size, "Key not found");
+        case KV_FULL:
+            return snprintf(msg, size, "Failed: the store is full");
+        default:
+            return snprintf(msg, size, "Failed: invalid request");
+    }
 }
 
+/* Send a packet now, bypassing the job queue: on the port its destination was heard on, all ports if it was not */
+static void send_direct(struct port_table *ports, struct net_port **node_port, int node_port_num, struct packet *p) {
+    int k = ports_lookup(ports, p);
 
+    if (k >= 0 && k < node_port_num) {
+        packet_send(node_port[k], p);
+    } else {
+        for (k = 0; k < node_port_num; k++) {
+            packet_send(node_port[k], p);
+        }
+    }
+}
 
 /* Job queue operations */
 
 /* Add a job to the job queue */
 void job_q_add(struct job_queue *j_q, struct host_job *j) {
+    j->next = NULL;
+    j->queued_us = clock_us();
     if (j_q->head == NULL) {
         j_q->head = j;
         j_q->tail = j;
         j_q->occ = 1;
     } else {
         (j_q->tail)->next = j;
-        j->next = NULL;
         j_q->tail = j;
         j_q->occ++;
     }
@@ -180,6 +287,8 @@ struct host_job *job_q_remove(struct job_queue *j_q) {
     j = j_q->head;
     j_q->head = (j_q->head)->next;
     j_q->occ--;
+    metrics_observe(&metrics_self()->job_wait_us, clock_us() - j->queued_us);
+    trace_dequeued(j->packet);
     return (j);
 }
 
@@ -206,32 +315,26 @@ _Noreturn void host_main(int host_id) {
     char man_msg[MAN_MSG_LENGTH];
     char man_reply_msg[MAN_MSG_LENGTH];
     char man_cmd;
+    uint32_t man_tag;                   // Request id of a scripted command, 0 for the menu
     struct man_port_at_host *man_port;  // Port to the manager
 
     struct net_port *node_port_list;
     struct net_port **node_port;  // Array of pointers to node ports
     int node_port_num;            // Number of node ports
 
-    int ping_reply_received;
+    struct packet *kv_reply = NULL;     // Answer to the last key-value request
+    uint16_t kv_req_id = 0;
 
     bool dir_valid = false;
-    bool dns_register_received;
-    bool dns_lookup_received;
 
     int dns_lookup_response;
 
-    char dns_register_buffer[MAX_DNS_NAME_LENGTH];
-    char dns_lookup_buffer[MAX_DNS_NAME_LENGTH];
-
     int i, k, n;
     int dst;
 
     size_t control_count = 0;
 
     char name[MAX_FILE_NAME];
-    char string[PKT_PAYLOAD_MAX + 1];
-
-    FILE *fp;
 
     struct packet *in_packet; /* Incoming packet */
     struct packet *new_packet;
@@ -242,11 +345,13 @@ _Noreturn void host_main(int host_id) {
 
     struct job_queue job_q;
 
-    struct file_buf f_buf_upload;
-    struct file_buf f_buf_download;
-
-    file_buf_init(&f_buf_upload);
-    file_buf_init(&f_buf_download);
+    struct transfer_ctx xfer;   // File uploads and downloads in progress
+    struct resolver res;        // Cached DNS lookups
+    struct port_table ports;    // Port each node was last heard on
+    struct traffic_gen gen;     // Load this host generates
+    struct packet gen_packet;
+    struct ping_table pings;    // Pings this host is sending
+    struct packet ping_packet;
 
 /*
  * Initialize pipes 
@@ -254,6 +359,7 @@ _Noreturn void host_main(int host_id) {
  */
 
     man_port = net_get_host_port(host_id);
+    metrics_set_self(host_id);
 
 /*
  * Create an array node_port[ ] to store the network link ports
@@ -279,6 +385,11 @@ _Noreturn void host_main(int host_id) {
     bool first_loop_done = false;
 /* Initialize the job queue */
     job_q_init(&job_q);
+    transfer_init(&xfer, host_id, dir, &dir_valid, &job_q);
+    resolver_init(&res, host_id, &job_q);
+    ports_init(&ports);
+    traffic_init(&gen, host_id);
+    ping_init(&pings, host_id);
 
     while (true) {
 
@@ -288,7 +399,7 @@ _Noreturn void host_main(int host_id) {
             control_count = 0;
 
             // Create a packet to send
-            new_packet = (struct packet *) malloc(sizeof(struct packet));
+            new_packet = (struct packet *) calloc(1, sizeof(struct packet));
             new_packet->src = (char) host_id;
             new_packet->type = (char) PKT_CONTROL_PKT;
             new_packet->length = PKT_CONTROL_LENGTH;
@@ -299,27 +410,28 @@ _Noreturn void host_main(int host_id) {
             // Create a job to send control packet
             new_job = (struct host_job *) malloc(sizeof(struct host_job));
             new_job->packet = new_packet;
-            new_job->type = JOB_SEND_PKT_ALL_PORTS;
+            new_job->type = JOB_SEND_PKT;
             job_q_add(&job_q, new_job);
         }
 
         /* Execute command from manager, if any */
 
         /* Get command from manager */
-        n = get_man_command(man_port, man_msg, &man_cmd);
+        n = get_man_command(man_port, man_msg, &man_cmd, &man_tag);
 
 
         /* Execute command */
         if (n > 0) {
             switch (man_cmd) {
                 case 's': {
-                    reply_display_host_state(man_port, dir, dir_valid, host_id);
+                    reply_display_host_state(man_port, man_tag, dir, dir_valid, host_id, &xfer, &res, &gen, &pings);
                     break;
                 }
 
                 case 'm': {
                     DIR *directory = opendir(man_msg);
                     if (directory) {
+                        closedir(directory);
                         dir_valid = true;
                         for (i = 0; man_msg[i] != '\0' && i < MAX_DIR_NAME; i++) {
                             dir[i] = man_msg[i];
@@ -328,144 +440,144 @@ _Noreturn void host_main(int host_id) {
                     } else if (ENONET == errno) {
                         dir_valid = false;
                     }
+
+                    // The menu expects no answer, a scripted manager waits for one
+                    if (man_tag != 0) {
+                        n = directory ? snprintf(man_reply_msg, MAN_MSG_LENGTH, "Directory %s", dir)
+                                      : snprintf(man_reply_msg, MAN_MSG_LENGTH, "Invalid directory %s", man_msg);
+                        man_reply(man_port, man_tag, man_reply_msg, n);
+                    }
                     break;
                 }
 
                 case 'p': {
-                    // Sending ping request
-                    // Create new ping request packet
-                    sscanf(man_msg, "%d", &dst);
-                    new_packet = (struct packet *) malloc(sizeof(struct packet));
-                    new_packet->src = (char) host_id;
-                    new_packet->dst = (char) dst;
-                    new_packet->type = (char) PKT_PING_REQ;
-                    new_packet->length = 0;
-                    new_job = (struct host_job *) malloc(sizeof(struct host_job));
-                    new_job->packet = new_packet;
-                    new_job->type = JOB_SEND_PKT_ALL_PORTS;
-                    job_q_add(&job_q, new_job);
-
-                    new_job2 = (struct host_job *) malloc(sizeof(struct host_job));
-                    ping_reply_received = 0;
-                    new_job2->type = JOB_PING_WAIT_FOR_REPLY;
-                    new_job2->ping_timer = PING_TIMER;
-                    job_q_add(&job_q, new_job2);
-
+                    // "<host id> [options]", the requests go out from the loop and the summary answers it
+                    k = 0;
+                    if (sscanf(man_msg, "%d%n", &dst, &k) != 1) dst = -1;
+                    if (!ping_start(&pings, dst, man_msg + k, man_tag, man_reply_msg, MAN_MSG_LENGTH)) {
+                        man_reply(man_port, man_tag, man_reply_msg, (int) strlen(man_reply_msg));
+                    }
                     break;
                 }
 /* =========================== Download a file to a host =========================== */
 			    case 'd': {
-                    sscanf(man_msg, "%d %s", &dst, name);
-                    new_packet = (struct packet *) malloc(sizeof(struct packet));
-                    new_packet->src = (char) host_id;
-                    new_packet->dst = (char) dst;
-                    new_packet->type = PKT_FILE_DOWNLOAD_REQ;
-                    for (i = 0; name[i] != '\0'; i++) {
-                        new_packet->payload[i] = name[i];
-                    }
-                    new_packet->payload[i] = '\0';
-                    new_packet->length = i;
-
-                    // Create a job to send the packet
-                    new_job = (struct host_job *) malloc(sizeof(struct host_job));
-                    new_job->packet = new_packet;
-                    new_job->type = JOB_SEND_PKT_ALL_PORTS;
-                    job_q_add(&job_q, new_job);
+                    // Resumes from a .part file left by an earlier attempt
+                    if (sscanf(man_msg, "%d %99s", &dst, name) != 2) {
+                        n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Usage: d <host id> <file name>");
+                    } else if (transfer_request(&xfer, &dst, 1, name)) {
+                        n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Started");
+                    } else {
+                        n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Download of %s failed to start", name);
+                    }
+                    if (man_tag != 0) man_reply(man_port, man_tag, man_reply_msg, n);
+                    break;
+                }
+/* =========================== Download a file from several hosts ================ */
+                case 'M': {
+                    // Message is "<file name> <host id> <host id> ..."
+                    int sources[MAX_SOURCES];
+                    int num_sources = 0;
+                    char *token;
+
+                    token = strtok(man_msg, " ");
+                    if (token != NULL) {
+                        snprintf(name, MAX_FILE_NAME, "%s", token);
+                        while ((token = strtok(NULL, " ")) != NULL && num_sources < MAX_SOURCES) {
+                            sources[num_sources++] = atoi(token);
+                        }
+                    }
+                    // The menu expects no answer, a scripted manager waits for one
+                    if (num_sources == 0) {
+                        n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Usage: M <file name> <host id> ...");
+                    } else if (transfer_request(&xfer, sources, num_sources, name)) {
+                        n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Started");
+                    } else {
+                        n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Download of %s failed to start", name);
+                    }
+                    if (man_tag != 0) man_reply(man_port, man_tag, man_reply_msg, n);
                     break;
                 }
 /* =========================== Upload a file to a host =========================== */    
                 case 'u': {
-                    /* Upload a file to a host */
-                    sscanf(man_msg, "%d %s", &dst, name);
-                    new_job = (struct host_job *) malloc(sizeof(struct host_job));
-                    new_job->type = JOB_FILE_UPLOAD_SEND;
-                    new_job->file_upload_dst = dst;
-                    for (i = 0; name[i] != '\0'; i++) {
-                        new_job->fname_upload[i] = name[i];
+                    /* Upload a file to a host, started right away so the host's state shows it from now on */
+                    if (sscanf(man_msg, "%d %99s", &dst, name) != 2) {
+                        n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Usage: u <host id> <file name>");
+                    } else if (transfer_start_send(&xfer, dst, name, 0, 0, 0, 1, FILE_FLAG_COMPRESS)) {
+                        n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Started");
+                    } else {
+                        n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Upload of %s failed to start", name);
                     }
-                    new_job->fname_upload[i] = '\0';
-                    job_q_add(&job_q, new_job);
-
+                    if (man_tag != 0) man_reply(man_port, man_tag, man_reply_msg, n);
+                    break;
+                }
+/* =========================== Turn file transfer compression on or off ========== */
+                case 'z': {
+                    xfer.compress = !xfer.compress;
+                    n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "File transfer compression %s",
+                                 xfer.compress ? "on" : "off");
+                    man_reply(man_port, man_tag, man_reply_msg, n);
+                    break;
+                }
+                case 'L': {
+                    res.policy = res.policy == RESOLVER_NEAREST ? RESOLVER_LEAST_LOADED : RESOLVER_NEAREST;
+                    n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS requests go to the %s server",
+                                 res.policy == RESOLVER_NEAREST ? "nearest" : "least loaded");
+                    man_reply(man_port, man_tag, man_reply_msg, n);
                     break;
                 }
 /* =========================== Register a domain name with DNS server=============*/
-                case 'r': {
-                    new_packet = (struct packet *) malloc(sizeof(struct packet));
-                    new_packet->src = (char) host_id;
-                    new_packet->dst = (char) 100;
-                    new_packet->type = (char) PKT_DNS_REGISTER;
-                    for (i = 0; man_msg[i] != '\0' && i < PKT_PAYLOAD_MAX; i++) {
-                        new_packet->payload[i] = man_msg[i];
-                    }
-                    new_packet->payload[i] = '\0';
-                    new_packet->length = i;
-
-                    // Create a job to send the packet
+                case 'r':
+                case 'U': {
+                    // One or more names separated by commas, sent together
+                    if (man_cmd == 'U') {
+                        resolver_unregister(&res, man_msg);
+                    } else {
+                        resolver_register(&res, man_msg);
+                    }
+
+                    // Create a job to wait for reply
                     new_job = (struct host_job *) malloc(sizeof(struct host_job));
-                    new_job->packet = new_packet;
-                    new_job->type = JOB_SEND_PKT_ALL_PORTS;
+                    new_job->packet = NULL;
+                    new_job->type = JOB_DNS_REGISTER_WAIT_FOR_REPLY;
+                    new_job->man_tag = man_tag;
+                    new_job->ping_timer = PING_TIMER;
                     job_q_add(&job_q, new_job);
-
-                    // Create a second job to wait for reply
-                    new_job2 = (struct host_job *) malloc(sizeof(struct host_job));
-                    dns_register_received = false;
-                    memset(string, 0, PKT_PAYLOAD_MAX);
-                    new_job2->type = JOB_DNS_REGISTER_WAIT_FOR_REPLY;
-                    new_job2->ping_timer = PING_TIMER;
-                    job_q_add(&job_q, new_job2);
                     break;
                 }
                 case 'l': {
-                    // Create a new packet
-                    new_packet = (struct packet *) malloc(sizeof(struct packet));
-                    new_packet->src = (char) host_id;
-                    new_packet->dst = DNS_SERVER_ID;  // DNS server always has the same ID
-                    new_packet->type = (char) PKT_DNS_LOOKUP;
-                    n = snprintf(new_packet->payload, PKT_PAYLOAD_MAX, "%s", man_msg);
-                    new_packet->payload[n] = '\0';
-                    new_packet->length = n;
-
-                    // Create a job to send the packet
+                    // The resolver answers from its cache or asks the DNS server, names are comma separated
                     new_job = (struct host_job *) malloc(sizeof(struct host_job));
-                    new_job->packet = new_packet;
-                    new_job->type = JOB_SEND_PKT_ALL_PORTS;
+                    new_job->packet = NULL;
+                    n = snprintf(new_job->dns_name, MAX_DNS_NAME_LENGTH, "%s", man_msg);
+                    new_job->dns_name[n] = '\0';
+                    new_job->type = JOB_DNS_LOOKUP_WAIT_FOR_REPLY;
+                    new_job->man_tag = man_tag;
+                    new_job->ping_timer = PING_TIMER;
                     job_q_add(&job_q, new_job);
-
-                    // Create a second job to wait for reply
-                    new_job2 = (struct host_job *) malloc(sizeof(struct host_job));
-                    dns_lookup_received = false;
-                    memset(dns_lookup_buffer, 0, MAX_DNS_NAME_LENGTH);
-                    n = snprintf(new_job2->fname_download, MAX_FILE_NAME, "%s", man_msg);
-                    new_job2->fname_download[n] = '\0';
-                    new_job2->type = JOB_DNS_LOOKUP_WAIT_FOR_REPLY;
-                    new_job2->ping_timer = PING_TIMER;
-                    job_q_add(&job_q, new_job2);
                     break;
                 }
                 case 'P': {
-                    char domain_name[MAX_DNS_NAME_LENGTH];
-                    n = snprintf(domain_name, MAX_DNS_NAME_LENGTH, "%s", man_msg);
-                    domain_name[n] = '\0';
-                    new_packet = (struct packet *) malloc(sizeof(struct packet));
-                    new_packet->src = (char) host_id;
-                    new_packet->dst = DNS_SERVER_ID;
-                    new_packet->type = PKT_DNS_LOOKUP;
-                    n = snprintf(new_packet->payload, PKT_PAYLOAD_MAX, "%s", domain_name);
-                    new_packet->payload[n] = '\0';
-                    new_packet->length = n;
-
-                    // Create a job to send the packet
                     new_job = (struct host_job *) malloc(sizeof(struct host_job));
-                    new_job->packet = new_packet;
-                    new_job->type = JOB_SEND_PKT_ALL_PORTS;
+                    new_job->packet = NULL;
+                    // "<name> [options]", the options as for 'p'
+                    k = 0;
+                    sscanf(man_msg, "%99s%n", new_job->dns_name, &k);
+                    snprintf(new_job->ping_options, sizeof(new_job->ping_options), "%s", man_msg + k);
+                    new_job->type = JOB_DNS_PING_WAIT_FOR_REPLY;
+                    new_job->man_tag = man_tag;
+                    new_job->ping_timer = PING_TIMER;
+                    job_q_add(&job_q, new_job);
+                    break;
+                }
+                case 'f': {
+                    // List the names matching a pattern such as *.rack1.dc
+                    resolver_match_start(&res, man_msg);
+                    new_job = (struct host_job *) malloc(sizeof(struct host_job));
+                    new_job->packet = NULL;
+                    new_job->type = JOB_DNS_MATCH_WAIT_FOR_REPLY;
+                    new_job->man_tag = man_tag;
+                    new_job->ping_timer = PING_TIMER;
                     job_q_add(&job_q, new_job);
-
-                    // Create second job to wait for reply
-                    new_job2 = (struct host_job *) malloc(sizeof(struct host_job));
-                    dns_lookup_received = false;
-                    new_job2->type = JOB_DNS_PING_WAIT_FOR_REPLY;
-                    new_job2->ping_timer = PING_TIMER;
-                    job_q_add(&job_q, new_job2);
                     break;
                 }
                 case 'D': {
@@ -473,30 +585,58 @@ _Noreturn void host_main(int host_id) {
                     char file_name[MAX_FILE_NAME];
                     sscanf(man_msg, "%s %s", domain_name, file_name);
 
-                    new_packet = (struct packet *) malloc(sizeof(struct packet));
-                    new_packet->src = (char) host_id;
-                    new_packet->dst = DNS_SERVER_ID;
-                    new_packet->type = (char) PKT_DNS_LOOKUP;
-                    n = snprintf(new_packet->payload, PKT_PAYLOAD_MAX, "%s", domain_name);
-                    new_packet->payload[n] = '\0';
-                    new_packet->length = n;
-
-                    // Create a job to send packet
+                    new_job = (struct host_job *) malloc(sizeof(struct host_job));
+                    new_job->packet = NULL;
+                    n = snprintf(new_job->dns_name, MAX_DNS_NAME_LENGTH, "%s", domain_name);
+                    new_job->dns_name[n] = '\0';
+                    n = snprintf(new_job->fname_download, MAX_FILE_NAME, "%s", file_name);
+                    new_job->fname_download[n] = '\0';
+                    new_job->type = JOB_DNS_DOWNLOAD_WAIT_FOR_REPLY;
+                    new_job->man_tag = man_tag;
+                    new_job->ping_timer = PING_TIMER;
+                    job_q_add(&job_q, new_job);
+                    break;
+                }
+                case 'k': {
+                    // Only the answer to the latest request is kept
+                    new_packet = kv_request_packet(host_id, man_msg, ++kv_req_id);
+                    if (new_packet == NULL) {
+                        n = snprintf(man_reply_msg, MAN_MSG_LENGTH,
+                                     "Usage: <server id> <get|put|delete> <key> [value]");
+                        man_reply(man_port, man_tag, man_reply_msg, n);
+                        break;
+                    }
+                    if (kv_reply != NULL) {
+                        free(kv_reply);
+                        kv_reply = NULL;
+                    }
                     new_job = (struct host_job *) malloc(sizeof(struct host_job));
                     new_job->packet = new_packet;
-                    new_job->type = JOB_SEND_PKT_ALL_PORTS;
+                    new_job->type = JOB_SEND_PKT;
                     job_q_add(&job_q, new_job);
 
-                    // Create a second job to wait for reply
                     new_job2 = (struct host_job *) malloc(sizeof(struct host_job));
-                    dns_lookup_received = false;
-                    n = snprintf(new_job2->fname_download, PKT_PAYLOAD_MAX, "%s", file_name);
-                    new_job2->fname_download[n] = '\0';
-                    new_job2->type = JOB_DNS_DOWNLOAD_WAIT_FOR_REPLY;
+                    new_job2->packet = NULL;
+                    new_job2->type = JOB_KV_WAIT_FOR_REPLY;
+                    new_job2->man_tag = man_tag;
                     new_job2->ping_timer = PING_TIMER;
                     job_q_add(&job_q, new_job2);
                     break;
                 }
+/* =========================== Start or stop generating traffic =========== */
+                case 'g': {
+                    if (strcmp(man_msg, "stop") == 0) {
+                        traffic_stop(&gen);
+                        n = traffic_report(&gen, man_reply_msg, MAN_MSG_LENGTH);
+                        if (n == 0) n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "No traffic generated");
+                    } else if (traffic_start(&gen, man_msg, man_reply_msg, MAN_MSG_LENGTH)) {
+                        n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Generating %s", man_msg);
+                    } else {
+                        n = (int) strlen(man_reply_msg);
+                    }
+                    man_reply(man_port, man_tag, man_reply_msg, n);
+                    break;
+                }
                 default:;
             }
         }
@@ -509,10 +649,12 @@ _Noreturn void host_main(int host_id) {
 
         for (k = 0; k < node_port_num; k++) { /* Scan all ports */
 
-            in_packet = (struct packet *) malloc(sizeof(struct packet));
+            in_packet = (struct packet *) calloc(1, sizeof(struct packet));
             n = packet_recv(node_port[k], in_packet);
+            if (n > 0) ports_learn(&ports, in_packet, k);
 
-            if ((n > 0) && (in_packet->dst == (char) host_id) && in_packet->type != (char) PKT_CONTROL_PKT) {
+            if ((n > 0) && (in_packet->dst == (char) host_id || in_packet->dst == (char) BROADCAST_ID)
+                && in_packet->type != (char) PKT_CONTROL_PKT) {
                 new_job = (struct host_job *) malloc(sizeof(struct host_job));
                 new_job->in_port_index = k;
                 new_job->packet = in_packet;
@@ -526,7 +668,13 @@ _Noreturn void host_main(int host_id) {
                         break;
                     }
                     case (char) PKT_PING_REPLY: {
-                        ping_reply_received = 1;
+                        ping_received(&pings, in_packet, clock_us());
+                        free(in_packet);
+                        free(new_job);
+                        break;
+                    }
+                    case (char) PKT_TRAFFIC: {
+                        traffic_received(&gen, in_packet);
                         free(in_packet);
                         free(new_job);
                         break;
@@ -537,7 +685,8 @@ _Noreturn void host_main(int host_id) {
                         job_q_add(&job_q, new_job);
                         break;
                     }
-                    case (char) PKT_FILE_UPLOAD_MIDDLE: {
+                    case (char) PKT_FILE_UPLOAD_MIDDLE:
+                    case (char) PKT_FILE_UPLOAD_MIDDLE_LZ: {
                         new_job->type = JOB_FILE_UPLOAD_RECV_MIDDLE;
                         job_q_add(&job_q, new_job);
                         break;
@@ -547,11 +696,29 @@ _Noreturn void host_main(int host_id) {
                         job_q_add(&job_q, new_job);
                         break;
                     }
+                    case (char) PKT_FILE_ACK: {
+                        /* Handled right away so the RTT does not include our own queue */
+                        transfer_recv_ack(&xfer, in_packet);
+                        free(in_packet);
+                        free(new_job);
+                        break;
+                    }
 /* =========================== Download =========================== */
 				    case (char) PKT_FILE_DOWNLOAD_REQ: {
+                        // Payload is [offset][length][stripe][stripe count][file name]
+                        if (in_packet->length < (int) PKT_FILE_REQ_NAME) {
+                            free(in_packet);
+                            free(new_job);
+                            break;
+                        }
                         new_job->type = JOB_FILE_UPLOAD_SEND;
-                        for (i = 0; in_packet->payload[i] != '\0'; i++) {
-                            new_job->fname_upload[i] = in_packet->payload[i];
+                        memcpy(&new_job->file_offset, in_packet->payload + PKT_FILE_REQ_OFFSET, sizeof(int));
+                        memcpy(&new_job->file_length, in_packet->payload + PKT_FILE_REQ_LENGTH, sizeof(int));
+                        new_job->file_stripe = (int) in_packet->payload[PKT_FILE_REQ_STRIPE];
+                        new_job->file_stripes = (int) in_packet->payload[PKT_FILE_REQ_STRIPES];
+                        new_job->file_flags = (int) in_packet->payload[PKT_FILE_REQ_FLAGS];
+                        for (i = 0; i + (int) PKT_FILE_REQ_NAME < in_packet->length && i < MAX_FILE_NAME - 1; i++) {
+                            new_job->fname_upload[i] = in_packet->payload[i + PKT_FILE_REQ_NAME];
                         }
                         new_job->fname_upload[i] = '\0';
                         new_job->file_upload_dst = (int) in_packet->src;
@@ -559,18 +726,43 @@ _Noreturn void host_main(int host_id) {
                         break;
                     }
 /* ================================================================ */
-                    case (char) PKT_DNS_REGISTER_REPLY: {
-                        dns_register_received = true;
-                        n = snprintf(dns_register_buffer, PKT_PAYLOAD_MAX, "%s", in_packet->payload);
-                        dns_register_buffer[n] = '\0';
+                    case (char) PKT_DNS_REGISTER_REPLY:
+                    case (char) PKT_DNS_UNREGISTER_REPLY: {
+                        resolver_recv_register(&res, in_packet);
+                        free(new_job->packet);
+                        free(new_job);
+                        break;
+                    }
+                    case (char) PKT_DNS_RENEW_REPLY: {
+                        resolver_recv_renew(&res, in_packet);
                         free(new_job->packet);
                         free(new_job);
                         break;
                     }
                     case (char) PKT_DNS_LOOKUP_REPLY: {
-                        dns_lookup_received = true;
-                        n = snprintf(dns_lookup_buffer, PKT_PAYLOAD_MAX, "%s", new_job->packet->payload);
-                        dns_lookup_buffer[n] = '\0';
+                        resolver_recv_reply(&res, in_packet);
+                        free(new_job->packet);
+                        free(new_job);
+                        break;
+                    }
+                    case (char) PKT_DNS_QUERY_REPLY: {
+                        resolver_recv_match(&res, in_packet);
+                        free(new_job->packet);
+                        free(new_job);
+                        break;
+                    }
+                    case (char) PKT_KV_REPLY: {
+                        if (in_packet->length >= PKT_KV_VALUE && kv_reply == NULL
+                            && memcmp(in_packet->payload + PKT_KV_REQ_ID, &kv_req_id, sizeof(uint16_t)) == 0) {
+                            kv_reply = in_packet;
+                        } else {
+                            free(in_packet);
+                        }
+                        free(new_job);
+                        break;
+                    }
+                    case (char) PKT_DNS_BEACON: {
+                        resolver_recv_beacon(&res, in_packet);
                         free(new_job->packet);
                         free(new_job);
                         break;
@@ -586,6 +778,17 @@ _Noreturn void host_main(int host_id) {
             }
         }
 
+        /* Send the generated packets and ping requests that are due, next to the jobs */
+        while (traffic_next(&gen, clock_us(), &gen_packet)) {
+            send_direct(&ports, node_port, node_port_num, &gen_packet);
+        }
+        while (ping_next(&pings, clock_us(), &ping_packet)) {
+            send_direct(&ports, node_port, node_port_num, &ping_packet);
+        }
+        while ((n = ping_done(&pings, clock_us(), &man_tag, man_reply_msg, MAN_MSG_LENGTH)) > 0) {
+            man_reply(man_port, man_tag, man_reply_msg, n);
+        }
+
         /*
           * Execute one job in the job queue
           */
@@ -599,30 +802,35 @@ _Noreturn void host_main(int host_id) {
                 /* Send packet on all ports */
                 switch (new_job->type) {
 
-                    /* Send packets on all ports */
-                    case JOB_SEND_PKT_ALL_PORTS: {
-                        for (k = 0; k < node_port_num; k++) {
+                    /* Send on the port the destination was heard on, all ports if it was not */
+                    case JOB_SEND_PKT: {
+                        k = ports_lookup(&ports, new_job->packet);
+                        if (k >= 0 && k < node_port_num) {
                             packet_send(node_port[k], new_job->packet);
+                        } else {
+                            for (k = 0; k < node_port_num; k++) {
+                                packet_send(node_port[k], new_job->packet);
+                            }
                         }
                         free(new_job->packet);
                         free(new_job);
                         break;
                     }
 
-                        /* The next three jobs deal with the pinging process */
                     case JOB_PING_SEND_REPLY: {
                         /* Send a ping reply packet */
 
-                        /* Create ping reply packet */
-                        new_packet = (struct packet *) malloc(sizeof(struct packet));
+                        /* Create ping reply packet, with the id, sequence number and time of the request */
+                        new_packet = (struct packet *) calloc(1, sizeof(struct packet));
                         new_packet->dst = new_job->packet->src;
                         new_packet->src = (char) host_id;
                         new_packet->type = PKT_PING_REPLY;
-                        new_packet->length = 0;
+                        new_packet->length = new_job->packet->length;
+                        memcpy(new_packet->payload, new_job->packet->payload, new_packet->length);
 
                         /* Create job for the ping reply */
                         new_job2 = (struct host_job *) malloc(sizeof(struct host_job));
-                        new_job2->type = JOB_SEND_PKT_ALL_PORTS;
+                        new_job2->type = JOB_SEND_PKT;
                         new_job2->packet = new_packet;
 
                         /* Enter job in the job queue */
@@ -634,345 +842,219 @@ _Noreturn void host_main(int host_id) {
                         break;
                     }
 
-                    case JOB_PING_WAIT_FOR_REPLY: {
-                        /* Wait for a ping reply packet */
-
-                        if (ping_reply_received == 1) {
-                            n = sprintf(man_reply_msg, "Ping acked!");
-                            man_reply_msg[n] = '\0';
-                            write(man_port->send_fd, man_reply_msg, n + 1);
-                            free(new_job);
-                        } else if (new_job->ping_timer > 1) {
-                            new_job->ping_timer--;
-                            job_q_add(&job_q, new_job);
-                        } else { /* Time out */
-                            n = sprintf(man_reply_msg, "Ping time out!");
-                            man_reply_msg[n] = '\0';
-                            write(man_port->send_fd, man_reply_msg, n + 1);
-                            free(new_job);
-                        }
-
-                        break;
-                    }
-
-                        /* The next three jobs deal with uploading a file */
+                        /* The next two jobs deal with uploading a file */
 
                         /* This job is for the sending host */
                     case JOB_FILE_UPLOAD_SEND: {
-                        /* Open file */
-                        if (dir_valid) {
-                            n = sprintf(name, "./%s/%s", dir, new_job->fname_upload);
-                            name[n] = '\0';
-                            fp = fopen(name, "r");
-
-                            if (fp != NULL) {
-                                char buffer[MAX_FILE_BUFFER + 1];
-                                memset(buffer, 0, MAX_FILE_BUFFER);
-                                /*
-                                * Create first packet which
-                                * has the file name
-                                */
-                                new_packet = (struct packet *) malloc(sizeof(struct packet));
-                                new_packet->dst = (char) new_job->file_upload_dst;
-                                new_packet->src = (char) host_id;
-                                new_packet->type = PKT_FILE_UPLOAD_START;
-                                for (i = 0; new_job->fname_upload[i] != '\0'; i++) {
-                                    new_packet->payload[i] = new_job->fname_upload[i];
-                                }
-                                new_packet->length = i;
-
-                                /*
-                                * Create a job to send the packet
-                                * and put it in the job queue
-                                */
-                                new_job2 = (struct host_job *) malloc(sizeof(struct host_job));
-                                new_job2->type = JOB_SEND_PKT_ALL_PORTS;
-                                new_job2->packet = new_packet;
-                                job_q_add(&job_q, new_job2);
-                                /*
-                                * Create the second packet which
-                                * has the file contents
-                                */
-                                // fread returns the number of characters in the file
-                                size_t num = fread(buffer, sizeof(char), MAX_FILE_BUFFER, fp);
-                                fclose(fp);
-                                buffer[num] = '\0'; // NULL terminate buffer
-
-                                while (num > MAX_MSG_LENGTH) {
-                                    strncpy(string, buffer, MAX_MSG_LENGTH);
-                                    for (int j = 0; buffer[j] != '\0' || j < MAX_MSG_LENGTH; j++) {
-                                        buffer[j] = buffer[j + MAX_MSG_LENGTH];
-                                    }
-                                    num = num - MAX_MSG_LENGTH;
-                                    new_packet = (struct packet *) malloc(sizeof(struct packet));
-                                    new_packet->dst = (char) new_job->file_upload_dst;
-                                    new_packet->src = (char) host_id;
-                                    new_packet->type = PKT_FILE_UPLOAD_MIDDLE;
-                                    // Packet is now created
-
-                                    // Fill the payload
-                                    for (i = 0; i < MAX_MSG_LENGTH; i++) {
-                                        new_packet->payload[i] = string[i];
-                                    }
-                                    new_packet->length = MAX_MSG_LENGTH;
-
-                                    // Add the job to the job queue
-                                    new_job2 = (struct host_job *) malloc(sizeof(struct host_job));
-                                    new_job2->type = JOB_SEND_PKT_ALL_PORTS;
-                                    new_job2->packet = new_packet;
-                                    job_q_add(&job_q, new_job2);
-                                }
-                                new_packet = (struct packet *) malloc(sizeof(struct packet));
-                                new_packet->dst = (char) new_job->file_upload_dst;
-                                new_packet->src = (char) host_id;
-                                new_packet->type = PKT_FILE_UPLOAD_END;
-
-                                for (i = 0; i < n; i++) {
-                                    new_packet->payload[i] = buffer[i];
-                                }
-
-                                new_packet->length = n;
-
-                                /*
-                                 * Create a job to send the packet
-                                 * and put the job in the job queue
-                                 */
-
-                                new_job2 = (struct host_job *) malloc(sizeof(struct host_job));
-                                new_job2->type = JOB_SEND_PKT_ALL_PORTS;
-                                new_job2->packet = new_packet;
-                                job_q_add(&job_q, new_job2);
-                                free(new_job);
-                            } else {
-                                /* Didn't open file */
-                                printf("Invalid directory\n");
-                            }
-                        }
+                        transfer_start_send(&xfer, new_job->file_upload_dst, new_job->fname_upload,
+                                            new_job->file_offset, new_job->file_length,
+                                            new_job->file_stripe, new_job->file_stripes,
+                                            new_job->file_flags);
+                        if (new_job->packet != NULL) free(new_job->packet);
+                        free(new_job);
+                        break;
+                    }
+                    case JOB_FILE_UPLOAD_SEND_CHUNK: {
+                        /* Sends one chunk and puts itself back in the queue */
+                        transfer_send_chunk(&xfer, new_job);
                         break;
                     }
 
-                        /* The next two jobs are for the receiving host */
+                        /* The next three jobs are for the receiving host */
 
                     case JOB_FILE_UPLOAD_RECV_START: {
-
-                        /* Initialize the file buffer data structure */
-                        file_buf_init(&f_buf_upload);
-
-                        /*
-                         * Transfer the file name in the packet payload
-                         * to the file buffer data structure
-                         */
-                        file_buf_put_name(&f_buf_upload, new_job->packet->payload, new_job->packet->length);
-
+                        transfer_recv_start(&xfer, new_job->packet);
                         free(new_job->packet);
                         free(new_job);
                         break;
                     }
                     case JOB_FILE_UPLOAD_RECV_MIDDLE: {
-                        file_buf_add(&f_buf_upload, new_job->packet->payload, new_job->packet->length);
+                        /* Chunk is checked against its CRC before it is written */
+                        transfer_recv_chunk(&xfer, new_job->packet);
                         free(new_job->packet);
                         free(new_job);
                         break;
                     }
                     case JOB_FILE_UPLOAD_RECV_END: {
-                        /*
-                         * Download packet payload into file buffer
-                         * data structure
-                         */
-                        file_buf_add(&f_buf_upload, new_job->packet->payload, new_job->packet->length);
-
+                        /* Check the whole file against the sender's digest */
+                        transfer_recv_end(&xfer, new_job->packet);
                         free(new_job->packet);
                         free(new_job);
-
-                        if (dir_valid) {
-
-                            /*
-                             * Get file name from the file buffer
-                             * Then open the file
-                             */
-                            file_buf_get_name(&f_buf_upload, string);
-                            n = sprintf(name, "./%s/%s", dir, string);
-                            name[n] = '\0';
-
-                            fp = fopen(name, "w");
-
-                            if (fp != NULL) {
-                                /*
-                                 * Write contents in the file
-                                 * buffer into file
-                                 */
-
-                                while (f_buf_upload.occ > 0) {
-                                    n = file_buf_remove(&f_buf_upload, string, PKT_PAYLOAD_MAX);
-                                    string[n] = '\0';
-                                    size_t tmp = fwrite(string, sizeof(char), n, fp);
-                                }
-
-                                fclose(fp);
-                            }
-                        }
                         break;
                     }
 
                     case JOB_DNS_REGISTER_WAIT_FOR_REPLY: {
-                        if (dns_register_received) {
-                            memset(man_reply_msg, 0, MAN_MSG_LENGTH);
-                            switch (dns_register_buffer[0]) {
-                                case 'S': {
-                                    n = sprintf(man_reply_msg, "Successfully registered domain name");
-                                    break;
-                                }
-                                case 'L': {
-                                    n = sprintf(man_reply_msg, "Failed to register: Name too long");
-                                    break;
-                                }
-                                case 'I': {
-                                    n = sprintf(man_reply_msg, "Failed to register: Name is Invalid");
-                                    break;
-                                }
-                                case 'A': {
-                                    n = sprintf(man_reply_msg, "Failed to register: Already registered");
-                                    break;
-                                }
-                                default: {
-                                    n = sprintf(man_reply_msg, "Failed to parse DNS registration response");
-                                    break;
+                        if (resolver_register_done(&res)) {
+                            if (res.reg_count == 1) {
+                                n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "%s",
+                                             dns_register_text(res.reg_type, res.reg[0].status));
+                            } else {
+                                // One line per name
+                                n = 0;
+                                for (k = 0; k < res.reg_count && n < MAN_MSG_LENGTH; k++) {
+                                    n += snprintf(man_reply_msg + n, MAN_MSG_LENGTH - n, "%s: %s\n",
+                                                  res.reg[k].name,
+                                                  dns_register_text(res.reg_type, res.reg[k].status));
                                 }
+                                if (n >= MAN_MSG_LENGTH) n = MAN_MSG_LENGTH - 1;
                             }
-                            man_reply_msg[n] = '\0';
-                            write(man_port->send_fd, man_reply_msg, n + 1);
+                            man_reply(man_port, new_job->man_tag, man_reply_msg, n);
                             free(new_job);
-                            memset(dns_register_buffer, 0, MAX_DNS_NAME_LENGTH);
                         } else if (new_job->ping_timer > 1) {
                             new_job->ping_timer--;
                             job_q_add(&job_q, new_job);
                         } else {
                             n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS registration time out");
                             man_reply_msg[n] = '\0';
-                            write(man_port->send_fd, man_reply_msg, strnlen(man_reply_msg, MAN_MSG_LENGTH));
+                            man_reply(man_port, new_job->man_tag, man_reply_msg, n);
                             free(new_job);
                         }
                         break;
                     }
                     case JOB_DNS_LOOKUP_WAIT_FOR_REPLY: {
-                        if (dns_lookup_received) {
-                            dns_lookup_received = false;
-                            if (strncmp(dns_lookup_buffer, "FAIL", 4) == 0) {
-                                n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS lookup failed");
-                            } else {
-                                dns_lookup_response = (int) dns_lookup_buffer[0];
-                                n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "%s is at %i.", new_job->fname_download,
-                                             dns_lookup_response);
+                        if (strchr(new_job->dns_name, ',') == NULL) {
+                            switch (resolver_lookup(&res, new_job->dns_name, &dns_lookup_response)) {
+                                case RESOLVE_FOUND: {
+                                    n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "%s is at %i.", new_job->dns_name,
+                                                 dns_lookup_response);
+                                    break;
+                                }
+                                case RESOLVE_NOT_FOUND: {
+                                    n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS lookup failed");
+                                    break;
+                                }
+                                default: {
+                                    n = 0;
+                                }
                             }
-                            man_reply_msg[n] = '\0';
-                            write(man_port->send_fd, man_reply_msg, n + 1);
+                        } else {
+                            // Every name is asked for on the first pass, so they go out in one batch
+                            n = dns_lookup_list(&res, new_job->dns_name, man_reply_msg, MAN_MSG_LENGTH);
+                        }
+                        if (n > 0) {
+                            man_reply(man_port, new_job->man_tag, man_reply_msg, n);
                             free(new_job);
-                            memset(dns_lookup_buffer, 0, MAX_DNS_NAME_LENGTH);
                         } else if (new_job->ping_timer > 1) {
                             new_job->ping_timer--;
                             job_q_add(&job_q, new_job);
                         } else {
                             n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS lookup timeout");
-                            man_reply_msg[n] = '\0';
-                            write(man_port->send_fd, man_reply_msg, n + 1);
+                            man_reply(man_port, new_job->man_tag, man_reply_msg, n);
                             free(new_job);
                         }
                         break;
                     }
                     case JOB_DNS_PING_WAIT_FOR_REPLY: {
-                        if (dns_lookup_received) {
-                            dns_lookup_received = false;
-                            if (strncmp(dns_lookup_buffer, "FAIL", 4) == 0) {
+                        switch (resolver_lookup(&res, new_job->dns_name, &dns_lookup_response)) {
+                            case RESOLVE_FOUND: {
+                                // Ping the host the name is at, the summary answers the command
+                                if (!ping_start(&pings, dns_lookup_response, new_job->ping_options, new_job->man_tag,
+                                                man_reply_msg, MAN_MSG_LENGTH)) {
+                                    man_reply(man_port, new_job->man_tag, man_reply_msg,
+                                              (int) strlen(man_reply_msg));
+                                }
+                                free(new_job);
+                                break;
+                            }
+                            case RESOLVE_NOT_FOUND: {
                                 n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS ping failed at lookup stage");
-                                man_reply_msg[n] = '\0';
-                                write(man_port->send_fd, man_reply_msg, n + 1);
+                                man_reply(man_port, new_job->man_tag, man_reply_msg, n);
                                 free(new_job);
+                                break;
+                            }
+                            default: {
+                                if (new_job->ping_timer > 1) {
+                                    new_job->ping_timer--;
+                                    job_q_add(&job_q, new_job);
+                                } else {
+                                    n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS lookup time out");
+                                    man_reply(man_port, new_job->man_tag, man_reply_msg, n);
+                                    free(new_job);
+                                }
+                            }
+                        }
+                        break;
+                    }
+                    case JOB_DNS_MATCH_WAIT_FOR_REPLY: {
+                        if (resolver_match_done(&res)) {
+                            if (res.match.text_len == 0) {
+                                n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "No names match %s", res.match.pattern);
                             } else {
-                                free(new_job);
-
-                                // get host id using the returned value
-                                long tmp = strtol(dns_lookup_buffer, NULL, 10);
-
-                                // Create a new packet to request ping
-                                new_packet = (struct packet *) malloc(sizeof(struct packet));
-                                new_packet->src = (char) host_id;
-                                new_packet->dst = (char) tmp;
-                                new_packet->type = (char) PKT_PING_REQ;
-                                new_packet->length = 0;
-
-                                // Create job to send ping req
-                                new_job = (struct host_job *) malloc(sizeof(struct host_job));
-                                new_job->packet = new_packet;
-                                new_job->type = JOB_SEND_PKT_ALL_PORTS;
-                                job_q_add(&job_q, new_job);
-
-                                // Create job to wait for ping
-                                new_job2 = (struct host_job *) malloc(sizeof(struct host_job));
-                                ping_reply_received = 0;
-                                new_job2->type = JOB_PING_WAIT_FOR_REPLY;
-                                new_job2->ping_timer = 40;
-                                job_q_add(&job_q, new_job2);
+                                n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "%s%s", res.match.text,
+                                             res.match.truncated ? "..." : "");
                             }
-                            memset(dns_lookup_buffer, 0, MAX_DNS_NAME_LENGTH);
+                            man_reply(man_port, new_job->man_tag, man_reply_msg, n);
+                            free(new_job);
                         } else if (new_job->ping_timer > 1) {
                             new_job->ping_timer--;
                             job_q_add(&job_q, new_job);
                         } else {
-                            n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS lookup time out");
-                            man_reply_msg[n] = '\0';
-                            write(man_port->send_fd, man_reply_msg, strnlen(man_reply_msg, MAN_MSG_LENGTH));
+                            n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS query timeout");
+                            man_reply(man_port, new_job->man_tag, man_reply_msg, n);
                             free(new_job);
                         }
                         break;
                     }
-                    case JOB_DNS_DOWNLOAD_WAIT_FOR_REPLY: {
-                        if (dns_lookup_received) {
-                            dns_lookup_received = false;
-                            if (strncmp(dns_lookup_buffer, "FAIL", 4) == 0) {
-                                n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS lookup failed");
-                                man_reply_msg[n] = '\0';
-                                write(man_port->send_fd, man_reply_msg, n + 1);
-                                free(new_job);
-                            } else {
-                                dns_lookup_response = (int) dns_lookup_buffer[0];
-                                new_packet = (struct packet *) malloc(sizeof(struct packet));
-                                new_packet->src = (char) host_id;
-                                new_packet->dst = (char) dns_lookup_response;
-                                new_packet->type = (char) PKT_FILE_DOWNLOAD_REQ;
-                                for (i = 0; i < PAYLOAD_MAX && new_job->fname_download[i] != '\0'; i++) {
-                                    new_packet->payload[i] = new_job->fname_download[i];
-                                }
-                                new_packet->payload[i] = '\0';
-                                new_packet->length = i;
-
-                                n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Downloading file %s from host %i\n",
-                                             new_packet->payload, dns_lookup_response);
-                                man_reply_msg[n] = '\n';
-                                write(man_port->send_fd, man_reply_msg, n + 1);
-
-                                free(new_job);
-
-                                new_job2 = (struct host_job *) malloc(sizeof(struct host_job));
-                                new_job2->packet = new_packet;
-                                new_job2->type = JOB_SEND_PKT_ALL_PORTS;
-                                job_q_add(&job_q, new_job2);
-                            }
-                            memset(dns_lookup_buffer, 0, MAX_DNS_NAME_LENGTH);
+                    case JOB_KV_WAIT_FOR_REPLY: {
+                        if (kv_reply != NULL) {
+                            n = kv_reply_text(kv_reply, man_reply_msg, MAN_MSG_LENGTH);
+                            man_reply(man_port, new_job->man_tag, man_reply_msg, n);
+                            free(new_job);
                         } else if (new_job->ping_timer > 1) {
                             new_job->ping_timer--;
                             job_q_add(&job_q, new_job);
                         } else {
-                            n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS lookup time out");
-                            man_reply_msg[n] = '\n';
-                            write(man_port->send_fd, man_reply_msg, n + 1);
+                            n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Key-value request time out");
+                            man_reply(man_port, new_job->man_tag, man_reply_msg, n);
                             free(new_job);
                         }
                         break;
                     }
+                    case JOB_DNS_DOWNLOAD_WAIT_FOR_REPLY: {
+                        switch (resolver_lookup(&res, new_job->dns_name, &dns_lookup_response)) {
+                            case RESOLVE_FOUND: {
+                                if (transfer_request(&xfer, &dns_lookup_response, 1, new_job->fname_download)) {
+                                    n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Downloading file %s from host %i\n",
+                                                 new_job->fname_download, dns_lookup_response);
+                                } else {
+                                    n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Download of %s failed to start",
+                                                 new_job->fname_download);
+                                }
+                                man_reply(man_port, new_job->man_tag, man_reply_msg, n);
+                                free(new_job);
+                                break;
+                            }
+                            case RESOLVE_NOT_FOUND: {
+                                n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS lookup failed");
+                                man_reply(man_port, new_job->man_tag, man_reply_msg, n);
+                                free(new_job);
+                                break;
+                            }
+                            default: {
+                                if (new_job->ping_timer > 1) {
+                                    new_job->ping_timer--;
+                                    job_q_add(&job_q, new_job);
+                                } else {
+                                    n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "DNS lookup time out\n");
+                                    man_reply(man_port, new_job->man_tag, man_reply_msg, n);
+                                    free(new_job);
+                                }
+                            }
+                        }
+                        break;
+                    }
                 }
             }
         }
 
+        /* Ask stalled file receives to resume */
+        transfer_tick(&xfer);
+
+        /* Send the DNS names queued during this pass, batched */
+        resolver_flush(&res);
+
+        metrics_set(&metrics_self()->queue_depth, job_q_num(&job_q));
+
         /* The host goes to sleep for 10 ms */
         usleep(TENMILLISEC);
 
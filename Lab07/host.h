@@ -4,18 +4,22 @@
 
 #pragma once
 
+#include <stdint.h>
+
 enum host_job_type {
-	JOB_SEND_PKT_ALL_PORTS = 1,
+	JOB_SEND_PKT = 1,
 	JOB_PING_SEND_REPLY,
-	JOB_PING_WAIT_FOR_REPLY,
 	JOB_FILE_UPLOAD_SEND,
+	JOB_FILE_UPLOAD_SEND_CHUNK,
 	JOB_FILE_UPLOAD_RECV_START,
     JOB_FILE_UPLOAD_RECV_MIDDLE,
 	JOB_FILE_UPLOAD_RECV_END,
     JOB_DNS_REGISTER_WAIT_FOR_REPLY,
     JOB_DNS_LOOKUP_WAIT_FOR_REPLY,
     JOB_DNS_PING_WAIT_FOR_REPLY,
-    JOB_DNS_DOWNLOAD_WAIT_FOR_REPLY
+    JOB_DNS_DOWNLOAD_WAIT_FOR_REPLY,
+    JOB_DNS_MATCH_WAIT_FOR_REPLY,
+    JOB_KV_WAIT_FOR_REPLY
 };
 
 struct host_job {
@@ -25,8 +29,18 @@ struct host_job {
 	int out_port_index;
 	char fname_download[100];
 	char fname_upload[100];
+	char dns_name[100];
+	char ping_options[100];	/* Of a ping by name, as for ping_start() */
 	int ping_timer;
 	int file_upload_dst;
+	unsigned int file_offset;
+	unsigned int file_length;
+	int file_stripe;
+	int file_stripes;
+	int file_flags;
+	int transfer_index;
+	uint32_t man_tag;		/* Request id of the manager command it answers */
+	uint64_t queued_us;		/* When it was last queued */
 	struct host_job *next;
 };
 
@@ -37,6 +51,11 @@ struct job_queue {
 	int occ;
 };
 
+void job_q_add(struct job_queue *j_q, struct host_job *j);
+struct host_job *job_q_remove(struct job_queue *j_q);
+void job_q_init(struct job_queue *j_q);
+int job_q_num(struct job_queue *j_q);
+
 _Noreturn void host_main(int host_id);
 
 
@@ -0,0 +1,186 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file kv_service.c
+/// @version 1.0
+///
+/// A key-value store kept in memory by each server node. Keys hash into
+/// chained buckets that double when the table gets full, as in dns_db.c.
+/// Nothing is kept across restarts or copied to the other servers.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "service.h"
+#include "server.h"
+#include "crc32c.h"
+
+struct kv_entry {
+    struct kv_entry *next;
+    uint32_t hash;
+    uint8_t key_len;
+    uint8_t value_len;
+    char data[];                    // Key, then value
+};
+
+struct kv_state {
+    struct server *srv;
+    struct kv_entry **buckets;
+    uint32_t num_buckets;           // Power of two
+    uint32_t count;
+};
+
+static void *kv_start(struct server *srv) {
+    struct kv_state *kv = (struct kv_state *) calloc(1, sizeof(struct kv_state));
+
+    if (kv == NULL) return NULL;
+    kv->srv = srv;
+    kv->num_buckets = KV_MIN_BUCKETS;
+    kv->buckets = (struct kv_entry **) calloc(kv->num_buckets, sizeof(struct kv_entry *));
+    if (kv->buckets == NULL) {
+        free(kv);
+        return NULL;
+    }
+    return kv;
+}
+
+// The link pointing at the entry for key, or at the NULL ending its chain
+static struct kv_entry **kv_find(struct kv_state *kv, const char *key, int len, uint32_t hash) {
+    struct kv_entry **ep = &kv->buckets[hash & (kv->num_buckets - 1)];
+
+    for (; *ep != NULL; ep = &(*ep)->next) {
+        if ((*ep)->hash == hash && (*ep)->key_len == len && memcmp((*ep)->data, key, len) == 0) break;
+    }
+    return ep;
+}
+
+// Double the buckets once there is more than one entry per bucket on average
+static void kv_grow(struct kv_state *kv) {
+    uint32_t new_num = kv->num_buckets * 2;
+    struct kv_entry **new_buckets = (struct kv_entry **) calloc(new_num, sizeof(struct kv_entry *));
+    struct kv_entry *e, *next;
+
+    if (new_buckets == NULL) return;
+    for (uint32_t b = 0; b < kv->num_buckets; b++) {
+        for (e = kv->buckets[b]; e != NULL; e = next) {
+            next = e->next;
+            e->next = new_buckets[e->hash & (new_num - 1)];
+            new_buckets[e->hash & (new_num - 1)] = e;
+        }
+    }
+    free(kv->buckets);
+    kv->buckets = new_buckets;
+    kv->num_buckets = new_num;
+}
+
+static char kv_put(struct kv_state *kv, const char *key, int key_len, uint32_t hash, const char *value,
+                   int value_len) {
+    struct kv_entry **ep = kv_find(kv, key, key_len, hash);
+    struct kv_entry *e = *ep;
+    struct kv_entry *new_e;
+
+    if (e == NULL && kv->count >= KV_MAX_KEYS) return KV_FULL;
+    new_e = (struct kv_entry *) malloc(sizeof(struct kv_entry) + key_len + value_len);
+    if (new_e == NULL) return KV_FULL;
+    new_e->hash = hash;
+    new_e->key_len = (uint8_t) key_len;
+    new_e->value_len = (uint8_t) value_len;
+    memcpy(new_e->data, key, key_len);
+    memcpy(new_e->data + key_len, value, value_len);
+
+    // A new value takes the place of the old one in its chain
+    if (e != NULL) {
+        new_e->next = e->next;
+        *ep = new_e;
+        free(e);
+        return KV_OK;
+    }
+    new_e->next = NULL;
+    *ep = new_e;
+    if (++kv->count > kv->num_buckets) kv_grow(kv);
+    return KV_OK;
+}
+
+static void kv_recv(void *state, struct packet *pkt) {
+    struct kv_state *kv = (struct kv_state *) state;
+    struct packet *reply;
+    struct kv_entry **ep;
+    struct kv_entry *e;
+    const char *key = pkt->payload + PKT_KV_KEY;
+    int key_len;
+    uint32_t hash;
+
+    if (pkt->type != (char) PKT_KV_PUT && pkt->type != (char) PKT_KV_GET && pkt->type != (char) PKT_KV_DELETE) {
+        free(pkt);
+        return;
+    }
+    reply = server_packet(kv->srv, (int) (unsigned char) pkt->src, PKT_KV_REPLY);
+    memcpy(reply->payload + PKT_KV_REQ_ID, pkt->payload + PKT_KV_REQ_ID, 2);
+    reply->length = PKT_KV_VALUE;
+
+    key_len = pkt->length > PKT_KV_KEY_LENGTH ? (unsigned char) pkt->payload[PKT_KV_KEY_LENGTH] : 0;
+    if (pkt->length > PAYLOAD_MAX || key_len == 0 || PKT_KV_KEY + key_len > pkt->length) {
+        reply->payload[PKT_KV_STATUS] = KV_INVALID;
+        server_send(kv->srv, reply);
+        free(pkt);
+        return;
+    }
+    hash = crc32c(key, key_len);
+
+    switch (pkt->type) {
+        case (char) PKT_KV_PUT: {
+            reply->payload[PKT_KV_STATUS] = kv_put(kv, key, key_len, hash, key + key_len,
+                                                   pkt->length - PKT_KV_KEY - key_len);
+            break;
+        }
+        case (char) PKT_KV_GET: {
+            e = *kv_find(kv, key, key_len, hash);
+            if (e == NULL) {
+                reply->payload[PKT_KV_STATUS] = KV_NOT_FOUND;
+                break;
+            }
+            // A value always fits, it came in a packet with its key in front
+            reply->payload[PKT_KV_STATUS] = KV_OK;
+            memcpy(reply->payload + PKT_KV_VALUE, e->data + e->key_len, e->value_len);
+            reply->length += e->value_len;
+            break;
+        }
+        default: {
+            ep = kv_find(kv, key, key_len, hash);
+            if (*ep == NULL) {
+                reply->payload[PKT_KV_STATUS] = KV_NOT_FOUND;
+                break;
+            }
+            e = *ep;
+            *ep = e->next;
+            free(e);
+            kv->count--;
+            reply->payload[PKT_KV_STATUS] = KV_OK;
+            break;
+        }
+    }
+    server_send(kv->srv, reply);
+    free(pkt);
+}
+
+static int kv_report(void *state, char *buf, int size) {
+    struct kv_state *kv = (struct kv_state *) state;
+
+    return snprintf(buf, size, "kv: %u keys in %u buckets\n", kv->count, kv->num_buckets);
+}
+
+const struct service kv_service = {
+    .name = "kv",
+    .types = {{PKT_KV_PUT, PKT_KV_REPLY}},
+    .start = kv_start,
+    .recv = kv_recv,
+    .report = kv_report,
+};
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file lz.c
+/// @version 1.0
+///
+/// Each sequence is a token byte (literal length in the high nibble,
+/// match length - 4 in the low nibble, 15 means more length bytes follow),
+/// the literals, then a 2 byte match offset and any extra length bytes.
+/// The last sequence has literals only.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <string.h>
+
+#include "lz.h"
+
+#define LZ_MIN_MATCH    4
+#define LZ_MAX_OFFSET   65535
+#define LZ_HASH_BITS    12
+
+static uint32_t read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t lz_hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Write a length that did not fit in its nibble, -1 if out of room
+static int put_length(unsigned char *dst, int pos, int cap, int len) {
+    while (len >= 255) {
+        if (pos >= cap) return -1;
+        dst[pos++] = 255;
+        len -= 255;
+    }
+    if (pos >= cap) return -1;
+    dst[pos++] = (unsigned char) len;
+    return pos;
+}
+
+static int put_sequence(unsigned char *dst, int pos, int cap, const unsigned char *lit, int lit_len,
+                        int offset, int match_len) {
+    int token_pos = pos;
+    unsigned char token;
+
+    if (pos >= cap) return -1;
+    pos++;
+    token = (unsigned char) ((lit_len < 15 ? lit_len : 15) << 4);
+    if (lit_len >= 15 && (pos = put_length(dst, pos, cap, lit_len - 15)) < 0) return -1;
+    if (pos + lit_len > cap) return -1;
+    memcpy(dst + pos, lit, lit_len);
+    pos += lit_len;
+
+    if (match_len > 0) {
+        match_len -= LZ_MIN_MATCH;
+        token |= (unsigned char) (match_len < 15 ? match_len : 15);
+        if (pos + 2 > cap) return -1;
+        dst[pos++] = (unsigned char) (offset & 0xFF);
+        dst[pos++] = (unsigned char) (offset >> 8);
+        if (match_len >= 15 && (pos = put_length(dst, pos, cap, match_len - 15)) < 0) return -1;
+    }
+    dst[token_pos] = token;
+    return pos;
+}
+
+int lz_compress_prefix(const void *buf, int prefix_len, int src_len, void *dst, int dst_cap) {
+    const unsigned char *in = (const unsigned char *) buf;
+    unsigned char *out = (unsigned char *) dst;
+    int table[1 << LZ_HASH_BITS];   // Position + 1 of the last 4 bytes with this hash
+    int ip = prefix_len, anchor = prefix_len, pos = 0;
+    int end = prefix_len + src_len;
+    int ref, len;
+    uint32_t h;
+
+    if (prefix_len < 0 || src_len < 0 || end > LZ_MAX_OFFSET + 1) return -1;
+    memset(table, 0, sizeof(table));
+
+    // Matches may start anywhere in the history
+    for (int i = 0; i + LZ_MIN_MATCH <= prefix_len; i++) {
+        table[lz_hash(read32(in + i))] = i + 1;
+    }
+
+    while (ip + LZ_MIN_MATCH <= end) {
+        h = lz_hash(read32(in + ip));
+        ref = table[h] - 1;
+        table[h] = ip + 1;
+
+        if (ref < 0 || ip - ref > LZ_MAX_OFFSET || read32(in + ref) != read32(in + ip)) {
+            ip++;
+            continue;
+        }
+
+        len = LZ_MIN_MATCH;
+        while (ip + len < end && in[ref + len] == in[ip + len]) len++;
+
+        pos = put_sequence(out, pos, dst_cap, in + anchor, ip - anchor, ip - ref, len);
+        if (pos < 0) return -1;
+        ip += len;
+        anchor = ip;
+    }
+
+    return put_sequence(out, pos, dst_cap, in + anchor, end - anchor, 0, 0);
+}
+
+int lz_compress(const void *src, int src_len, void *dst, int dst_cap) {
+    return lz_compress_prefix(src, 0, src_len, dst, dst_cap);
+}
+
+// Read one extra length byte, -1 if src runs out
+static int get_length(const unsigned char *src, int *pos, int src_len) {
+    if (*pos >= src_len) return -1;
+    return src[(*pos)++];
+}
+
+int lz_decompress_prefix(const void *src, int src_len, void *buf, int prefix_len, int buf_cap) {
+    const unsigned char *in = (const unsigned char *) src;
+    unsigned char *out = (unsigned char *) buf;
+    int ip = 0, op = prefix_len;
+    int dst_cap = buf_cap;
+    int token, lit_len, match_len, offset, b;
+
+    while (ip < src_len) {
+        token = in[ip++];
+
+        lit_len = token >> 4;
+        if (lit_len == 15) {
+            do {
+                if ((b = get_length(in, &ip, src_len)) < 0) return -1;
+                lit_len += b;
+            } while (b == 255);
+        }
+        if (ip + lit_len > src_len || op + lit_len > dst_cap) return -1;
+        memcpy(out + op, in + ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        if (ip == src_len) break;  // Last sequence has no match
+
+        if (ip + 2 > src_len) return -1;
+        offset = in[ip] | (in[ip + 1] << 8);
+        ip += 2;
+        match_len = (token & 0x0F);
+        if (match_len == 15) {
+            do {
+                if ((b = get_length(in, &ip, src_len)) < 0) return -1;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > op || op + match_len > dst_cap) return -1;
+        // Byte by byte, the match may overlap what it is copying
+        for (int i = 0; i < match_len; i++, op++) {
+            out[op] = out[op - offset];
+        }
+    }
+    return op - prefix_len;
+}
+
+int lz_decompress(const void *src, int src_len, void *dst, int dst_cap) {
+    return lz_decompress_prefix(src, src_len, dst, 0, dst_cap);
+}
@@ -0,0 +1,33 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file lz.h
+/// @version 1.0
+///
+/// Small LZ77 block codec (LZ4 style sequences) used to compress file
+/// transfer chunks. Blocks are at most 64 KB.
+///
+/// The _prefix versions let matches reach back into bytes both ends
+/// already have (the start of the same file block), which is what makes
+/// small chunks compress well.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_LZ_H
+#define NETWORK_SIMULATOR_02_LZ_H
+
+// Compress src into dst, returns the compressed length or -1 if it does not fit in dst_cap
+int lz_compress(const void *src, int src_len, void *dst, int dst_cap);
+
+// Decompress src into dst, returns the decompressed length or -1 if src is malformed
+int lz_decompress(const void *src, int src_len, void *dst, int dst_cap);
+
+// buf holds prefix_len bytes of history followed by src_len bytes to compress
+int lz_compress_prefix(const void *buf, int prefix_len, int src_len, void *dst, int dst_cap);
+
+// buf holds prefix_len bytes of history, the output is written after it
+int lz_decompress_prefix(const void *src, int src_len, void *buf, int prefix_len, int buf_cap);
+
+#endif //NETWORK_SIMULATOR_02_LZ_H
@@ -13,17 +13,85 @@
 #include "host.h"
 #include "switch.h"
 #include "server.h"
+#include "man_script.h"
+#include "metrics.h"
+#include "capture.h"
+#include "trace.h"
 
 const char* program_name;
 
+static void usage(void) {
+    fprintf(stderr, "Usage: %s [-c network file] [-s script [-o results file] [-f csv|json]]"
+                    " [-m metrics file|unix:socket [-i ms]] [-p capture prefix [-P filter]] [-t]\n", program_name);
+    exit(EXIT_FAILURE);
+}
+
 int main(int argc, char *argv[]) {
     program_name = argv[0];
-    if (argc > 1) {
+
+    const char *config = NULL;      /* Network configuration file, asked for if not given */
+    const char *script = NULL;      /* Commands to run instead of the menu */
+    const char *results = NULL;
+    enum script_format format = SCRIPT_CSV;
+    const char *metrics = NULL;     /* Where the manager writes the counters of every node */
+    uint32_t metrics_ms = METRICS_INTERVAL_MS;
+    const char *capture = NULL;     /* Packets sent go to <capture>.<node id>.pcap */
+    const char *capture_filter = NULL;
+    FILE *out = stdout;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:s:o:f:m:i:p:P:t")) != -1) {
+        switch (opt) {
+            case 'c':
+                config = optarg;
+                break;
+            case 's':
+                script = optarg;
+                break;
+            case 'o':
+                results = optarg;
+                break;
+            case 'f':
+                if (strcmp(optarg, "json") == 0) {
+                    format = SCRIPT_JSON;
+                } else if (strcmp(optarg, "csv") != 0) {
+                    usage();
+                }
+                break;
+            case 'm':
+                metrics = optarg;
+                break;
+            case 'i':
+                metrics_ms = (uint32_t) atoi(optarg);
+                break;
+            case 'p':
+                capture = optarg;
+                break;
+            case 'P':
+                capture_filter = optarg;
+                break;
+            case 't':
+                trace_on = true;
+                break;
+            default:
+                usage();
+        }
+    }
+    if (optind < argc) {
         fprintf(stderr, "%s Invalid usage: Too many arguments\n", program_name);
+        usage();
+    }
+    if (capture != NULL && !capture_configure(capture, capture_filter)) {
+        fprintf(stderr, "%s: invalid capture filter \"%s\", expected node=, port= and type= lists\n", program_name,
+                capture_filter);
         exit(EXIT_FAILURE);
-    } else if (argc < 1) {
-        fprintf(stderr, "%s: Unknown error\n", program_name);
-        exit(EXIT_FAILURE);
+    }
+    if (results != NULL) {
+        out = fopen(results, "w");
+        if (out == NULL) {
+            fprintf(stderr, "%s: cannot write %s\n", program_name, results);
+            exit(EXIT_FAILURE);
+        }
     }
 
     pid_t pid;  /* Process id */
@@ -37,7 +105,7 @@ int main(int argc, char *argv[]) {
  *   - nodes, creates a list of nodes
  *   - links, creates/implements the links, e.g., using pipes or sockets
  */
-    net_init();
+    net_init(config);
     node_list = net_get_node_list(); /* Returns the list of nodes */
 
 
@@ -51,6 +119,7 @@ int main(int argc, char *argv[]) {
             printf("Error:  the fork() failed\n");
             return 1;
         } else if (pid == 0) { /* The child process, which is a node  */
+            capture_start(p_node->id);
             if (p_node->type == HOST) {  /* Execute host routine */
                 host_main(p_node->id);
             } else if (p_node->type == SWITCH) {
@@ -64,9 +133,17 @@ int main(int argc, char *argv[]) {
     }
 
 /* 
- * Parent process: Execute manager routine. 
+ * Parent process: Execute manager routine, or the script of commands
  */
-    man_main();
+    if (metrics != NULL && !metrics_export_start(metrics, metrics_ms)) {
+        fprintf(stderr, "%s: cannot export metrics to %s\n", program_name, metrics);
+    }
+    if (script != NULL) {
+        man_script_run(net_get_man_ports_at_man_list(), script, out, format);
+        if (out != stdout) fclose(out);
+    } else {
+        man_main();
+    }
 
 
 /* 
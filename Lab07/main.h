@@ -10,6 +10,9 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 
 enum NetNodeType { /* Types of network nodes */
 	HOST,
@@ -28,22 +31,34 @@ struct net_node { /* Network node, e.g., host or switch */
 	struct net_node *next;
 };
 
+struct metrics_port;
+
 struct net_port { /* port to communicate with another node */
 	enum NetLinkType type;
 	int pipe_host_id;
 	int pipe_send_fd;
 	int pipe_recv_fd;
+	int index;			/* Of the port at its node, in link order */
+	struct metrics_port *metrics;	/* Its counters, NULL if there are none */
 	struct net_port *next;
 };
 
 /* Packet sent between nodes  */
 
+struct packet_trace { /* Where a traced packet is on its hop through this node */
+	uint32_t id;		/* 0 until it is sent */
+	uint64_t ingress_us;	/* When it arrived, 0 if it started here */
+	uint64_t dequeued_us;	/* When it was taken from the job queue */
+	bool forwarded;		/* Its forward time is counted, a flooded one is sent once per port */
+};
+
 struct packet { /* struct for a packet */
 	char src;
 	char dst;
 	char type;
 	int length;
 	char payload[PAYLOAD_MAX];
+	struct packet_trace trace;	/* Zero unless it arrived traced, see trace.h */
 };
 
 /* Types of packets */
@@ -65,17 +80,209 @@ struct packet { /* struct for a packet */
 
 #define PKT_CONTROL_PKT         11
 
+#define PKT_FILE_UPLOAD_MIDDLE_LZ   12
+#define PKT_FILE_ACK                13
+
+#define PKT_DNS_QUERY               14
+#define PKT_DNS_QUERY_REPLY         15
+
+#define PKT_DNS_BEACON              16
+#define PKT_DNS_REPLICATE           17
+#define PKT_DNS_REPLICATE_ACK       18
+
+#define PKT_DNS_UNREGISTER          19
+#define PKT_DNS_UNREGISTER_REPLY    20
+#define PKT_DNS_RENEW               21
+#define PKT_DNS_RENEW_REPLY         22
+
+#define PKT_ECHO_REQ                32
+#define PKT_ECHO_REPLY              33
+
+#define PKT_KV_PUT                  40
+#define PKT_KV_GET                  41
+#define PKT_KV_DELETE               42
+#define PKT_KV_REPLY                43
+
+#define PKT_TRAFFIC                 44
+
+// PKT_PING_REQ:   [ping id][sequence number][time sent in us][padding]
+// PKT_PING_REPLY: the payload of the request, sent back
+//
+// The time is the sender's clock, only the sender reads it (ping.h).
+#define PKT_PING_ID             0
+#define PKT_PING_SEQ            2
+#define PKT_PING_TIME           4
+#define PKT_PING_LENGTH         12
+
 // packet payload indexes
 //#define PKT_ROOT_ID             0
 //#define PKT_ROOT_DIST           4
 //#define PKT_SENDER_TYPE         8
 //#define PKT_SENDER_CHILD        9
 
-// DNS server id
-#define DNS_SERVER_ID           100
+// Destination of packets meant for every node, such as DNS beacons.
+// Switches never learn it, so they flood it.
+#define BROADCAST_ID            127
+
+// PKT_DNS_BEACON: [requests per second][names registered][cpu]
+//
+// Every DNS server (a 'D' node, any number of them) sends one now and
+// then, so hosts can see which servers are up and how busy they are.
+// cpu is the share of one core the server used since its last beacon,
+// in tenths of a percent.
+#define PKT_DNS_BEACON_LOAD     0
+#define PKT_DNS_BEACON_NAMES    4
+#define PKT_DNS_BEACON_CPU      8
+#define PKT_DNS_BEACON_LENGTH   12
+
+// DNS payload indexes
+// PKT_DNS_LOOKUP:         [request id][count][count x ([name length][name])]
+// PKT_DNS_LOOKUP_REPLY:   [request id][count][count x answer]
+//   answer:               [status][host id][ttl in seconds][name length][name]
+// PKT_DNS_REGISTER:       [request id][count][count x ([name length][name])]
+// PKT_DNS_REGISTER_REPLY: [request id][count][count x status][lease in seconds]
+// PKT_DNS_RENEW and PKT_DNS_UNREGISTER are laid out as PKT_DNS_REGISTER,
+// and so are their replies (the unregister reply has no lease).
+//
+// One packet carries as many names as fit. Answers repeat the name so a
+// host can match them to its queries, and the ttl says how long they may
+// be cached (also for DNS_NOT_FOUND). If the answers to one lookup do not
+// fit in one reply the server sends several with the same request id.
+//
+// A registration only lasts for its lease; the host renews the names it
+// holds before then, or they expire and may be taken by another host.
+#define PKT_DNS_REQ_ID          0
+#define PKT_DNS_COUNT           2
+#define PKT_DNS_RECORDS         3
+
+#define DNS_ANSWER_STATUS       0
+#define DNS_ANSWER_HOST_ID      1
+#define DNS_ANSWER_TTL          2
+#define DNS_ANSWER_NAME_LENGTH  (2 + sizeof(int))
+#define DNS_ANSWER_NAME         (3 + sizeof(int))
+
+// Longest name whose answer fits in a reply, longer ones cannot be registered
+#define DNS_NAME_MAX            ((int) (PAYLOAD_MAX - PKT_DNS_RECORDS - DNS_ANSWER_NAME))
+
+#define DNS_FOUND               'S'
+#define DNS_NOT_FOUND           'F'
+
+// Registration status
+#define DNS_REG_OK              'S'
+#define DNS_REG_TOO_LONG        'L'
+#define DNS_REG_INVALID         'I'
+#define DNS_REG_TAKEN           'A'
+#define DNS_REG_UNKNOWN         'N'     /* Renew or unregister of a name the host does not hold */
+
+// PKT_DNS_REPLICATE:     [epoch][phase][position][count][count x ([op][host id][name length][expiry][name])]
+// PKT_DNS_REPLICATE_ACK: [epoch][phase][position]
+//
+// Each server streams its changes to every other server. A stream
+// starts with a copy of the whole table (phase DNS_SYNC, position is the
+// byte offset in the sender's image of the table; the one empty page of
+// an empty table counts one) and then carries the log of changes (phase
+// DNS_LOG, position is the change number). The ack gives the position the
+// receiver expects next; a new epoch means the sender restarted and the
+// stream starts over.
+#define PKT_DNS_REP_EPOCH       0
+#define PKT_DNS_REP_PHASE       4
+#define PKT_DNS_REP_POSITION    5
+#define PKT_DNS_REP_COUNT       9
+#define PKT_DNS_REP_RECORDS     10
+#define PKT_DNS_REP_ACK_LENGTH  9
+
+#define DNS_SYNC                'S'
+#define DNS_LOG                 'L'
+
+// PKT_DNS_QUERY:       [skip][pattern]
+// PKT_DNS_QUERY_REPLY: [skip][count][more][ttl in seconds][count x ([host id][name length][name])]
+//
+// Patterns are names where "*" stands for any one label and a leading
+// "**" for any number of them. Matches that do not fit in one reply are
+// fetched with another query that skips the ones already received.
+#define PKT_DNS_QUERY_SKIP      0
+#define PKT_DNS_QUERY_PATTERN   2
+#define PKT_DNS_MATCH_SKIP      0
+#define PKT_DNS_MATCH_COUNT     2
+#define PKT_DNS_MATCH_MORE      3
+#define PKT_DNS_MATCH_TTL       4
+#define PKT_DNS_MATCH_LIST      (4 + sizeof(int))
 
 #define PKT_ROOT_ID         0
 #define PKT_ROOT_DIST       sizeof(int)
 #define PKT_SENDER_TYPE     (sizeof(int) * 2)
 #define PKT_SENDER_CHILD    ((sizeof(int) * 2) + sizeof(char))
 #define PKT_CONTROL_LENGTH  ((sizeof(int) * 2) + sizeof(char) + 1)
+
+// File transfer payload indexes
+// PKT_FILE_UPLOAD_START:     [file id][file size][file crc][start offset][flags][file name]
+// PKT_FILE_UPLOAD_MIDDLE:    [file id][offset][chunk crc][data]
+// PKT_FILE_UPLOAD_MIDDLE_LZ: [file id][offset][crc of the raw data][raw length][LZ compressed data]
+// PKT_FILE_UPLOAD_END:       [file id][file size][file crc]
+// PKT_FILE_DOWNLOAD_REQ:     [start offset][length, 0 means to the end][stripe][stripe count][flags][file name]
+// PKT_FILE_ACK:              [file id][chunk offset][next missing offset of the stripe]
+//
+// The file id is the CRC32C of the file name. Chunks, ends and acks are
+// matched to their transfer by it and the host they come from, so
+// several files can go between the same two hosts at once.
+//
+// With a stripe count of N the sender only sends the blocks of
+// PKT_FILE_BLOCK bytes whose index % N == stripe, so N hosts holding the
+// same file can each send a disjoint part of it.
+#define PKT_FILE_ID             0
+#define PKT_FILE_SIZE           sizeof(int)
+#define PKT_FILE_DIGEST         (sizeof(int) * 2)
+#define PKT_FILE_START_OFFSET   (sizeof(int) * 3)
+#define PKT_FILE_START_FLAGS    (sizeof(int) * 4)
+#define PKT_FILE_START_NAME     ((sizeof(int) * 4) + 1)
+#define PKT_FILE_END_LENGTH     (sizeof(int) * 3)
+
+#define PKT_FILE_OFFSET         sizeof(int)
+#define PKT_FILE_CHUNK_CRC      (sizeof(int) * 2)
+#define PKT_FILE_CHUNK_DATA     (sizeof(int) * 3)
+#define PKT_FILE_CHUNK_MAX      (PAYLOAD_MAX - PKT_FILE_CHUNK_DATA)
+#define PKT_FILE_RAW_LENGTH     (sizeof(int) * 3)
+#define PKT_FILE_LZ_DATA        ((sizeof(int) * 3) + 2)
+#define PKT_FILE_LZ_MAX         (PAYLOAD_MAX - PKT_FILE_LZ_DATA)
+
+#define PKT_FILE_REQ_OFFSET     0
+#define PKT_FILE_REQ_LENGTH     sizeof(int)
+#define PKT_FILE_REQ_STRIPE     (sizeof(int) * 2)
+#define PKT_FILE_REQ_STRIPES    ((sizeof(int) * 2) + 1)
+#define PKT_FILE_REQ_FLAGS      ((sizeof(int) * 2) + 2)
+#define PKT_FILE_REQ_NAME       ((sizeof(int) * 2) + 3)
+
+#define PKT_FILE_ACK_OFFSET     sizeof(int)
+#define PKT_FILE_ACK_NEXT       (sizeof(int) * 2)
+#define PKT_FILE_ACK_LENGTH     (sizeof(int) * 3)
+
+#define PKT_FILE_BLOCK          (PKT_FILE_CHUNK_MAX * 10)
+
+// File transfer flags
+#define FILE_FLAG_COMPRESS      0x01    /* Chunks may be sent as PKT_FILE_UPLOAD_MIDDLE_LZ */
+
+// PKT_ECHO_REQ:   [data]
+// PKT_ECHO_REPLY: [data], the same bytes sent back
+
+// PKT_KV_PUT:    [request id][key length][key][value]
+// PKT_KV_GET:    [request id][key length][key]
+// PKT_KV_DELETE: [request id][key length][key]
+// PKT_KV_REPLY:  [request id][status][value, for a get that found the key]
+//
+// The key-value store of a server node. Keys and values are bytes, the
+// value is whatever follows the key up to the end of the packet.
+#define PKT_KV_REQ_ID           0
+#define PKT_KV_KEY_LENGTH       2
+#define PKT_KV_KEY              3
+#define PKT_KV_STATUS           2
+#define PKT_KV_VALUE            3
+
+#define KV_OK                   'S'
+#define KV_NOT_FOUND            'F'
+#define KV_INVALID              'I'
+#define KV_FULL                 'E'
+
+// PKT_TRAFFIC:   [sequence number, when the payload has room][filler]
+//
+// Load from a host's traffic generator (traffic.h), counted and dropped
+// by the host it goes to.
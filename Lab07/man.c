@@ -15,6 +15,7 @@
 #include "man.h"
 #include "net.h"
 #include "host.h"
+#include "man_matrix.h"
 
 #define MAXBUFFER 1000
 #define PIPE_WRITE 1
@@ -49,10 +50,19 @@ char man_get_user_cmd(int curr_host) {
         printf("   (p) Ping a host\n");
         printf("   (u) Upload a file to a host\n");
         printf("   (d) Download a file from a host\n");
-        printf("   (r) Register a new Domain name with the Domain Name Server\n");
-        printf("   (l) Lookup a host with their Domain Name\n");
+        printf("   (M) Download a file from several hosts at once\n");
+        printf("   (z) Turn file transfer compression on or off\n");
+        printf("   (r) Register Domain names (comma separated) with the Domain Name Server\n");
+        printf("   (U) Unregister Domain names (comma separated)\n");
+        printf("   (l) Lookup hosts with their Domain Names (comma separated)\n");
+        printf("   (f) Find the Domain Names matching a pattern\n");
         printf("   (P) Ping a host with their Domain Name\n");
         printf("   (D) Download from a host by giving its Domain Name\n");
+        printf("   (L) Send DNS requests to the nearest or the least loaded server\n");
+        printf("   (k) Get, put or delete a key in a server's key-value store\n");
+        printf("   (g) Start or stop the host's traffic generator\n");
+        printf("   (A) Ping every host and server from every host\n");
+        printf("   (n) Query a switch or server\n");
         printf("   (q) Quit\n");
         printf("   Enter Command: ");
         do {
@@ -68,10 +78,19 @@ char man_get_user_cmd(int curr_host) {
             case 'p':
             case 'u':
             case 'd':
+            case 'M':
+            case 'z':
             case 'r':
+            case 'U':
             case 'l':
+            case 'f':
             case 'P':
             case 'D':
+            case 'L':
+            case 'k':
+            case 'g':
+            case 'A':
+            case 'n':
             case 'q':
                 return cmd;
             default:
@@ -139,6 +158,12 @@ void display_host_state(struct man_port_at_man *curr_host) {
     sscanf(reply, "%s %d", dir, &host_id);
     printf("Host %d state: \n", host_id);
     printf("    Directory = %s\n", dir);
+
+    // Transfers in progress and the DNS cache follow the first line
+    char *details = strchr(reply, '\n');
+    if (details != NULL) {
+        printf("%s", details + 1);
+    }
 }
 
 
@@ -156,24 +181,25 @@ void set_host_dir(struct man_port_at_man *curr_host) {
 /* 
  * Command host to send a ping to the host with id "curr_host"
  *
- * User is queried for the id of the host to ping.
+ * User is queried for the id of the host to ping, and the
+ * options of ping.h: count=, interval=, flood, size= and wait=.
  *
  * A command message is sent to the current host.
  *    The message starrts with 'p' followed by the id 
- *    of the host to ping.
+ *    of the host to ping and the options.
  * 
- * Wiat for a reply
+ * Wiat for a reply, the RTTs of all the requests
  */
 
 void ping(struct man_port_at_man *curr_host) {
     char msg[MAN_MSG_LENGTH];
     char reply[MAN_MSG_LENGTH];
-    int host_to_ping;
+    char request[MAN_MSG_LENGTH - 2];
     int n;
 
-    printf("Enter id of host to ping: ");
-    scanf("%d", &host_to_ping);
-    n = sprintf(msg, "p %d", host_to_ping);
+    printf("Enter id of host to ping and options (count= interval= flood size= wait=): ");
+    scanf(" %997[^\n]", request);
+    n = snprintf(msg, MAN_MSG_LENGTH, "p %s", request);
 
     write(curr_host->send_fd, msg, n);
 
@@ -235,13 +261,61 @@ int file_download(struct man_port_at_man *curr_host) {
     usleep(TENMILLISEC);
 }
 
+/*
+ * Download one file from several hosts that all have it.
+ * Each host sends a disjoint part of the file.
+ *
+ * The message is 'M' followed by the file name and the host ids
+ */
+void file_download_multi(struct man_port_at_man *curr_host) {
+    int n, k;
+    int num_hosts;
+    int host_id;
+    char name[MAX_NAME_LENGTH];
+    char msg[MAN_MSG_LENGTH];
+
+    printf("Enter file name to download: ");
+    scanf("%s", name);
+    printf("Enter number of hosts to download from: ");
+    scanf("%d", &num_hosts);
+
+    n = snprintf(msg, MAN_MSG_LENGTH, "M %s", name);
+    for (k = 0; k < num_hosts; k++) {
+        printf("Enter host id of source %d: ", k + 1);
+        scanf("%d", &host_id);
+        n += snprintf(msg + n, MAN_MSG_LENGTH - n, " %d", host_id);
+    }
+    printf("\n");
+
+    write(curr_host->send_fd, msg, n);
+    usleep(TENMILLISEC);
+}
+
+/* Send a command without arguments that flips a setting, and print the reply */
+void toggle_host_setting(struct man_port_at_man *curr_host, char cmd) {
+    char msg[MAN_MSG_LENGTH];
+    char reply[MAN_MSG_LENGTH];
+    int n;
+
+    msg[0] = cmd;
+    write(curr_host->send_fd, msg, 1);
+
+    n = 0;
+    while (n <= 0) {
+        usleep(TENMILLISEC);
+        n = read(curr_host->recv_fd, reply, MAN_MSG_LENGTH);
+    }
+    reply[n] = '\0';
+    printf("%s\n", reply);
+}
+
 void dns_register(struct man_port_at_man *curr_host) {
     int n;
     char domainName[MAX_NAME_LENGTH];
     char msg[MAX_NAME_LENGTH];
     char reply[MAN_MSG_LENGTH];
 
-    printf("Enter name to register with DNS: ");
+    printf("Enter names to register with DNS (comma separated): ");
     scanf("%s", domainName);
     printf("\n");
 
@@ -257,13 +331,140 @@ void dns_register(struct man_port_at_man *curr_host) {
     printf("%s\n", reply);
 }
 
+void dns_unregister(struct man_port_at_man *curr_host) {
+    int n;
+    char domainName[MAX_NAME_LENGTH];
+    char msg[MAX_NAME_LENGTH];
+    char reply[MAN_MSG_LENGTH];
+
+    printf("Enter names to unregister (comma separated): ");
+    scanf("%s", domainName);
+    printf("\n");
+
+    n = snprintf(msg, MAX_NAME_LENGTH, "U %s", domainName);
+    write(curr_host->send_fd, msg, n);
+
+    ssize_t i = 0;
+    while (i <= 0) {
+        usleep(TENMILLISEC);
+        i = read(curr_host->recv_fd, reply, MAN_MSG_LENGTH - 1);
+    }
+    reply[i] = '\0';
+    printf("%s\n", reply);
+}
+
+void kv_request(struct man_port_at_man *curr_host) {
+    int n;
+    char request[MAN_MSG_LENGTH - 2];
+    char msg[MAN_MSG_LENGTH];
+    char reply[MAN_MSG_LENGTH];
+
+    printf("Enter server id, get/put/delete, key and value for a put: ");
+    scanf(" %997[^\n]", request);
+    printf("\n");
+
+    n = snprintf(msg, MAN_MSG_LENGTH, "k %s", request);
+    write(curr_host->send_fd, msg, n);
+
+    ssize_t i = 0;
+    while (i <= 0) {
+        usleep(TENMILLISEC);
+        i = read(curr_host->recv_fd, reply, MAN_MSG_LENGTH - 1);
+    }
+    reply[i] = '\0';
+    printf("%s\n", reply);
+}
+
+void traffic_request(struct man_port_at_man *curr_host) {
+    int n;
+    char request[MAN_MSG_LENGTH - 2];
+    char msg[MAN_MSG_LENGTH];
+    char reply[MAN_MSG_LENGTH];
+
+    printf("Enter cbr, poisson, onoff or shuffle and options (rate= size= dst= seed= time= burst= idle=), or stop: ");
+    scanf(" %997[^\n]", request);
+    printf("\n");
+
+    n = snprintf(msg, MAN_MSG_LENGTH, "g %s", request);
+    write(curr_host->send_fd, msg, n);
+
+    ssize_t i = 0;
+    while (i <= 0) {
+        usleep(TENMILLISEC);
+        i = read(curr_host->recv_fd, reply, MAN_MSG_LENGTH - 1);
+    }
+    reply[i] = '\0';
+    printf("%s\n", reply);
+}
+
+/*
+ * Ping sweep from every host at once, printing the matrix of ping times
+ * and per host how many nodes it reached.
+ */
+void ping_all(struct man_port_at_man *host_list) {
+    struct ping_matrix pm;
+    struct man_async m;
+    int repeat, sample;
+
+    printf("Enter pings per pair and destinations per host (0 for all): ");
+    if (scanf("%d %d", &repeat, &sample) != 2) return;
+    printf("\n");
+
+    if (!man_async_init(&m, host_list)) {
+        printf("Out of memory\n");
+        return;
+    }
+    if (ping_matrix_run(&pm, &m, host_list, repeat, sample, NULL, NULL)) {
+        ping_matrix_print(&pm, stdout);
+        ping_matrix_free(&pm);
+    }
+    man_async_free(&m);
+}
+
+/*
+ * Ask a switch or server about its state:
+ *    s - state, queue and drop counts; for a server its services
+ *    f - forwarding table, the port each node is reached on
+ *    t - spanning tree role and packet counts of each port (switches)
+ */
+void node_query(struct man_port_at_man *node_list) {
+    struct man_port_at_man *p;
+    char reply[MAN_MSG_LENGTH];
+    char query;
+    int node_id;
+    int n, k;
+
+    printf("Enter switch or server id and query (s state, f forwarding table, t spanning tree): ");
+    if (scanf("%d %c", &node_id, &query) != 2) return;
+    printf("\n");
+
+    for (p = node_list; p != NULL && p->host_id != node_id; p = p->next);
+    if (p == NULL) {
+        printf("No switch or server %d\n", node_id);
+        return;
+    }
+    write(p->send_fd, &query, 1);
+
+    n = 0;
+    for (k = 0; n <= 0 && k < DELAY_FOR_HOST_REPLY * 10; k++) {
+        usleep(TENMILLISEC);
+        n = read(p->recv_fd, reply, MAN_MSG_LENGTH - 1);
+    }
+    if (n <= 0) {
+        printf("Node %d did not answer\n", node_id);
+        return;
+    }
+    reply[n] = '\0';
+    printf("%s\n", reply);
+}
+
 void dns_lookup(struct man_port_at_man *curr_host) {
     int n;
     char domainName[MAX_NAME_LENGTH];
     char msg[MAN_MSG_LENGTH];
     char reply[MAN_MSG_LENGTH];
 
-    printf("Enter name to lookup with DNS: ");
+    printf("Enter names to lookup with DNS (comma separated): ");
     scanf("%s", domainName);
     printf("\n");
 
@@ -279,17 +480,39 @@ void dns_lookup(struct man_port_at_man *curr_host) {
     printf("%s\n", reply);
 }
 
+void dns_find(struct man_port_at_man *curr_host) {
+    int n;
+    char pattern[MAX_NAME_LENGTH];
+    char msg[MAN_MSG_LENGTH];
+    char reply[MAN_MSG_LENGTH];
+
+    printf("Enter a name pattern, * matches one label, a leading ** any number (e.g. *.rack1.dc): ");
+    scanf("%s", pattern);
+    printf("\n");
+
+    n = snprintf(msg, MAX_NAME_LENGTH, "f %s", pattern);
+    write(curr_host->send_fd, msg, n);
+
+    ssize_t i = 0;
+    while (i <= 0) {
+        usleep(TENMILLISEC);
+        i = read(curr_host->recv_fd, reply, MAN_MSG_LENGTH - 1);
+    }
+    reply[i] = '\0';
+    printf("%s\n", reply);
+}
+
 void dns_ping(struct man_port_at_man *curr_host) {
     int n;
-    char domainName[MAX_NAME_LENGTH];
+    char domainName[MAN_MSG_LENGTH - 2];
     char msg[MAN_MSG_LENGTH];
     char reply[MAN_MSG_LENGTH];
 
-    printf("Enter name to ping with DNS: ");
-    scanf("%s", domainName);
+    printf("Enter name to ping with DNS and options (count= interval= flood size= wait=): ");
+    scanf(" %997[^\n]", domainName);
     printf("\n");
 
-    n = snprintf(msg, MAX_NAME_LENGTH,"P %s", domainName);
+    n = snprintf(msg, MAN_MSG_LENGTH, "P %s", domainName);
     write(curr_host->send_fd, msg, n);
 
     ssize_t i = 0;
@@ -370,18 +593,45 @@ void man_main() {
             case 'd': /* Download a file from a host */
                 file_download(curr_host);
                 break;
+            case 'M': /* Download a file from several hosts */
+                file_download_multi(curr_host);
+                break;
+            case 'z': /* Toggle file transfer compression */
+                toggle_host_setting(curr_host, 'z');
+                break;
+            case 'L': /* Toggle how DNS servers are picked */
+                toggle_host_setting(curr_host, 'L');
+                break;
             case 'r': // Register with a domain name
                 dns_register(curr_host);
                 break;
+            case 'U': // Give domain names up
+                dns_unregister(curr_host);
+                break;
             case 'l': // Lookup a host id with a domain name
                 dns_lookup(curr_host);
                 break;
             case 'P': // ping a host with a domain name
                 dns_ping(curr_host);
                 break;
+            case 'f': // List the domain names matching a pattern
+                dns_find(curr_host);
+                break;
             case 'D': // Download from host by giving domain name
                 dns_file_download(curr_host);
                 break;
+            case 'k': // Use the key-value store of a server
+                kv_request(curr_host);
+                break;
+            case 'g': // Traffic generator of the host
+                traffic_request(curr_host);
+                break;
+            case 'A': // Ping sweep from every host
+                ping_all(host_list);
+                break;
+            case 'n': // Query a switch or server
+                node_query(net_get_man_ports_at_man_nodes());
+                break;
             case 'q':  /* Quit */
                 return;
             default:
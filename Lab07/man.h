@@ -2,12 +2,17 @@
  * man.h
  */
 
+#pragma once
+
+#include <stdint.h>
+
 #define MAN_MSG_LENGTH 1000
 
 
 /*
  *  The next two structs are ports used to transfer commands
- *  and replies between the manager and hosts
+ *  and replies between the manager and nodes. Hosts take the
+ *  menu's commands; switches and servers answer queries.
  */
 
 struct man_port_at_host {  /* Port located at the man */
@@ -24,6 +29,13 @@ struct man_port_at_man {  /* Port located at the host */
 	struct man_port_at_man *next;
 };
 
+/*
+ * Node side of a manager port, in host.c. Switches and servers
+ * read and answer the manager the same way hosts do.
+ */
+int get_man_command(struct man_port_at_host *port, char msg[], char *c, uint32_t *tag);
+void man_reply(struct man_port_at_host *port, uint32_t tag, const char *text, int n);
+
 /* 
  * Main loop for the manager.  
  */
@@ -0,0 +1,233 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file man_async.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "man_async.h"
+#include "clock.h"
+
+bool man_async_init(struct man_async *m, struct man_port_at_man *hosts) {
+    struct man_port_at_man *p;
+    int i;
+
+    memset(m, 0, sizeof(struct man_async));
+    for (p = hosts; p != NULL; p = p->next) m->num_hosts++;
+    m->req = (struct man_request *) calloc(MAN_ASYNC_MAX, sizeof(struct man_request));
+    m->hosts = (struct man_async_host *) calloc(m->num_hosts > 0 ? m->num_hosts : 1, sizeof(struct man_async_host));
+    m->fds = (struct pollfd *) calloc(m->num_hosts > 0 ? m->num_hosts : 1, sizeof(struct pollfd));
+    if (m->req == NULL || m->hosts == NULL || m->fds == NULL) {
+        man_async_free(m);
+        return false;
+    }
+
+    for (i = 0, p = hosts; p != NULL; i++, p = p->next) {
+        m->hosts[i].port = p;
+        m->hosts[i].head = -1;
+        m->hosts[i].tail = -1;
+        m->hosts[i].in_flight = -1;
+        m->fds[i].fd = p->recv_fd;
+        m->fds[i].events = POLLIN;
+    }
+    for (i = 0; i < MAN_ASYNC_MAX; i++) m->req[i].next = i + 1 < MAN_ASYNC_MAX ? i + 1 : -1;
+    m->free_head = 0;
+    m->done_head = -1;
+    m->done_tail = -1;
+    return true;
+}
+
+void man_async_free(struct man_async *m) {
+    free(m->req);
+    free(m->hosts);
+    free(m->fds);
+    memset(m, 0, sizeof(struct man_async));
+}
+
+int man_async_outstanding(struct man_async *m) {
+    return m->outstanding;
+}
+
+int man_async_host_id(struct man_async *m, struct man_request *req) {
+    return m->hosts[req->host].port->host_id;
+}
+
+// Write the next queued request of a host if it has none in flight
+static void send_next(struct man_async *m, struct man_async_host *h) {
+    char msg[MAN_ASYNC_CMD_MAX + 16];
+    struct man_request *r;
+    int n;
+
+    if (h->in_flight >= 0 || h->head < 0) return;
+    h->in_flight = h->head;
+    r = &m->req[h->head];
+    h->head = r->next;
+    if (h->head < 0) h->tail = -1;
+
+    n = snprintf(msg, sizeof(msg), "#%u %s\n", r->id, r->cmd);
+    write(h->port->send_fd, msg, n);
+    r->state = MAN_REQ_SENT;
+    r->sent_us = clock_us();
+}
+
+static void complete(struct man_async *m, struct man_async_host *h, int index, enum man_request_state state,
+                     const char *reply) {
+    struct man_request *r = &m->req[index];
+
+    r->state = state;
+    r->done_us = clock_us();
+    snprintf(r->reply, sizeof(r->reply), "%s", reply);
+    r->next = -1;
+    if (m->done_tail < 0) {
+        m->done_head = index;
+    } else {
+        m->req[m->done_tail].next = index;
+    }
+    m->done_tail = index;
+    m->outstanding--;
+
+    h->in_flight = -1;
+    send_next(m, h);
+}
+
+uint32_t man_async_submit(struct man_async *m, int host_id, const char *cmd, uint32_t timeout_ms, void *arg) {
+    struct man_async_host *h = NULL;
+    struct man_request *r;
+    int i, index;
+
+    for (i = 0; i < m->num_hosts; i++) {
+        if (m->hosts[i].port->host_id == host_id) {
+            h = &m->hosts[i];
+            break;
+        }
+    }
+    if (h == NULL || m->free_head < 0) return 0;
+
+    index = m->free_head;
+    r = &m->req[index];
+    m->free_head = r->next;
+
+    // The low bits are the slot, the rest tell this use of it from earlier ones
+    m->generation++;
+    if (m->generation >= UINT32_MAX / MAN_ASYNC_MAX) m->generation = 1;
+    r->id = m->generation * MAN_ASYNC_MAX + (uint32_t) index;
+    r->state = MAN_REQ_QUEUED;
+    r->host = i;
+    snprintf(r->cmd, sizeof(r->cmd), "%s", cmd);
+    r->timeout_ms = timeout_ms;
+    r->queued_us = clock_us();
+    r->sent_us = 0;
+    r->done_us = 0;
+    r->arg = arg;
+    r->reply[0] = '\0';
+    r->next = -1;
+
+    if (h->tail < 0) {
+        h->head = index;
+    } else {
+        m->req[h->tail].next = index;
+    }
+    h->tail = index;
+    m->outstanding++;
+    send_next(m, h);
+    return r->id;
+}
+
+void man_async_release(struct man_async *m, struct man_request *req) {
+    int index = (int) (req - m->req);
+
+    req->id = 0;
+    req->state = MAN_REQ_FREE;
+    req->next = m->free_head;
+    m->free_head = index;
+}
+
+// Match each whole answer a host sent to the request in flight, anything else is dropped
+static void read_answers(struct man_async *m, struct man_async_host *h) {
+    char *msg, *end, *text;
+    unsigned long id;
+    int n, used;
+
+    n = (int) read(h->port->recv_fd, h->buf + h->len, sizeof(h->buf) - 1 - h->len);
+    if (n <= 0) return;
+    h->len += n;
+
+    used = 0;
+    while ((end = memchr(h->buf + used, '\0', h->len - used)) != NULL) {
+        msg = h->buf + used;
+        used = (int) (end - h->buf) + 1;
+        if (msg[0] != '#') continue;
+        id = strtoul(msg + 1, &text, 10);
+        if (*text == ' ') text++;
+        if (h->in_flight >= 0 && m->req[h->in_flight].id == id) {
+            complete(m, h, h->in_flight, MAN_REQ_DONE, text);
+        }
+    }
+
+    // An answer longer than the buffer can never complete
+    if (used == 0 && h->len == (int) sizeof(h->buf) - 1) used = h->len;
+    memmove(h->buf, h->buf + used, h->len - used);
+    h->len -= used;
+}
+
+// Milliseconds until the first request in flight times out, -1 if none is in flight
+static int expire(struct man_async *m, uint64_t now_us) {
+    struct man_async_host *h;
+    struct man_request *r;
+    int64_t left, first = -1;
+    int i;
+
+    for (i = 0; i < m->num_hosts; i++) {
+        h = &m->hosts[i];
+        if (h->in_flight < 0) continue;
+        r = &m->req[h->in_flight];
+        left = (int64_t) r->timeout_ms * 1000 - (int64_t) (now_us - r->sent_us);
+        if (left <= 0) {
+            complete(m, h, h->in_flight, MAN_REQ_TIMEOUT, "");
+            if (h->in_flight < 0) continue;
+            r = &m->req[h->in_flight];
+            left = (int64_t) r->timeout_ms * 1000;
+        }
+        if (first < 0 || left < first) first = left;
+    }
+    return first < 0 ? -1 : (int) ((first + 999) / 1000);
+}
+
+struct man_request *man_async_next(struct man_async *m, int wait_ms) {
+    uint64_t start = clock_us();
+    uint64_t now;
+    int timeout, left, ready, i;
+    int index;
+    bool polled = false;
+
+    while (true) {
+        now = clock_us();
+        timeout = expire(m, now);
+        if (m->done_head >= 0) {
+            index = m->done_head;
+            m->done_head = m->req[index].next;
+            if (m->done_head < 0) m->done_tail = -1;
+            return &m->req[index];
+        }
+
+        left = wait_ms - (int) ((now - start) / 1000);
+        if (left <= 0 && polled) return NULL;
+        if (left < 0) left = 0;
+        if (timeout < 0 || timeout > left) timeout = left;
+        ready = poll(m->fds, m->num_hosts, timeout);
+        polled = true;
+        for (i = 0; i < m->num_hosts && ready > 0; i++) {
+            if (m->fds[i].revents == 0) continue;
+            read_answers(m, &m->hosts[i]);
+        }
+    }
+}
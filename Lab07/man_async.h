@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file man_async.h
+/// @version 1.0
+///
+/// Commands to many hosts at once from the manager. Each command gets a
+/// request id and a slot in a table until it completes. It is sent to
+/// its host as "#<id> <command>\n", and the host puts "#<id> " in front
+/// of its answer, so answers are matched to requests whatever order they
+/// come in and a late answer to a request that timed out is dropped.
+/// One poll() waits on the pipes of every host.
+///
+/// A host takes one manager command at a time, so the manager keeps the
+/// others queued per host and sends the next when one completes. Any
+/// number of hosts run their commands side by side.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_MAN_ASYNC_H
+#define NETWORK_SIMULATOR_02_MAN_ASYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <poll.h>
+
+#include "man.h"
+
+#define MAN_ASYNC_MAX       4096    /* Requests queued, sent or completed but not released; power of two */
+#define MAN_ASYNC_CMD_MAX   128
+
+enum man_request_state {
+    MAN_REQ_FREE,
+    MAN_REQ_QUEUED,
+    MAN_REQ_SENT,
+    MAN_REQ_DONE,
+    MAN_REQ_TIMEOUT
+};
+
+struct man_request {
+    uint32_t id;                    // 0 while the slot is free
+    enum man_request_state state;
+    int host;                       // Index in the host table
+    char cmd[MAN_ASYNC_CMD_MAX];
+    uint32_t timeout_ms;            // From when it is sent
+    uint64_t queued_us;
+    uint64_t sent_us;
+    uint64_t done_us;
+    void *arg;                      // The caller's
+    char reply[MAN_MSG_LENGTH];
+    int next;                       // Next in the queue or list it is on, -1 for none
+};
+
+struct man_async_host {
+    struct man_port_at_man *port;
+    int head;                       // Requests waiting to be sent
+    int tail;
+    int in_flight;                  // Sent and not answered, -1 for none
+    char buf[MAN_MSG_LENGTH * 2];   // Answers read so far
+    int len;
+};
+
+struct man_async {
+    struct man_request *req;        // MAN_ASYNC_MAX slots
+    int free_head;
+    uint32_t generation;            // Makes ids of reused slots differ
+    struct man_async_host *hosts;
+    struct pollfd *fds;
+    int num_hosts;
+    int done_head;                  // Completed and not handed out yet
+    int done_tail;
+    int outstanding;                // Queued or sent
+};
+
+bool man_async_init(struct man_async *m, struct man_port_at_man *hosts);
+void man_async_free(struct man_async *m);
+
+// Queue a command for a host, returns its request id, 0 if there is no such host or no free slot
+uint32_t man_async_submit(struct man_async *m, int host_id, const char *cmd, uint32_t timeout_ms, void *arg);
+
+// Next completed request, waiting up to wait_ms for one; NULL if none completed
+struct man_request *man_async_next(struct man_async *m, int wait_ms);
+
+// Give back the slot of a request man_async_next() returned
+void man_async_release(struct man_async *m, struct man_request *req);
+
+// Requests queued or sent
+int man_async_outstanding(struct man_async *m);
+
+// Host id of a request
+int man_async_host_id(struct man_async *m, struct man_request *req);
+
+#endif //NETWORK_SIMULATOR_02_MAN_ASYNC_H
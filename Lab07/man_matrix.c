@@ -0,0 +1,225 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file man_matrix.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "man_matrix.h"
+#include "net.h"
+
+// Progress of one source host
+struct matrix_source {
+    int run;                        // Run and destination of the next ping to hand to the manager's queue
+    int dst;
+    bool handed_out;                // All of its pings are queued
+    int left;                       // Not completed yet
+};
+
+static float *sample_at(struct ping_matrix *pm, int s, int d, int run) {
+    return &pm->ms[((size_t) s * pm->num_dst + d) * pm->repeat + run];
+}
+
+// Pick sample destinations of source s at random, never the source itself
+static void pick_sample(struct ping_matrix *pm, int s, int sample) {
+    bool *asked = &pm->asked[(size_t) s * pm->num_dst];
+    int candidates = 0;
+    int d, k;
+
+    for (d = 0; d < pm->num_dst; d++) {
+        asked[d] = pm->dst[d] != pm->src[s];
+        if (asked[d]) candidates++;
+    }
+    if (sample <= 0 || sample >= candidates) return;
+    for (k = candidates; k > sample;) {
+        d = rand() % pm->num_dst;
+        if (!asked[d]) continue;
+        asked[d] = false;
+        k--;
+    }
+}
+
+// Move the cursor of source s to its next ping, false once all are handed out
+static bool next_ping(struct ping_matrix *pm, int s, struct matrix_source *src) {
+    const bool *asked = &pm->asked[(size_t) s * pm->num_dst];
+
+    // Every destination once per run, so a slow pair does not come in one block
+    while (src->run < pm->repeat) {
+        for (; src->dst < pm->num_dst; src->dst++) {
+            if (asked[src->dst]) return true;
+        }
+        src->dst = 0;
+        src->run++;
+    }
+    src->handed_out = true;
+    return false;
+}
+
+// The RTT a ping's answer gives, "rtt min/avg/max/stddev a/b/c/d ms", false if it has none
+static bool reply_rtt(const char *reply, double *ms) {
+    const char *rtt = strstr(reply, "rtt min/avg/max/stddev ");
+    double min;
+
+    return rtt != NULL && sscanf(rtt, "rtt min/avg/max/stddev %lf/%lf", &min, ms) == 2;
+}
+
+bool ping_matrix_run(struct ping_matrix *pm, struct man_async *m, struct man_port_at_man *hosts, int repeat,
+                     int sample, ping_matrix_fn each, void *arg) {
+    struct matrix_source sources[MATRIX_MAX_NODES];
+    struct man_port_at_man *p;
+    struct man_request *req;
+    char cmd[MAN_ASYNC_CMD_MAX];
+    int servers[MATRIX_MAX_NODES];
+    int num_servers;
+    int s, d, k, run, left;
+    intptr_t key;
+    double ms;
+    bool ok;
+
+    memset(pm, 0, sizeof(struct ping_matrix));
+    pm->repeat = repeat > 0 ? repeat : 1;
+    for (p = hosts; p != NULL && pm->num_src < MATRIX_MAX_NODES; p = p->next) {
+        pm->src[pm->num_src++] = p->host_id;
+        pm->dst[pm->num_dst++] = p->host_id;
+    }
+    num_servers = net_get_server_ids(servers, MATRIX_MAX_NODES - pm->num_dst);
+    for (k = 0; k < num_servers; k++) pm->dst[pm->num_dst++] = servers[k];
+
+    pm->asked = (bool *) calloc((size_t) pm->num_src * pm->num_dst + 1, sizeof(bool));
+    pm->ms = (float *) malloc(((size_t) pm->num_src * pm->num_dst * pm->repeat + 1) * sizeof(float));
+    if (pm->asked == NULL || pm->ms == NULL) {
+        ping_matrix_free(pm);
+        return false;
+    }
+
+    left = 0;
+    for (s = 0; s < pm->num_src; s++) {
+        pick_sample(pm, s, sample);
+        memset(&sources[s], 0, sizeof(struct matrix_source));
+        for (d = 0; d < pm->num_dst; d++) {
+            for (run = 0; run < pm->repeat; run++) *sample_at(pm, s, d, run) = -1.0f;
+            if (pm->asked[(size_t) s * pm->num_dst + d]) sources[s].left += pm->repeat;
+        }
+        left += sources[s].left;
+    }
+
+    while (left > 0) {
+        // Keep every host's queue full, the table holds only so many requests
+        for (s = 0; s < pm->num_src; s++) {
+            if (sources[s].handed_out) continue;
+            while (next_ping(pm, s, &sources[s])) {
+                d = sources[s].dst;
+                run = sources[s].run;
+                snprintf(cmd, sizeof(cmd), "p %d", pm->dst[d]);
+                key = ((intptr_t) s * pm->num_dst + d) * pm->repeat + run;
+                if (man_async_submit(m, pm->src[s], cmd, MATRIX_TIMEOUT_MS, (void *) (key + 1)) == 0) break;
+                sources[s].dst++;
+            }
+        }
+
+        req = man_async_next(m, 100);
+        if (req == NULL) continue;
+        key = (intptr_t) req->arg - 1;
+        run = (int) (key % pm->repeat);
+        d = (int) (key / pm->repeat % pm->num_dst);
+        s = (int) (key / pm->repeat / pm->num_dst);
+        ok = req->state == MAN_REQ_DONE && strstr(req->reply, "acked") != NULL && reply_rtt(req->reply, &ms);
+        if (!ok) ms = (double) (req->done_us - req->sent_us) / 1000.0;
+        *sample_at(pm, s, d, run) = ok ? (float) ms : -1.0f;
+        if (each != NULL) each(arg, pm->src[s], pm->dst[d], run + 1, ok, ms, req->reply);
+        man_async_release(m, req);
+        sources[s].left--;
+        left--;
+    }
+    return true;
+}
+
+static int compare_float(const void *a, const void *b) {
+    float x = *(const float *) a;
+    float y = *(const float *) b;
+
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Nearest rank percentile of n sorted values
+static float percentile(const float *sorted, int n, int pct) {
+    int rank = (pct * n + 99) / 100;
+
+    if (n == 0) return 0.0f;
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+void ping_matrix_print(struct ping_matrix *pm, FILE *out) {
+    float *vals = (float *) malloc(((size_t) pm->num_dst * pm->repeat + 1) * sizeof(float));
+    float pair[pm->repeat > 0 ? pm->repeat : 1];
+    int s, d, run, n, total, reached, asked;
+    bool any;
+    float v;
+
+    if (vals == NULL) return;
+
+    // Median per pair in ms, x for pairs no ping got through on, . for pairs not asked
+    fprintf(out, "Ping matrix, median ms (x: no answer)\n  from\\to");
+    for (d = 0; d < pm->num_dst; d++) fprintf(out, " %7d", pm->dst[d]);
+    fprintf(out, "\n");
+    for (s = 0; s < pm->num_src; s++) {
+        fprintf(out, "  %7d", pm->src[s]);
+        for (d = 0; d < pm->num_dst; d++) {
+            if (!pm->asked[(size_t) s * pm->num_dst + d]) {
+                fprintf(out, " %7s", pm->dst[d] == pm->src[s] ? "-" : ".");
+                continue;
+            }
+            n = 0;
+            for (run = 0; run < pm->repeat; run++) {
+                v = *sample_at(pm, s, d, run);
+                if (v >= 0.0f) pair[n++] = v;
+            }
+            if (n == 0) {
+                fprintf(out, " %7s", "x");
+                continue;
+            }
+            qsort(pair, n, sizeof(float), compare_float);
+            fprintf(out, " %7.1f", percentile(pair, n, 50));
+        }
+        fprintf(out, "\n");
+    }
+
+    fprintf(out, "\n  source  reached     lost      p50      p90      p99      max\n");
+    for (s = 0; s < pm->num_src; s++) {
+        n = total = reached = asked = 0;
+        for (d = 0; d < pm->num_dst; d++) {
+            if (!pm->asked[(size_t) s * pm->num_dst + d]) continue;
+            asked++;
+            any = false;
+            for (run = 0; run < pm->repeat; run++) {
+                v = *sample_at(pm, s, d, run);
+                total++;
+                if (v < 0.0f) continue;
+                vals[n++] = v;
+                any = true;
+            }
+            if (any) reached++;
+        }
+        qsort(vals, n, sizeof(float), compare_float);
+        fprintf(out, "  %6d  %3d/%-3d  %3d/%-3d  %7.1f  %7.1f  %7.1f  %7.1f\n", pm->src[s], reached, asked,
+                total - n, total, percentile(vals, n, 50), percentile(vals, n, 90), percentile(vals, n, 99),
+                n > 0 ? vals[n - 1] : 0.0f);
+    }
+    free(vals);
+}
+
+void ping_matrix_free(struct ping_matrix *pm) {
+    free(pm->asked);
+    free(pm->ms);
+    pm->asked = NULL;
+    pm->ms = NULL;
+}
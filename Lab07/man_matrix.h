@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file man_matrix.h
+/// @version 1.0
+///
+/// Ping sweep of the whole network. Every host pings every other host
+/// and every server (or a random sample of them), all hosts at once
+/// through man_async.c. The result is a matrix of the median ping time
+/// per pair, with the pairs that never answered marked, and per source
+/// host the share of destinations reached and percentiles of its ping
+/// times. A pair no ping gets through on, when others do, points at a
+/// spanning tree that cut it off.
+///
+/// Times are the RTT the host measured (ping.h), read from its answer.
+/// A ping with no answer gets the manager's time, from sending the
+/// command until it gave up.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_MAN_MATRIX_H
+#define NETWORK_SIMULATOR_02_MAN_MATRIX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "man.h"
+#include "man_async.h"
+
+#define MATRIX_MAX_NODES    128
+#define MATRIX_TIMEOUT_MS   5000    /* Per ping, the host gives up after about a second */
+
+struct ping_matrix {
+    int num_src;
+    int num_dst;
+    int src[MATRIX_MAX_NODES];      // Host ids
+    int dst[MATRIX_MAX_NODES];      // Host and server ids
+    int repeat;                     // Pings per pair
+    bool *asked;                    // [src][dst], false for pairs left out of a sample
+    float *ms;                      // [src][dst][repeat], negative if the ping got no answer
+};
+
+// Called for every ping as it completes
+typedef void (*ping_matrix_fn)(void *arg, int src, int dst, int run, bool ok, double ms, const char *reply);
+
+// Ping repeat times from every host to every node, or to sample of them at random if sample > 0
+bool ping_matrix_run(struct ping_matrix *pm, struct man_async *m, struct man_port_at_man *hosts, int repeat,
+                     int sample, ping_matrix_fn each, void *arg);
+
+// The matrix, then one line of reachability and percentiles per source
+void ping_matrix_print(struct ping_matrix *pm, FILE *out);
+
+void ping_matrix_free(struct ping_matrix *pm);
+
+#endif //NETWORK_SIMULATOR_02_MAN_MATRIX_H
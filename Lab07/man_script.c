@@ -0,0 +1,507 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file man_script.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "main.h"
+#include "man_script.h"
+#include "man_async.h"
+#include "man_matrix.h"
+#include "net.h"
+#include "clock.h"
+#include "metrics.h"
+
+enum script_op {
+    OP_DIR,
+    OP_PING,
+    OP_UPLOAD,
+    OP_DOWNLOAD,
+    OP_REGISTER,
+    OP_LOOKUP,
+    OP_PINGALL,
+    OP_QUERY,
+    OP_TRAFFIC,
+    OP_SLEEP
+};
+
+static const char *op_names[] = {"dir", "ping", "upload", "download", "register", "lookup", "pingall", "query", "traffic",
+                                 "sleep"};
+
+struct script_step {
+    int line;
+    enum script_op op;
+    char command[MAN_MSG_LENGTH + 16];  // As written, without the options
+    char args[MAN_MSG_LENGTH];
+    struct man_port_at_man *hosts[SCRIPT_MAX_HOSTS];
+    int num_hosts;
+    int repeat;
+    int parallel;
+    int sample;                     // Destinations per host of a ping sweep, 0 for all
+    uint32_t timeout_ms;
+};
+
+// Where one host is in a step
+struct script_run {
+    struct man_port_at_man *port;
+    int sent;                       // Runs handed to the manager's queue
+    int runs;                       // Finished
+    bool busy;
+    bool transferring;              // A transfer started, waiting for it to leave the host's state
+    uint64_t start_us;
+    uint32_t poll_ms;               // Last state request of the transfer
+    bool polled;                    // Waiting for the answer to it
+    char file[MAX_NAME_LENGTH];     // Name of the file a transfer shows under
+};
+
+// Totals of a step, for the summary line
+struct script_total {
+    int runs;
+    int failed;
+    double min_ms;
+    double max_ms;
+    double sum_ms;
+};
+
+// Where the rows of a ping sweep go
+struct script_sweep {
+    FILE *out;
+    enum script_format format;
+    bool *first;
+    struct script_step *step;
+    struct script_total *total;
+};
+
+static struct man_port_at_man *find_host(struct man_port_at_man *hosts, int id) {
+    struct man_port_at_man *p;
+
+    for (p = hosts; p != NULL; p = p->next) {
+        if (p->host_id == id) return p;
+    }
+    return NULL;
+}
+
+// Fill step from one line of the script, returns false with a message if it is not a command
+static bool parse_step(struct man_port_at_man *hosts, struct man_port_at_man *nodes, char *text, int line,
+                       struct script_step *step) {
+    struct man_port_at_man *p;
+    char *save, *save2;
+    char *token, *id;
+    int op, n;
+
+    memset(step, 0, sizeof(struct script_step));
+    step->line = line;
+    step->repeat = 1;
+    step->timeout_ms = SCRIPT_TIMEOUT_MS;
+
+    token = strtok_r(text, " \t", &save);
+    for (op = 0; op <= OP_SLEEP && strcmp(token, op_names[op]) != 0; op++);
+    if (op > OP_SLEEP) {
+        fprintf(stderr, "Script line %d: unknown command %s\n", line, token);
+        return false;
+    }
+    step->op = (enum script_op) op;
+
+    n = 0;
+    while ((token = strtok_r(NULL, " \t", &save)) != NULL) {
+        if (strncmp(token, "on=", 3) == 0) {
+            if (strcmp(token + 3, "all") == 0) {
+                for (p = hosts; p != NULL && step->num_hosts < SCRIPT_MAX_HOSTS; p = p->next) {
+                    step->hosts[step->num_hosts++] = p;
+                }
+                continue;
+            }
+            for (id = strtok_r(token + 3, ",", &save2); id != NULL; id = strtok_r(NULL, ",", &save2)) {
+                p = find_host(hosts, atoi(id));
+                if (p == NULL) {
+                    fprintf(stderr, "Script line %d: no host %s\n", line, id);
+                    return false;
+                }
+                if (step->num_hosts < SCRIPT_MAX_HOSTS) step->hosts[step->num_hosts++] = p;
+            }
+        } else if (strncmp(token, "repeat=", 7) == 0) {
+            step->repeat = atoi(token + 7);
+        } else if (strncmp(token, "parallel=", 9) == 0) {
+            step->parallel = atoi(token + 9);
+        } else if (strncmp(token, "sample=", 7) == 0) {
+            step->sample = atoi(token + 7);
+        } else if (strncmp(token, "timeout=", 8) == 0) {
+            step->timeout_ms = (uint32_t) atoi(token + 8);
+        } else {
+            n += snprintf(step->args + n, sizeof(step->args) - n, n > 0 ? " %s" : "%s", token);
+            if (n >= (int) sizeof(step->args)) n = (int) sizeof(step->args) - 1;
+        }
+    }
+    snprintf(step->command, sizeof(step->command), step->args[0] != '\0' ? "%s %s" : "%s", op_names[op], step->args);
+
+    if (step->args[0] == '\0' && step->op != OP_PINGALL) {
+        fprintf(stderr, "Script line %d: %s needs arguments\n", line, op_names[op]);
+        return false;
+    }
+    // A query runs on the switch or server it names
+    if (step->op == OP_QUERY) {
+        p = find_host(nodes, atoi(step->args));
+        if (p == NULL) {
+            fprintf(stderr, "Script line %d: no switch or server %s\n", line, step->args);
+            return false;
+        }
+        step->hosts[0] = p;
+        step->num_hosts = 1;
+    }
+    if (step->num_hosts == 0 && hosts != NULL) step->hosts[step->num_hosts++] = hosts;
+    if (step->repeat < 1) step->repeat = 1;
+    if (step->parallel < 1 || step->parallel > step->num_hosts) step->parallel = step->num_hosts;
+    return true;
+}
+
+// The manager command for a step, and for transfers the file they show under in the host's state
+static int host_command(struct script_step *step, char *msg, int size, char *file) {
+    char name[MAX_NAME_LENGTH];
+    int id = -1;
+
+    switch (step->op) {
+        case OP_DIR:
+            return snprintf(msg, size, "m %s", step->args);
+        case OP_PING:
+            return snprintf(msg, size, "p %s", step->args);
+        case OP_UPLOAD:
+        case OP_DOWNLOAD:
+            // Arguments are "<file> <host id>", as the menu asks for them
+            if (sscanf(step->args, "%99s %d", name, &id) != 2) return 0;
+            snprintf(file, MAX_NAME_LENGTH, "%s", name);
+            return snprintf(msg, size, "%c %d %s", step->op == OP_UPLOAD ? 'u' : 'd', id, name);
+        case OP_REGISTER:
+            return snprintf(msg, size, "r %s", step->args);
+        case OP_LOOKUP:
+            return snprintf(msg, size, "l %s", step->args);
+        case OP_QUERY:
+            // Arguments are "<node id> <query>"
+            if (sscanf(step->args, "%d %99s", &id, name) != 2) return 0;
+            return snprintf(msg, size, "%s", name);
+        case OP_TRAFFIC:
+            return snprintf(msg, size, "g %s", step->args);
+        default:
+            return 0;
+    }
+}
+
+// The answers a host gives for a command that did not work
+static bool reply_ok(const char *reply) {
+    return strstr(reply, "ailed") == NULL && strstr(reply, "time out") == NULL && strstr(reply, "timeout") == NULL
+           && strstr(reply, "Invalid") == NULL && strstr(reply, "Usage") == NULL;
+}
+
+// Steps whose end only shows in the host's state
+static bool step_transfers(struct script_step *step) {
+    return step->op == OP_UPLOAD || step->op == OP_DOWNLOAD;
+}
+
+// True while the host's state shows the transfer of file
+static bool transfer_running(const char *state, enum script_op op, const char *file) {
+    char line[MAX_NAME_LENGTH + 16];
+
+    snprintf(line, sizeof(line), op == OP_UPLOAD ? "Sending %s to host" : "Receiving %s:", file);
+    return strstr(state, line) != NULL;
+}
+
+// The line of the host's state on how the transfer of file ended, into buf; false if there is none
+static bool transfer_result(const char *state, enum script_op op, const char *file, char *buf, int size) {
+    char line[MAX_NAME_LENGTH + 16];
+    const char *c;
+    int n;
+
+    snprintf(line, sizeof(line), op == OP_UPLOAD ? "Sent %s to host" : "Received %s,", file);
+    c = strstr(state, line);
+    if (c == NULL) return false;
+    n = (int) strcspn(c, "\n");
+    snprintf(buf, size, "%.*s", n, c);
+    return true;
+}
+
+// True if the host's state says it gave up on the transfer of file
+static bool transfer_failed(const char *state, enum script_op op, const char *file) {
+    char line[MAX_NAME_LENGTH + 24];
+
+    snprintf(line, sizeof(line), op == OP_UPLOAD ? "Gave up sending %s to host" : "Gave up receiving %s\n", file);
+    return strstr(state, line) != NULL;
+}
+
+static void write_text(FILE *out, enum script_format format, const char *text) {
+    const char *c;
+
+    fputc('"', out);
+    for (c = text; *c != '\0'; c++) {
+        if (*c == '\n') {
+            if (c[1] != '\0') fputs("; ", out);
+        } else if (*c == '"') {
+            fputs(format == SCRIPT_CSV ? "\"\"" : "\\\"", out);
+        } else if (*c == '\\' && format == SCRIPT_JSON) {
+            fputs("\\\\", out);
+        } else if ((unsigned char) *c >= ' ') {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void write_result(FILE *out, enum script_format format, bool *first, int line, const char *command, int host,
+                         int run, const char *status, double ms, const char *reply) {
+    if (format == SCRIPT_CSV) {
+        fprintf(out, "%d,%d,%d,", line, host, run);
+        write_text(out, format, command);
+        fprintf(out, ",%s,%.3f,", status, ms);
+        write_text(out, format, reply);
+        fputc('\n', out);
+    } else {
+        fprintf(out, "%s\n  {\"line\": %d, \"host\": %d, \"run\": %d, \"command\": ", *first ? "" : ",",
+                line, host, run);
+        write_text(out, format, command);
+        fprintf(out, ", \"status\": \"%s\", \"latency_ms\": %.3f, \"reply\": ", status, ms);
+        write_text(out, format, reply);
+        fputc('}', out);
+    }
+    *first = false;
+    fflush(out);
+}
+
+static void add_total(struct script_total *total, const char *status, double ms) {
+    total->runs++;
+    if (strcmp(status, "ok") != 0) total->failed++;
+    if (total->runs == 1 || ms < total->min_ms) total->min_ms = ms;
+    if (ms > total->max_ms) total->max_ms = ms;
+    total->sum_ms += ms;
+}
+
+// Queue what a host has left to send: every repeat at once, or the next transfer once the last is done
+static void submit_runs(struct man_async *m, struct script_step *step, struct script_run *r) {
+    char msg[MAN_ASYNC_CMD_MAX];
+    int n;
+
+    while (r->sent < step->repeat && !(step_transfers(step) && r->sent > r->runs)) {
+        n = host_command(step, msg, sizeof(msg), r->file);
+        if (n <= 0 || n >= (int) sizeof(msg)) {
+            fprintf(stderr, "Script line %d: cannot run %s\n", step->line, step->command);
+            r->sent = r->runs = step->repeat;
+            return;
+        }
+        if (man_async_submit(m, r->port->host_id, msg, step->timeout_ms, r) == 0) return;   // Table full for now
+        r->sent++;
+    }
+}
+
+// Run one step on each of its hosts, parallel of them at a time
+static void run_step(struct man_async *m, struct script_step *step, FILE *out, enum script_format format,
+                     bool *first, struct script_total *total) {
+    struct script_run runs[SCRIPT_MAX_HOSTS];
+    struct script_run *r;
+    struct man_request *req;
+    char result[MAN_MSG_LENGTH];
+    const char *status;
+    uint32_t now;
+    double ms;
+    int active = 0;
+    int left = step->num_hosts;
+    int next = 0;                   // Next host to start
+    int k;
+
+    memset(runs, 0, sizeof(runs));
+    for (k = 0; k < step->num_hosts; k++) runs[k].port = step->hosts[k];
+
+    while (left > 0) {
+        // Start hosts up to the parallel limit, then keep each busy until it has done every repeat
+        while (active < step->parallel && next < step->num_hosts) {
+            runs[next++].busy = true;
+            active++;
+        }
+        for (k = 0; k < next; k++) {
+            if (runs[k].busy) submit_runs(m, step, &runs[k]);
+        }
+
+        req = man_async_next(m, SCRIPT_POLL_MS / 5);
+        now = clock_ms();
+        if (req != NULL) {
+            r = (struct script_run *) req->arg;
+            status = NULL;
+            if (!step_transfers(step)) {
+                ms = (double) (req->done_us - req->sent_us) / 1000.0;
+                status = req->state == MAN_REQ_TIMEOUT ? "timeout" : reply_ok(req->reply) ? "ok" : "fail";
+            } else if (!r->transferring) {
+                // The host started it, or could not
+                ms = (double) (req->done_us - req->sent_us) / 1000.0;
+                if (req->state == MAN_REQ_TIMEOUT || !reply_ok(req->reply)) {
+                    status = req->state == MAN_REQ_TIMEOUT ? "timeout" : "fail";
+                } else {
+                    r->transferring = true;
+                    r->start_us = req->sent_us;
+                    r->poll_ms = now;
+                    r->polled = false;
+                }
+            } else {
+                r->polled = false;
+                ms = (double) (req->done_us - r->start_us) / 1000.0;
+                if (req->state == MAN_REQ_TIMEOUT) {
+                    status = "timeout";
+                } else if (transfer_failed(req->reply, step->op, r->file)) {
+                    snprintf(req->reply, sizeof(req->reply), "%s failed", r->file);
+                    status = "fail";
+                } else if (!transfer_running(req->reply, step->op, r->file)) {
+                    if (!transfer_result(req->reply, step->op, r->file, result, sizeof(result))) {
+                        snprintf(result, sizeof(result), "%s done", r->file);
+                    }
+                    snprintf(req->reply, sizeof(req->reply), "%s", result);
+                    status = "ok";
+                } else if (ms > step->timeout_ms) {
+                    snprintf(req->reply, sizeof(req->reply), "%s still running", r->file);
+                    status = "timeout";
+                }
+            }
+
+            if (status != NULL) {
+                write_result(out, format, first, step->line, step->command, r->port->host_id, r->runs + 1, status, ms, req->reply);
+                add_total(total, status, ms);
+                r->transferring = false;
+                if (++r->runs == step->repeat) {
+                    r->busy = false;
+                    active--;
+                    left--;
+                }
+            }
+            man_async_release(m, req);
+        }
+
+        // A transfer is done once it is gone from the host's state, and failed if the host gave up on it
+        for (k = 0; k < next; k++) {
+            r = &runs[k];
+            if (!r->transferring || r->polled || now - r->poll_ms < SCRIPT_POLL_MS) continue;
+            if (man_async_submit(m, r->port->host_id, "s", step->timeout_ms, r) == 0) continue;
+            r->poll_ms = now;
+            r->polled = true;
+        }
+    }
+}
+
+// One row per ping of a sweep, under the ping it was
+static void sweep_result(void *arg, int src, int dst, int run, bool ok, double ms, const char *reply) {
+    struct script_sweep *sweep = (struct script_sweep *) arg;
+    char command[MAN_ASYNC_CMD_MAX];
+    const char *status = ok ? "ok" : reply[0] == '\0' ? "timeout" : "fail";
+
+    snprintf(command, sizeof(command), "ping %d", dst);
+    write_result(sweep->out, sweep->format, sweep->first, sweep->step->line, command, src, run, status, ms, reply);
+    add_total(sweep->total, status, ms);
+}
+
+// Ping sweep from every host, rows as it goes and the matrix on stderr at the end
+static void run_sweep(struct man_async *m, struct man_port_at_man *hosts, struct script_step *step, FILE *out,
+                      enum script_format format, bool *first, struct script_total *total) {
+    struct script_sweep sweep = {out, format, first, step, total};
+    struct ping_matrix pm;
+
+    if (!ping_matrix_run(&pm, m, hosts, step->repeat, step->sample, sweep_result, &sweep)) {
+        fprintf(stderr, "Script line %d: out of memory\n", step->line);
+        return;
+    }
+    ping_matrix_print(&pm, stderr);
+    ping_matrix_free(&pm);
+}
+
+// Load offered by the generators of all hosts, and delivered, from their metrics
+static void print_traffic(void) {
+    struct metrics_node *node;
+    uint64_t offered = 0, offered_bytes = 0;
+    uint64_t delivered = 0, delivered_bytes = 0;
+    int id;
+
+    for (id = 0; id < METRICS_MAX_NODES; id++) {
+        node = metrics_node(id);
+        if (node == NULL) continue;
+        offered += atomic_load_explicit(&node->traffic_offered_packets, memory_order_relaxed);
+        offered_bytes += atomic_load_explicit(&node->traffic_offered_bytes, memory_order_relaxed);
+        delivered += atomic_load_explicit(&node->traffic_delivered_packets, memory_order_relaxed);
+        delivered_bytes += atomic_load_explicit(&node->traffic_delivered_bytes, memory_order_relaxed);
+    }
+    fprintf(stderr, "Traffic: offered %llu packets, %llu bytes; delivered %llu packets, %llu bytes (%.1f%%)\n",
+            (unsigned long long) offered, (unsigned long long) offered_bytes, (unsigned long long) delivered,
+            (unsigned long long) delivered_bytes, offered > 0 ? 100.0 * (double) delivered / (double) offered : 0.0);
+}
+
+int man_script_run(struct man_port_at_man *hosts, const char *path, FILE *out, enum script_format format) {
+    struct script_step step;
+    struct script_total total;
+    char text[MAN_MSG_LENGTH];
+    char *c;
+    struct man_async m;
+    struct man_async m_nodes;       // Switches and servers, for queries
+    bool first = true;
+    bool ok;
+    int failed = 0;
+    int line = 0;
+    FILE *fp;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open script %s\n", path);
+        return -1;
+    }
+    ok = man_async_init(&m, hosts);
+    ok = man_async_init(&m_nodes, net_get_man_ports_at_man_nodes()) && ok;
+    if (!ok) {
+        fprintf(stderr, "Cannot run script %s: out of memory\n", path);
+        man_async_free(&m);
+        man_async_free(&m_nodes);
+        fclose(fp);
+        return -1;
+    }
+    if (format == SCRIPT_CSV) {
+        fprintf(out, "line,host,run,command,status,latency_ms,reply\n");
+    } else {
+        fprintf(out, "[");
+    }
+
+    while (fgets(text, sizeof(text), fp) != NULL) {
+        line++;
+        if ((c = strchr(text, '#')) != NULL) *c = '\0';
+        text[strcspn(text, "\r\n")] = '\0';
+        if (strspn(text, " \t") == strlen(text)) continue;
+        if (!parse_step(hosts, net_get_man_ports_at_man_nodes(), text, line, &step)) {
+            failed++;
+            continue;
+        }
+        if (step.op == OP_SLEEP) {
+            usleep((useconds_t) atoi(step.args) * 1000);
+            continue;
+        }
+
+        memset(&total, 0, sizeof(total));
+        if (step.op == OP_PINGALL) {
+            run_sweep(&m, hosts, &step, out, format, &first, &total);
+        } else if (step.op == OP_QUERY) {
+            run_step(&m_nodes, &step, out, format, &first, &total);
+        } else {
+            run_step(&m, &step, out, format, &first, &total);
+        }
+        failed += total.failed;
+        fprintf(stderr, "Line %d, %s: %d runs, %d failed, latency min %.3f avg %.3f max %.3f ms\n", line,
+                step.command, total.runs, total.failed, total.min_ms,
+                total.runs > 0 ? total.sum_ms / total.runs : 0.0, total.max_ms);
+        if (step.op == OP_TRAFFIC && strcmp(step.args, "stop") == 0) print_traffic();
+    }
+    if (format == SCRIPT_JSON) fprintf(out, "\n]\n");
+    fflush(out);
+    fclose(fp);
+    man_async_free(&m);
+    man_async_free(&m_nodes);
+    return failed;
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file man_script.h
+/// @version 1.0
+///
+/// Runs the manager from a command file instead of the menu, for load runs
+/// that can be repeated. One command per line, '#' starts a comment:
+///
+///     dir d0 on=0
+///     ping 100 on=0,1 repeat=20
+///     ping 1 count=100 interval=20 on=0
+///     upload text.txt 100 on=0
+///     download text.txt 100 on=1 timeout=60000
+///     register a.dc,b.dc on=0
+///     lookup a.dc on=all repeat=10 parallel=2
+///     pingall repeat=3 sample=4
+///     query 2 t repeat=5
+///     traffic poisson rate=50 dst=all on=all
+///     traffic stop on=all
+///     sleep 500
+///
+/// Options: on= the host ids to run it on (all for every host, the first
+/// host if not given), repeat= runs per host, parallel= hosts running it
+/// at once (all of them if not given), timeout= in ms. pingall pings
+/// from every host to every other node, or to sample= of them, and
+/// prints the matrix of man_matrix.h on stderr. A ping takes the options
+/// of ping.h and answers with its RTT summary. query asks a switch or
+/// server one of the questions of the menu's (n) command. traffic starts
+/// or stops the generator of traffic.h; after a stop the load offered and
+/// delivered across all hosts goes to stderr. Commands go out
+/// through man_async.c: the repeats of a host are queued all at once and
+/// run one after another, as a host takes one manager command at a time.
+///
+/// Every run is timed from sending the command to the host's answer; a
+/// transfer is timed until it no longer shows in the host's state, and
+/// answers with the line of that state on how it ended (for a download,
+/// the time the receiving host measured). One
+/// row per run goes out as CSV or JSON.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_MAN_SCRIPT_H
+#define NETWORK_SIMULATOR_02_MAN_SCRIPT_H
+
+#include <stdio.h>
+
+#include "man.h"
+
+#define SCRIPT_MAX_HOSTS    128
+#define SCRIPT_TIMEOUT_MS   30000   /* Default time a run may take */
+#define SCRIPT_POLL_MS      50      /* How often a host running a transfer is asked for its state */
+
+enum script_format {
+    SCRIPT_CSV,
+    SCRIPT_JSON
+};
+
+// Run the commands in the file at path, returns the number of runs that failed, -1 if it cannot be read
+int man_script_run(struct man_port_at_man *hosts, const char *path, FILE *out, enum script_format format);
+
+#endif //NETWORK_SIMULATOR_02_MAN_SCRIPT_H
@@ -0,0 +1,292 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file metrics.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "metrics.h"
+
+struct metrics_segment {
+    struct metrics_node node[METRICS_MAX_NODES];
+    struct metrics_port port[METRICS_MAX_PORTS];
+    int num_ports;                  // Only changed before the nodes are forked
+};
+
+#define EXPORT_TARGET_MAX   256
+
+struct metrics_export {
+    char target[EXPORT_TARGET_MAX];
+    uint32_t interval_ms;
+    int listen_fd;                  // -1 when writing a file
+};
+
+static struct metrics_segment *g_metrics = NULL;
+static struct metrics_node *g_self = NULL;
+static struct metrics_node g_nowhere;   // Counts of a process with no segment or no slot
+
+bool metrics_init(void) {
+    void *p;
+
+    if (g_metrics != NULL) return true;
+    p = mmap(NULL, sizeof(struct metrics_segment), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "metrics: cannot map the segment, nothing will be counted\n");
+        return false;
+    }
+    g_metrics = (struct metrics_segment *) p;   // Zero filled
+    return true;
+}
+
+void metrics_add_node(int id, enum NetNodeType type) {
+    if (g_metrics == NULL || id < 0 || id >= METRICS_MAX_NODES) return;
+    g_metrics->node[id].used = true;
+    g_metrics->node[id].type = type;
+}
+
+struct metrics_port *metrics_add_port(int node_id) {
+    struct metrics_port *port;
+
+    if (g_metrics == NULL || node_id < 0 || node_id >= METRICS_MAX_NODES) return NULL;
+    if (g_metrics->num_ports == METRICS_MAX_PORTS) return NULL;
+    port = &g_metrics->port[g_metrics->num_ports++];
+    port->node_id = node_id;
+    port->index = g_metrics->node[node_id].num_ports++;
+    return port;
+}
+
+void metrics_set_self(int id) {
+    g_self = g_metrics != NULL && id >= 0 && id < METRICS_MAX_NODES ? &g_metrics->node[id] : NULL;
+}
+
+struct metrics_node *metrics_node(int id) {
+    if (g_metrics == NULL || id < 0 || id >= METRICS_MAX_NODES || !g_metrics->node[id].used) return NULL;
+    return &g_metrics->node[id];
+}
+
+struct metrics_node *metrics_self(void) {
+    return g_self != NULL ? g_self : &g_nowhere;
+}
+
+void metrics_observe(struct metrics_hist *hist, uint64_t value) {
+    int i = value == 0 ? 0 : 64 - __builtin_clzll(value);   // Smallest i with value < 2^i
+
+    if (i > METRICS_BUCKETS) i = METRICS_BUCKETS;
+    metrics_add(&hist->bucket[i], 1);
+    metrics_add(&hist->sum, value);
+}
+
+static uint64_t get(atomic_uint_fast64_t *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static const char *type_name(enum NetNodeType type) {
+    return type == HOST ? "host" : type == SWITCH ? "switch" : "server";
+}
+
+static void write_header(FILE *out, const char *name, const char *type, const char *help) {
+    fprintf(out, "# HELP netsim_%s %s\n# TYPE netsim_%s %s\n", name, help, name, type);
+}
+
+// One sample of a counter of every node
+static void write_nodes(FILE *out, const char *name, const char *type, const char *help, size_t offset) {
+    struct metrics_node *node;
+    int id;
+
+    write_header(out, name, type, help);
+    for (id = 0; id < METRICS_MAX_NODES; id++) {
+        node = &g_metrics->node[id];
+        if (!node->used) continue;
+        fprintf(out, "netsim_%s{node=\"%d\",type=\"%s\"} %llu\n", name, id, type_name(node->type),
+                (unsigned long long) get((atomic_uint_fast64_t *) ((char *) node + offset)));
+    }
+}
+
+// One sample of a counter of every port
+static void write_ports(FILE *out, const char *name, const char *help, size_t offset) {
+    struct metrics_port *port;
+    int k;
+
+    write_header(out, name, "counter", help);
+    for (k = 0; k < g_metrics->num_ports; k++) {
+        port = &g_metrics->port[k];
+        fprintf(out, "netsim_%s{node=\"%d\",type=\"%s\",port=\"%d\"} %llu\n", name, port->node_id,
+                type_name(g_metrics->node[port->node_id].type), port->index,
+                (unsigned long long) get((atomic_uint_fast64_t *) ((char *) port + offset)));
+    }
+}
+
+uint64_t metrics_quantile(struct metrics_hist *hist, double q) {
+    uint64_t total = 0, count = 0;
+    int i;
+
+    for (i = 0; i <= METRICS_BUCKETS; i++) total += get(&hist->bucket[i]);
+    if (total == 0) return 0;
+    for (i = 0; i < METRICS_BUCKETS; i++) {
+        count += get(&hist->bucket[i]);
+        if ((double) count >= q * (double) total) return 1ull << i;
+    }
+    return UINT64_MAX;
+}
+
+// A histogram of every node, in seconds
+static void write_hist(FILE *out, const char *name, const char *help, size_t offset) {
+    struct metrics_node *node;
+    struct metrics_hist *hist;
+    uint64_t count;
+    int id, i;
+
+    write_header(out, name, "histogram", help);
+    for (id = 0; id < METRICS_MAX_NODES; id++) {
+        node = &g_metrics->node[id];
+        if (!node->used) continue;
+        hist = (struct metrics_hist *) ((char *) node + offset);
+        count = 0;
+        for (i = 0; i < METRICS_BUCKETS; i++) {
+            count += get(&hist->bucket[i]);
+            fprintf(out, "netsim_%s_bucket{node=\"%d\",type=\"%s\",le=\"%g\"} %llu\n", name, id,
+                    type_name(node->type), (double) (1ull << i) / 1e6, (unsigned long long) count);
+        }
+        count += get(&hist->bucket[METRICS_BUCKETS]);
+        fprintf(out, "netsim_%s_bucket{node=\"%d\",type=\"%s\",le=\"+Inf\"} %llu\n", name, id,
+                type_name(node->type), (unsigned long long) count);
+        fprintf(out, "netsim_%s_sum{node=\"%d\",type=\"%s\"} %g\n", name, id, type_name(node->type),
+                (double) get(&hist->sum) / 1e6);
+        fprintf(out, "netsim_%s_count{node=\"%d\",type=\"%s\"} %llu\n", name, id, type_name(node->type),
+                (unsigned long long) count);
+    }
+}
+
+void metrics_write(FILE *out) {
+    if (g_metrics == NULL) return;
+    write_ports(out, "rx_packets_total", "Packets received on a port.", offsetof(struct metrics_port, rx_packets));
+    write_ports(out, "rx_bytes_total", "Bytes received on a port.", offsetof(struct metrics_port, rx_bytes));
+    write_ports(out, "tx_packets_total", "Packets sent on a port.", offsetof(struct metrics_port, tx_packets));
+    write_ports(out, "tx_bytes_total", "Bytes sent on a port.", offsetof(struct metrics_port, tx_bytes));
+    write_nodes(out, "drops_total", "counter", "Packets dropped with the queue full.",
+                offsetof(struct metrics_node, drops));
+    write_nodes(out, "queue_depth", "gauge", "Jobs in a node's queue.", offsetof(struct metrics_node, queue_depth));
+    write_hist(out, "job_wait_seconds", "Time jobs waited in a node's queue.",
+               offsetof(struct metrics_node, job_wait_us));
+    write_hist(out, "hop_queue_seconds", "Time traced packets waited in a node's queue.",
+               offsetof(struct metrics_node, hop_queue_us));
+    write_hist(out, "hop_forward_seconds", "Time from dequeue to send of traced packets.",
+               offsetof(struct metrics_node, hop_forward_us));
+    write_hist(out, "ping_rtt_seconds", "Round trip time of a host's pings.",
+               offsetof(struct metrics_node, ping_rtt_us));
+    write_nodes(out, "dns_hits_total", "counter", "Names found, in a host's cache or a server's table.",
+                offsetof(struct metrics_node, dns_hits));
+    write_nodes(out, "dns_misses_total", "counter", "Names not in a host's cache or a server's table.",
+                offsetof(struct metrics_node, dns_misses));
+    write_nodes(out, "goodput_bytes_total", "counter", "File bytes received and written.",
+                offsetof(struct metrics_node, goodput_bytes));
+    write_nodes(out, "traffic_offered_packets_total", "counter", "Packets the traffic generator sent.",
+                offsetof(struct metrics_node, traffic_offered_packets));
+    write_nodes(out, "traffic_offered_bytes_total", "counter", "Bytes the traffic generator sent.",
+                offsetof(struct metrics_node, traffic_offered_bytes));
+    write_nodes(out, "traffic_delivered_packets_total", "counter", "Generated packets received.",
+                offsetof(struct metrics_node, traffic_delivered_packets));
+    write_nodes(out, "traffic_delivered_bytes_total", "counter", "Generated bytes received.",
+                offsetof(struct metrics_node, traffic_delivered_bytes));
+}
+
+// Write the whole file under another name and rename it over the last one
+static void export_file(const char *path) {
+    char tmp[EXPORT_TARGET_MAX + 8];
+    FILE *out;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    out = fopen(tmp, "w");
+    if (out == NULL) return;
+    metrics_write(out);
+    if (fclose(out) == 0) rename(tmp, path);
+}
+
+// Answer one connection with the counters as they are now
+static void export_socket(int listen_fd) {
+    char *text = NULL;
+    size_t len = 0;
+    size_t done = 0;
+    ssize_t n;
+    FILE *out;
+    int fd;
+
+    fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) return;
+    out = open_memstream(&text, &len);
+    if (out != NULL) {
+        metrics_write(out);
+        fclose(out);
+        while (done < len && (n = write(fd, text + done, len - done)) > 0) done += (size_t) n;
+        free(text);
+    }
+    close(fd);
+}
+
+static void *export_main(void *arg) {
+    struct metrics_export *ex = (struct metrics_export *) arg;
+    struct pollfd pfd;
+
+    while (true) {
+        if (ex->listen_fd < 0) {
+            export_file(ex->target);
+            usleep(ex->interval_ms * 1000);
+            continue;
+        }
+        pfd.fd = ex->listen_fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, -1) > 0) export_socket(ex->listen_fd);
+    }
+    return NULL;
+}
+
+bool metrics_export_start(const char *target, uint32_t interval_ms) {
+    struct metrics_export *ex;
+    struct sockaddr_un addr;
+    pthread_t thread;
+
+    if (g_metrics == NULL) return false;
+    ex = (struct metrics_export *) calloc(1, sizeof(struct metrics_export));
+    if (ex == NULL) return false;
+    snprintf(ex->target, sizeof(ex->target), "%s", target);
+    ex->interval_ms = interval_ms > 0 ? interval_ms : METRICS_INTERVAL_MS;
+    ex->listen_fd = -1;
+
+    if (strncmp(target, "unix:", 5) == 0) {
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", target + 5);
+        unlink(addr.sun_path);
+        ex->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (ex->listen_fd < 0 || bind(ex->listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0
+            || listen(ex->listen_fd, 4) < 0) {
+            fprintf(stderr, "metrics: cannot listen on %s\n", target + 5);
+            if (ex->listen_fd >= 0) close(ex->listen_fd);
+            free(ex);
+            return false;
+        }
+    }
+
+    if (pthread_create(&thread, NULL, export_main, ex) != 0) {
+        if (ex->listen_fd >= 0) close(ex->listen_fd);
+        free(ex);
+        return false;
+    }
+    pthread_detach(thread);
+    return true;
+}
@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file metrics.h
+/// @version 1.0
+///
+/// Counters of every node in one shared memory segment, mapped before the
+/// nodes are forked so every process sees the same one. Each counter has
+/// a single writer, the node it belongs to, which adds to it with a
+/// relaxed atomic; the manager reads them while the nodes run, without a
+/// lock on either side.
+///
+/// Per port: packets and bytes received and sent, counted in packet.c.
+/// Per node: packets dropped, the depth of its job queue, how long jobs
+/// waited in it (a histogram of power of two buckets in microseconds),
+/// DNS hits and misses (the cache of a host, the name table of a server)
+/// and file bytes received in order, for goodput; load the traffic
+/// generator offered and had delivered (traffic.h), the RTTs of a host's
+/// pings (ping.h). With tracing on, also how long packets waited in the
+/// queue and took to be sent on (trace.h).
+///
+/// The manager writes them out in the Prometheus text format: to a file
+/// every interval, replaced whole so a reader never sees half of one, or
+/// on each connection to a unix socket ("unix:<path>").
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_METRICS_H
+#define NETWORK_SIMULATOR_02_METRICS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "main.h"
+
+#define METRICS_MAX_NODES   128     /* Node ids are signed chars */
+#define METRICS_MAX_PORTS   512
+#define METRICS_BUCKETS     25      /* Up to 2^24 us, about 17 s, then +Inf */
+#define METRICS_INTERVAL_MS 1000    /* Default time between writes of the export file */
+
+struct metrics_hist {
+    atomic_uint_fast64_t bucket[METRICS_BUCKETS + 1];   // bucket[i] counts values below 2^i, the last the rest
+    atomic_uint_fast64_t sum;
+};
+
+struct metrics_port {
+    int node_id;
+    int index;                      // Of the port at its node
+    atomic_uint_fast64_t rx_packets;
+    atomic_uint_fast64_t rx_bytes;
+    atomic_uint_fast64_t tx_packets;
+    atomic_uint_fast64_t tx_bytes;
+};
+
+struct metrics_node {
+    bool used;
+    enum NetNodeType type;
+    int num_ports;
+    atomic_uint_fast64_t drops;
+    atomic_uint_fast64_t queue_depth;   // Gauge
+    atomic_uint_fast64_t dns_hits;
+    atomic_uint_fast64_t dns_misses;
+    atomic_uint_fast64_t goodput_bytes;
+    atomic_uint_fast64_t traffic_offered_packets;   // Sent by the traffic generator
+    atomic_uint_fast64_t traffic_offered_bytes;
+    atomic_uint_fast64_t traffic_delivered_packets; // Generated by any host, received here
+    atomic_uint_fast64_t traffic_delivered_bytes;
+    struct metrics_hist job_wait_us;
+    struct metrics_hist hop_queue_us;   // Of traced packets, arrival to dequeue
+    struct metrics_hist hop_forward_us; // Of traced packets, dequeue to send
+    struct metrics_hist ping_rtt_us;    // Of the pings a host sent (ping.h)
+};
+
+// Map the segment, before the nodes are forked; returns false if it cannot be
+bool metrics_init(void);
+
+// Slots for a node and for each of its ports, set up with the network; a port gets NULL if there are too many
+void metrics_add_node(int id, enum NetNodeType type);
+struct metrics_port *metrics_add_port(int node_id);
+
+// The process is node id from now on
+void metrics_set_self(int id);
+
+// Counters of this process's node, never NULL: without a segment they go nowhere
+struct metrics_node *metrics_self(void);
+
+static inline void metrics_add(atomic_uint_fast64_t *counter, uint64_t n) {
+    atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+static inline void metrics_set(atomic_uint_fast64_t *gauge, uint64_t value) {
+    atomic_store_explicit(gauge, value, memory_order_relaxed);
+}
+
+void metrics_observe(struct metrics_hist *hist, uint64_t value);
+
+// Upper bound of the bucket holding quantile q of a histogram, 0 if it is empty and UINT64_MAX past the last
+uint64_t metrics_quantile(struct metrics_hist *hist, double q);
+
+// Counters of node id, NULL if there is no such node
+struct metrics_node *metrics_node(int id);
+
+// Every counter in the Prometheus text format
+void metrics_write(FILE *out);
+
+// Start a thread of the manager writing to target every interval_ms; returns false if it cannot
+bool metrics_export_start(const char *target, uint32_t interval_ms);
+
+#endif //NETWORK_SIMULATOR_02_METRICS_H
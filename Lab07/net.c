@@ -27,6 +27,7 @@
 #include "host.h"
 #include "net.h"
 #include "packet.h"
+#include "metrics.h"
 
 
 #define MAX_FILE_NAME 100
@@ -75,6 +76,7 @@ static int g_net_link_num;
 static struct net_port *g_port_list = NULL;
 
 static struct man_port_at_man *g_man_man_port_list = NULL;
+static struct man_port_at_man *g_man_node_port_list = NULL;   /* Switches and servers */
 static struct man_port_at_host *g_man_host_port_list = NULL;
 
 /* 
@@ -82,7 +84,7 @@ static struct man_port_at_host *g_man_host_port_list = NULL;
  * for nodes and links.  The results are accessible through
  * the private global variables
  */
-int load_net_data_file();
+int load_net_data_file(const char *config);
 
 /*
  * Creates a data structure for the nodes
@@ -101,7 +103,7 @@ void create_port_list();
  * ports at the manager side is p_m.  The list of ports
  * at the host side is p_h.
  */
-void create_man_ports(struct man_port_at_man **p_m, struct man_port_at_host **p_h);
+void create_man_ports(struct man_port_at_man **p_m, struct man_port_at_man **p_n, struct man_port_at_host **p_h);
 
 void net_close_man_ports_at_hosts();
 
@@ -157,12 +159,28 @@ struct net_node *net_get_node_list() {
     return g_node_list;
 }
 
+/* Fill ids with the ids of the DNS servers, return how many there are */
+int net_get_server_ids(int *ids, int max) {
+    struct net_node *node;
+    int n = 0;
+
+    for (node = g_node_list; node != NULL && n < max; node = node->next) {
+        if (node->type == SERVER) ids[n++] = node->id;
+    }
+    return n;
+}
+
 /* Return linked list of ports used by the manager to connect to hosts */
 struct man_port_at_man *net_get_man_ports_at_man_list() {
     return (g_man_man_port_list);
 }
 
-/* Return the port used by host to link with other nodes */
+/* Return linked list of ports used by the manager to query switches and servers */
+struct man_port_at_man *net_get_man_ports_at_man_nodes() {
+    return (g_man_node_port_list);
+}
+
+/* Return the port used by a node to link with the manager */
 struct man_port_at_host *net_get_host_port(int host_id) {
     struct man_port_at_host *p;
 
@@ -225,6 +243,11 @@ void net_close_man_ports_at_man() {
         close(p_m->recv_fd);
         p_m = p_m->next;
     }
+
+    for (p_m = g_man_node_port_list; p_m != NULL; p_m = p_m->next) {
+        close(p_m->send_fd);
+        close(p_m->recv_fd);
+    }
 }
 
 /* Free all manager ports */
@@ -239,17 +262,30 @@ void net_free_man_ports_at_man() {
         p_m = p_m->next;
         free(t_m);
     }
+
+    p_m = g_man_node_port_list;
+
+    while (p_m != NULL) {
+        t_m = p_m;
+        p_m = p_m->next;
+        free(t_m);
+    }
 }
 
 
 /* Initialize network ports and links */
-int net_init() {
+int net_init(const char *config) {
     if (g_initialized) { /* Check if the network is already initialized */
         printf("Network already loaded\n");
         return (0);
-    } else if (load_net_data_file() == 0) { /* Load network configuration file */
+    } else if (load_net_data_file(config) == 0) { /* Load network configuration file */
         return (0);
     }
+/*
+ * Map the counters every node keeps, so the children share them
+ */
+    metrics_init();
+
 /* 
  * Create a linked list of node information at g_node_list 
  */
@@ -262,23 +298,25 @@ int net_init() {
     create_port_list();
 
 /* 
- * Create pipes to connect the manager to hosts
- * and store the ports at the host at g_man_host_port_list
+ * Create pipes to connect the manager to every node
+ * and store the ports at the nodes at g_man_host_port_list
  * as a linked list
  * and store the ports at the manager at g_man_man_port_list
- * as a linked list
+ * for hosts and g_man_node_port_list for switches and servers
+ * as linked lists
  */
-    create_man_ports(&g_man_man_port_list, &g_man_host_port_list);
+    create_man_ports(&g_man_man_port_list, &g_man_node_port_list, &g_man_host_port_list);
 }
 
 /*
- *  Create pipes to connect the manager to host nodes.
- *  (Note that the manager is not connected to switch nodes.)
- *  p_man is a linked list of ports at the manager.
- *  p_host is a linked list of ports at the hosts.
+ *  Create pipes to connect the manager to every node.
+ *  p_man is a linked list of ports at the manager to hosts,
+ *  p_node the ports at the manager to switches and servers.
+ *  p_host is a linked list of ports at the nodes.
  *  Note that the pipes are nonblocking.
  */
-void create_man_ports(struct man_port_at_man **p_man, struct man_port_at_host **p_host) {
+void create_man_ports(struct man_port_at_man **p_man, struct man_port_at_man **p_node,
+                      struct man_port_at_host **p_host) {
     struct net_node *p;
     int fd0[2];
     int fd1[2];
@@ -288,33 +326,37 @@ void create_man_ports(struct man_port_at_man **p_man, struct man_port_at_host **
 
 
     for (p = g_node_list; p != NULL; p = p->next) {
+        p_m = (struct man_port_at_man *) malloc(sizeof(struct man_port_at_man));
+        p_m->host_id = p->id;
+
+        p_h = (struct man_port_at_host *) malloc(sizeof(struct man_port_at_host));
+        p_h->host_id = p->id;
+
+        pipe(fd0); /* Create a pipe */
+        /* Make the pipe nonblocking at both ends */
+        fcntl(fd0[PIPE_WRITE], F_SETFL, fcntl(fd0[PIPE_WRITE], F_GETFL) | O_NONBLOCK);
+        fcntl(fd0[PIPE_READ], F_SETFL, fcntl(fd0[PIPE_READ], F_GETFL) | O_NONBLOCK);
+        p_m->send_fd = fd0[PIPE_WRITE];
+        p_h->recv_fd = fd0[PIPE_READ];
+
+        pipe(fd1); /* Create a pipe */
+        /* Make the pipe nonblocking at both ends */
+        fcntl(fd1[PIPE_WRITE], F_SETFL, fcntl(fd1[PIPE_WRITE], F_GETFL) | O_NONBLOCK);
+        fcntl(fd1[PIPE_READ], F_SETFL, fcntl(fd1[PIPE_READ], F_GETFL) | O_NONBLOCK);
+        p_h->send_fd = fd1[PIPE_WRITE];
+        p_m->recv_fd = fd1[PIPE_READ];
+
+        /* The menu and scripts run commands on hosts, the others are only queried */
         if (p->type == HOST) {
-            p_m = (struct man_port_at_man *) malloc(sizeof(struct man_port_at_man));
-            p_m->host_id = p->id;
-
-            p_h = (struct man_port_at_host *) malloc(sizeof(struct man_port_at_host));
-            p_h->host_id = p->id;
-
-            pipe(fd0); /* Create a pipe */
-            /* Make the pipe nonblocking at both ends */
-            fcntl(fd0[PIPE_WRITE], F_SETFL, fcntl(fd0[PIPE_WRITE], F_GETFL) | O_NONBLOCK);
-            fcntl(fd0[PIPE_READ], F_SETFL, fcntl(fd0[PIPE_READ], F_GETFL) | O_NONBLOCK);
-            p_m->send_fd = fd0[PIPE_WRITE];
-            p_h->recv_fd = fd0[PIPE_READ];
-
-            pipe(fd1); /* Create a pipe */
-            /* Make the pipe nonblocking at both ends */
-            fcntl(fd1[PIPE_WRITE], F_SETFL, fcntl(fd1[PIPE_WRITE], F_GETFL) | O_NONBLOCK);
-            fcntl(fd1[PIPE_READ], F_SETFL, fcntl(fd1[PIPE_READ], F_GETFL) | O_NONBLOCK);
-            p_h->send_fd = fd1[PIPE_WRITE];
-            p_m->recv_fd = fd1[PIPE_READ];
-
             p_m->next = *p_man;
             *p_man = p_m;
-
-            p_h->next = *p_host;
-            *p_host = p_h;
+        } else {
+            p_m->next = *p_node;
+            *p_node = p_m;
         }
+
+        p_h->next = *p_host;
+        *p_host = p_h;
     }
 
 }
@@ -329,12 +371,24 @@ void create_node_list() {
         p = (struct net_node *) malloc(sizeof(struct net_node));
         p->id = g_net_node[i].id;
         p->type = g_net_node[i].type;
+        metrics_add_node(p->id, p->type);
         p->next = g_node_list;
         g_node_list = p;
     }
 
 }
 
+/* Number of ports of a node created so far */
+static int ports_at_node(int node) {
+    struct net_port *p;
+    int n = 0;
+
+    for (p = g_port_list; p != NULL; p = p->next) {
+        if (p->pipe_host_id == node) n++;
+    }
+    return n;
+}
+
 /*
  * Create links, each with either a pipe or socket.
  * It uses private global varaibles g_net_link[] and g_net_link_num
@@ -357,10 +411,14 @@ void create_port_list() {
             p0 = (struct net_port *) malloc(sizeof(struct net_port));
             p0->type = g_net_link[i].type;
             p0->pipe_host_id = node0;
+            p0->index = ports_at_node(node0);  /* Numbered in link order, as net_get_port_list() gives them */
+            p0->metrics = metrics_add_port(node0);
 
             p1 = (struct net_port *) malloc(sizeof(struct net_port));
             p1->type = g_net_link[i].type;
             p1->pipe_host_id = node1;
+            p1->index = ports_at_node(node1);
+            p1->metrics = metrics_add_port(node1);
 
             pipe(fd01);  /* Create a pipe */
             /* Make the pipe nonblocking at both ends */
@@ -389,13 +447,17 @@ void create_port_list() {
  * Loads network configuration file and creates data structures
  * for nodes and links. 
  */
-int load_net_data_file() {
+int load_net_data_file(const char *config) {
     FILE *fp;
     char fname[MAX_FILE_NAME];
 
-    /* Open network configuration file */
-    printf("Enter network data file: ");
-    scanf("%s", fname);
+    /* Open network configuration file, given on the command line or asked for */
+    if (config != NULL) {
+        snprintf(fname, MAX_FILE_NAME, "%s", config);
+    } else {
+        printf("Enter network data file: ");
+        scanf("%s", fname);
+    }
     fp = fopen(fname, "r");
     if (fp == NULL) {
         fprintf(stderr, "net.c: File did not open\n");
@@ -436,8 +498,9 @@ int load_net_data_file() {
                 g_net_node[i].type = SWITCH;
                 g_net_node[i].id = node_id;
             } else if(node_type == 'D') {
-                if (node_id != DNS_SERVER_ID) {
-                    fprintf(stderr, "Can only have one DNS server, must have id 100\n");
+                // Any number of DNS servers, they replicate each other
+                if (node_id < 0 || node_id >= BROADCAST_ID) {
+                    fprintf(stderr, "DNS server ids must be between 0 and %d\n", BROADCAST_ID - 1);
                     exit(EXIT_FAILURE);
                 }
                 g_net_node[i].type = SERVER;
@@ -1,11 +1,14 @@
 
 
-int net_init();
+// Loads the network configuration file, asking for its name if config is NULL
+int net_init(const char *config);
 
 struct man_port_at_man *net_get_man_ports_at_man_list();
+struct man_port_at_man *net_get_man_ports_at_man_nodes();      // Switches and servers
 struct man_port_at_host *net_get_host_port(int host_id);
 
 struct net_node *net_get_node_list();
 struct net_port *net_get_port_list(int host_id);
+int net_get_server_ids(int *ids, int max);
 
 
@@ -1,15 +1,20 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/types.h>
 
 #include "packet.h"
 #include "net.h"
+#include "metrics.h"
+#include "capture.h"
+#include "trace.h"
 
 
 void packet_send(struct net_port *port, struct packet *p) {
-    char msg[PAYLOAD_MAX + 4];
+    char msg[PAYLOAD_MAX + 4 + TRACE_BYTES];
+    int len;
     int i;
 
     if (port->type == PIPE) {
@@ -20,28 +25,66 @@ void packet_send(struct net_port *port, struct packet *p) {
         for (i = 0; i < p->length; i++) {
             msg[i + 4] = p->payload[i];
         }
-        write(port->pipe_send_fd, msg, p->length + 4);
+        len = p->length + 4;
+        if (trace_on) {
+            msg[2] = (char) (msg[2] | PKT_TRACED);
+            len += trace_put(port->pipe_host_id, p, msg + len);
+        }
+        if (capture_on) capture_packet(port->index, msg, len);
+        write(port->pipe_send_fd, msg, len);
+        if (port->metrics != NULL) {
+            metrics_add(&port->metrics->tx_packets, 1);
+            metrics_add(&port->metrics->tx_bytes, len);
+        }
     }
 
     return;
 }
 
 int packet_recv(struct net_port *port, struct packet *p) {
-    char msg[PAYLOAD_MAX + 4];
+    char msg[PAYLOAD_MAX + 4 + TRACE_BYTES];
+    int traced;
     int n;
     int i;
 
+    n = 0;
     if (port->type == PIPE) {
-        n = (int) read(port->pipe_recv_fd, msg, PAYLOAD_MAX + 4);
-        if (n > 0) {
+        /*
+         * Read the header first and then exactly the payload, so that
+         * one read never takes bytes that belong to the next packet
+         */
+        n = (int) read(port->pipe_recv_fd, msg, 4);
+        if (n == 4) {
             p->src = (char) msg[0];
             p->dst = (char) msg[1];
-            p->type = (char) msg[2];
+            p->type = (char) (msg[2] & ~PKT_TRACED);
             p->length = (int) msg[3];
+            if (p->length < 0 || p->length > PAYLOAD_MAX) {
+                p->length = 0;
+            }
+            traced = msg[2] & PKT_TRACED ? TRACE_BYTES : 0;
+            i = 0;
+            while (i < p->length + traced) {
+                int k = (int) read(port->pipe_recv_fd, msg + 4 + i, p->length + traced - i);
+                if (k <= 0) break;
+                i += k;
+            }
+            if (i < p->length + traced) {
+                traced = 0;
+                if (i < p->length) p->length = i;
+            }
             for (i = 0; i < p->length; i++) {
                 p->payload[i] = msg[i + 4];
             }
-
+            memset(&p->trace, 0, sizeof(p->trace));
+            if (traced) trace_get(p, msg + 4 + p->length);
+            n = 4 + p->length + traced;
+            if (port->metrics != NULL) {
+                metrics_add(&port->metrics->rx_packets, 1);
+                metrics_add(&port->metrics->rx_bytes, n);
+            }
+        } else {
+            n = 0;
         }
     }
 
@@ -0,0 +1,195 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file ping.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ping.h"
+#include "man.h"
+#include "metrics.h"
+
+void ping_init(struct ping_table *t, int host_id) {
+    memset(t, 0, sizeof(struct ping_table));
+    t->host_id = host_id;
+}
+
+bool ping_start(struct ping_table *t, int dst, const char *options, uint32_t tag, char *err, int size) {
+    struct ping_session *s = NULL;
+    char text[MAN_MSG_LENGTH];
+    char *token, *save;
+    char *value;
+    int k;
+
+    for (k = 0; k < PING_SESSIONS_MAX && s == NULL; k++) {
+        if (!t->s[k].active) s = &t->s[k];
+    }
+    if (s == NULL) {
+        snprintf(err, size, "Ping failed, %d pings are running", PING_SESSIONS_MAX);
+        return false;
+    }
+    if (dst < 0 || dst > 127 || dst == t->host_id) {
+        snprintf(err, size, "Ping failed, invalid host %d", dst);
+        return false;
+    }
+
+    memset(s, 0, sizeof(struct ping_session));
+    s->count = 1;
+    s->interval_us = (uint64_t) PING_INTERVAL_MS * 1000;
+    s->size = PKT_PING_LENGTH;
+    s->wait_us = (uint64_t) PING_WAIT_MS * 1000;
+
+    snprintf(text, sizeof(text), "%s", options);
+    for (token = strtok_r(text, " ", &save); token != NULL; token = strtok_r(NULL, " ", &save)) {
+        if (strcmp(token, "flood") == 0) {
+            s->flood = true;
+            continue;
+        }
+        value = strchr(token, '=');
+        if (value == NULL) {
+            snprintf(err, size, "Invalid ping option %s", token);
+            return false;
+        }
+        *value++ = '\0';
+        if (strcmp(token, "count") == 0) {
+            s->count = (uint32_t) atoi(value);
+        } else if (strcmp(token, "interval") == 0) {
+            s->interval_us = (uint64_t) atoi(value) * 1000;
+        } else if (strcmp(token, "size") == 0) {
+            s->size = atoi(value);
+        } else if (strcmp(token, "wait") == 0) {
+            s->wait_us = (uint64_t) atoi(value) * 1000;
+        } else {
+            snprintf(err, size, "Invalid ping option %s", token);
+            return false;
+        }
+    }
+    if (s->count < 1 || s->count > PING_COUNT_MAX || s->size < PKT_PING_LENGTH || s->size > PAYLOAD_MAX) {
+        snprintf(err, size, "Invalid ping: count 1 to %d, size %d to %d", PING_COUNT_MAX, PKT_PING_LENGTH,
+                 PAYLOAD_MAX);
+        return false;
+    }
+
+    s->id = ++t->next_id;
+    s->dst = dst;
+    s->tag = tag;
+    s->next_us = 0;     // The first request goes out right away
+    s->active = true;
+    return true;
+}
+
+bool ping_next(struct ping_table *t, uint64_t now, struct packet *p) {
+    struct ping_session *s;
+    uint16_t seq;
+    int k;
+
+    for (k = 0; k < PING_SESSIONS_MAX; k++) {
+        s = &t->s[k];
+        if (!s->active || s->sent == s->count || s->next_us > now) continue;
+
+        memset(p, 0, sizeof(struct packet));
+        p->src = (char) t->host_id;
+        p->dst = (char) s->dst;
+        p->type = (char) PKT_PING_REQ;
+        p->length = s->size;
+        seq = (uint16_t) s->sent;
+        memcpy(p->payload + PKT_PING_ID, &s->id, sizeof(s->id));
+        memcpy(p->payload + PKT_PING_SEQ, &seq, sizeof(seq));
+        memcpy(p->payload + PKT_PING_TIME, &now, sizeof(now));
+
+        s->sent++;
+        s->last_us = now;
+        s->next_us = now + (s->flood ? PING_FLOOD_US : s->interval_us);
+        return true;
+    }
+    return false;
+}
+
+void ping_received(struct ping_table *t, struct packet *p, uint64_t now) {
+    struct ping_session *s;
+    uint16_t id, seq;
+    uint64_t sent_us, rtt;
+    int k;
+
+    // Replies to pings without a payload cannot be matched to one
+    if (p->length < PKT_PING_LENGTH) return;
+    memcpy(&id, p->payload + PKT_PING_ID, sizeof(id));
+    memcpy(&seq, p->payload + PKT_PING_SEQ, sizeof(seq));
+    memcpy(&sent_us, p->payload + PKT_PING_TIME, sizeof(sent_us));
+
+    for (k = 0; k < PING_SESSIONS_MAX; k++) {
+        s = &t->s[k];
+        if (!s->active || s->id != id || s->dst != (int) (unsigned char) p->src) continue;
+        if (seq >= s->sent || sent_us > now) return;
+        if (s->seen[seq / 8] & (1 << (seq % 8))) {
+            s->duplicates++;
+            return;
+        }
+        s->seen[seq / 8] |= (uint8_t) (1 << (seq % 8));
+
+        rtt = now - sent_us;
+        if (s->received == 0 || rtt < s->rtt_min) s->rtt_min = rtt;
+        if (rtt > s->rtt_max) s->rtt_max = rtt;
+        s->rtt_sum += (double) rtt;
+        s->rtt_sum_sq += (double) rtt * (double) rtt;
+        s->received++;
+        metrics_observe(&metrics_self()->ping_rtt_us, rtt);
+
+        if (s->flood) s->next_us = now;
+        return;
+    }
+}
+
+int ping_done(struct ping_table *t, uint64_t now, uint32_t *tag, char *buf, int size) {
+    struct ping_session *s;
+    double avg, dev;
+    int n, k;
+
+    for (k = 0; k < PING_SESSIONS_MAX; k++) {
+        s = &t->s[k];
+        if (!s->active || s->sent < s->count) continue;
+        if (s->received < s->sent && now < s->last_us + s->wait_us) continue;
+
+        s->active = false;
+        *tag = s->tag;
+        if (s->received == 0) {
+            n = snprintf(buf, size, "Ping time out! %u sent, 0 received", s->sent);
+        } else {
+            avg = s->rtt_sum / s->received;
+            dev = s->rtt_sum_sq / s->received - avg * avg;
+            dev = dev > 0 ? sqrt(dev) : 0;
+            n = snprintf(buf, size, "Ping acked! %u sent, %u received, %u%% loss, "
+                                    "rtt min/avg/max/stddev %.3f/%.3f/%.3f/%.3f ms",
+                         s->sent, s->received, (s->sent - s->received) * 100 / s->sent,
+                         s->rtt_min / 1e3, avg / 1e3, s->rtt_max / 1e3, dev / 1e3);
+        }
+        if (s->duplicates > 0 && n < size) {
+            n += snprintf(buf + n, size - n, ", %u duplicates", s->duplicates);
+        }
+        return n < size ? n : size - 1;
+    }
+    return 0;
+}
+
+int ping_report(struct ping_table *t, char *buf, int size) {
+    struct ping_session *s;
+    int n = 0;
+    int k;
+
+    for (k = 0; k < PING_SESSIONS_MAX && n < size; k++) {
+        s = &t->s[k];
+        if (!s->active) continue;
+        n += snprintf(buf + n, size - n, "    Pinging %d: %u of %u sent, %u received\n", s->dst, s->sent, s->count,
+                      s->received);
+    }
+    return n < size ? n : size - 1;
+}
@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file ping.h
+/// @version 1.0
+///
+/// Pings of a host, the latency probe of the simulator. Each request
+/// carries the id of its ping, a sequence number and the time it was
+/// sent; the node pinged sends the payload back, so a reply gives its RTT
+/// without a lookup and a reply of another ping, a duplicate or a late one
+/// is told apart. Several pings run at once, each answering its own
+/// manager command. Started with "p <host id> [options]":
+///
+///     3
+///     3 count=10 interval=200
+///     3 count=500 flood size=100 wait=2000
+///
+/// count is the requests to send (1 if not given), interval the ms between
+/// them (PING_INTERVAL_MS if not given), flood sends the next one as soon
+/// as a reply comes back and at the latest on the next pass of the host's
+/// loop, size pads the payload, wait is how long the last request is
+/// waited for. The answer sums them up:
+///
+///     Ping acked! 10 sent, 9 received, 10% loss, rtt min/avg/max/stddev 0.812/1.020/1.604/0.221 ms
+///
+/// or "Ping time out!" when nothing came back. RTTs also go to the
+/// ping_rtt histogram of the host's metrics.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_PING_H
+#define NETWORK_SIMULATOR_02_PING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "main.h"
+
+#define PING_SESSIONS_MAX   8       /* Pings running at once on a host */
+#define PING_COUNT_MAX      4096    /* Requests of one ping */
+#define PING_INTERVAL_MS    1000
+#define PING_WAIT_MS        1000    /* Default time the last request is waited for */
+#define PING_FLOOD_US       10000   /* Longest a flood waits for a reply, one pass of the loop */
+
+struct ping_session {
+    bool active;
+    uint16_t id;
+    int dst;
+    uint32_t tag;                   // Of the manager command to answer
+    uint32_t count;
+    uint64_t interval_us;
+    bool flood;
+    int size;                       // Payload length
+    uint64_t wait_us;
+    uint64_t next_us;               // When the next request is due
+    uint64_t last_us;               // When the last one went out
+    uint32_t sent, received, duplicates;
+    uint64_t rtt_min, rtt_max;
+    double rtt_sum, rtt_sum_sq;
+    uint8_t seen[PING_COUNT_MAX / 8];   // Sequence numbers answered
+};
+
+struct ping_table {
+    int host_id;
+    uint16_t next_id;
+    struct ping_session s[PING_SESSIONS_MAX];
+};
+
+void ping_init(struct ping_table *t, int host_id);
+
+// Start pinging dst with options, answered under tag; returns false with why in err if it cannot
+bool ping_start(struct ping_table *t, int dst, const char *options, uint32_t tag, char *err, int size);
+
+// Fill p with the next request due by now, returns false once none is
+bool ping_next(struct ping_table *t, uint64_t now, struct packet *p);
+
+// A PKT_PING_REPLY arrived for this host
+void ping_received(struct ping_table *t, struct packet *p, uint64_t now);
+
+// Summary of a ping that is over and its tag, returns its length, 0 if no ping is over
+int ping_done(struct ping_table *t, uint64_t now, uint32_t *tag, char *buf, int size);
+
+// The pings running, a line each, returns the length written
+int ping_report(struct ping_table *t, char *buf, int size);
+
+#endif //NETWORK_SIMULATOR_02_PING_H
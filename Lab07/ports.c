@@ -0,0 +1,40 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file ports.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ports.h"
+#include "clock.h"
+
+void ports_init(struct port_table *ports) {
+    int i;
+
+    for (i = 0; i < PORTS_MAX_ID; i++) {
+        ports->port[i] = -1;
+        ports->heard_ms[i] = 0;
+    }
+}
+
+void ports_learn(struct port_table *ports, struct packet *pkt, int port) {
+    int src = (int) pkt->src;
+
+    if (src < 0 || src >= PORTS_MAX_ID || src == BROADCAST_ID) return;
+    ports->port[src] = port;
+    ports->heard_ms[src] = clock_ms();
+}
+
+int ports_lookup(struct port_table *ports, struct packet *pkt) {
+    int dst = (int) pkt->dst;
+
+    // Control packets are for the neighbours on every link
+    if (pkt->type == (char) PKT_CONTROL_PKT) return -1;
+    if (dst < 0 || dst >= PORTS_MAX_ID || dst == BROADCAST_ID) return -1;
+    if (ports->port[dst] < 0 || clock_ms() - ports->heard_ms[dst] >= PORTS_AGE_MS) return -1;
+    return ports->port[dst];
+}
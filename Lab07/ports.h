@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file ports.h
+/// @version 1.0
+///
+/// Which port each node was last heard on, for hosts and servers with
+/// more than one link. Every received packet teaches the port of its
+/// source, addressed to us or not, the same way the switches learn. A
+/// packet to a node we have heard from recently goes out on that port
+/// only; anything else is still sent on every port.
+///
+/// Entries go stale after PORTS_AGE_MS, so a node that moved is found
+/// again by flooding.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_PORTS_H
+#define NETWORK_SIMULATOR_02_PORTS_H
+
+#include <stdint.h>
+
+#include "main.h"
+#include "packet.h"
+
+#define PORTS_MAX_ID        128     /* Node ids are signed chars */
+#define PORTS_AGE_MS        10000
+
+struct port_table {
+    int port[PORTS_MAX_ID];         // -1 if never heard from
+    uint32_t heard_ms[PORTS_MAX_ID];
+};
+
+void ports_init(struct port_table *ports);
+
+// Note that pkt came in on port
+void ports_learn(struct port_table *ports, struct packet *pkt, int port);
+
+// Port to send pkt on, -1 to send it on every port
+int ports_lookup(struct port_table *ports, struct packet *pkt);
+
+#endif //NETWORK_SIMULATOR_02_PORTS_H
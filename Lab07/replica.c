@@ -0,0 +1,371 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file replica.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "replica.h"
+#include "net.h"
+#include "clock.h"
+
+#define RECORD_HEADER   7           /* op, host id, name length, expiry */
+
+static void start_sync(struct replication *rep, struct replica_peer *peer);
+
+void replication_init(struct replication *rep, int self, replica_send_fn send, void *send_arg) {
+    int ids[REPLICA_MAX];
+    int n;
+
+    memset(rep, 0, sizeof(struct replication));
+    rep->self = self;
+    rep->send = send;
+    rep->send_arg = send_arg;
+    rep->log = (struct replica_change *) calloc(REPLICA_LOG_SIZE, sizeof(struct replica_change));
+
+    // A new epoch every start, so peers know to send us everything again
+    rep->epoch = (uint32_t) time(NULL) ^ ((uint32_t) getpid() << 16) ^ clock_ms();
+    if (rep->epoch == 0) rep->epoch = 1;
+
+    n = net_get_server_ids(ids, REPLICA_MAX);
+    for (int i = 0; i < n; i++) {
+        if (ids[i] == self) continue;
+        rep->peers[rep->num_peers].id = ids[i];
+        start_sync(rep, &rep->peers[rep->num_peers]);
+        rep->num_peers++;
+    }
+}
+
+static void put_record(char *rec, char op, int id, int len, uint32_t expires, const char *name) {
+    rec[0] = op;
+    rec[1] = (char) id;
+    rec[2] = (char) len;
+    memcpy(rec + 3, &expires, sizeof(uint32_t));
+    memcpy(rec + RECORD_HEADER, name, len);
+}
+
+static bool add_image_record(void *arg, const char *name, int id, uint32_t expires) {
+    struct replica_image *image = (struct replica_image *) arg;
+    int len = (int) strlen(name);
+
+    put_record(image->buf + image->size, DNS_WAL_ADD, id, len, expires, name);
+    image->size += RECORD_HEADER + len;
+    return true;
+}
+
+static bool size_image_record(void *arg, const char *name, int id, uint32_t expires) {
+    (void) id;
+    (void) expires;
+    *(size_t *) arg += RECORD_HEADER + strlen(name);
+    return true;
+}
+
+static void release_image(struct replication *rep, struct replica_peer *peer) {
+    struct replica_image *image = peer->image;
+
+    peer->image = NULL;
+    if (image == NULL || --image->refs > 0) return;
+    if (rep->image == image) rep->image = NULL;
+    free(image->buf);
+    free(image);
+}
+
+// The current image, taken again if the table changed since the last one
+static struct replica_image *get_image(struct replication *rep, struct dns_db *db) {
+    struct replica_image *image = rep->image;
+    size_t size = 0;
+
+    if (image != NULL && image->version == rep->version) return image;
+
+    dns_db_each(db, size_image_record, &size);
+    image = (struct replica_image *) calloc(1, sizeof(struct replica_image));
+    image->buf = (char *) malloc(size > 0 ? size : 1);
+    image->version = rep->version;
+    image->log_seq = rep->next_seq;
+    dns_db_each(db, add_image_record, image);
+
+    // The old image stays with the peers still reading it
+    rep->image = image;
+    return image;
+}
+
+static void start_sync(struct replication *rep, struct replica_peer *peer) {
+    release_image(rep, peer);
+    peer->phase = DNS_SYNC;
+    peer->position = 0;
+    peer->in_flight = false;
+}
+
+void replication_log(struct replication *rep, char op, const char *name, int len, int id, uint32_t expires) {
+    struct replica_change *c = &rep->log[rep->next_seq % REPLICA_LOG_SIZE];
+
+    if (len > MAX_DNS_NAME_LENGTH) return;
+    c->op = op;
+    c->id = (uint8_t) id;
+    c->len = (uint8_t) len;
+    c->expires = expires;
+    memcpy(c->name, name, len);
+    rep->next_seq++;
+    rep->version++;
+}
+
+static struct packet *stream_packet(struct replication *rep, struct replica_peer *peer) {
+    struct packet *pkt = (struct packet *) calloc(1, sizeof(struct packet));
+
+    pkt->src = (char) rep->self;
+    pkt->dst = (char) peer->id;
+    pkt->type = (char) PKT_DNS_REPLICATE;
+    memcpy(pkt->payload + PKT_DNS_REP_EPOCH, &rep->epoch, sizeof(uint32_t));
+    pkt->payload[PKT_DNS_REP_PHASE] = peer->phase;
+    memcpy(pkt->payload + PKT_DNS_REP_POSITION, &peer->position, sizeof(uint32_t));
+    pkt->payload[PKT_DNS_REP_COUNT] = 0;
+    pkt->length = PKT_DNS_REP_RECORDS;
+    return pkt;
+}
+
+// Next page of the image, returns NULL once all of it is acked
+static struct packet *sync_packet(struct replication *rep, struct replica_peer *peer) {
+    struct replica_image *image = peer->image;
+    struct packet *pkt;
+    uint32_t pos = peer->position;
+    int rec;
+
+    if (pos >= image->size && pos > 0) return NULL;
+    pkt = stream_packet(rep, peer);
+    while (pos < image->size) {
+        rec = RECORD_HEADER + (unsigned char) image->buf[pos + 2];
+        if (pkt->length + rec > PAYLOAD_MAX) break;
+        memcpy(pkt->payload + pkt->length, image->buf + pos, rec);
+        pkt->length += rec;
+        pkt->payload[PKT_DNS_REP_COUNT]++;
+        pos += rec;
+    }
+    // An empty table still takes one (empty) page, which moves the position by one
+    peer->advance = pos > peer->position ? pos - peer->position : 1;
+    return pkt;
+}
+
+static struct packet *log_packet(struct replication *rep, struct replica_peer *peer) {
+    struct packet *pkt;
+    struct replica_change *c;
+    uint32_t seq = peer->position;
+
+    if (seq == rep->next_seq) return NULL;
+    pkt = stream_packet(rep, peer);
+    while (seq != rep->next_seq) {
+        c = &rep->log[seq % REPLICA_LOG_SIZE];
+        if (pkt->length + RECORD_HEADER + c->len > PAYLOAD_MAX) break;
+        put_record(pkt->payload + pkt->length, c->op, c->id, c->len, c->expires, c->name);
+        pkt->length += RECORD_HEADER + c->len;
+        pkt->payload[PKT_DNS_REP_COUNT]++;
+        seq++;
+    }
+    peer->advance = seq - peer->position;
+    return pkt;
+}
+
+void replication_tick(struct replication *rep, struct dns_db *db) {
+    struct replica_peer *peer;
+    struct packet *pkt;
+    uint32_t now = clock_ms();
+
+    for (int i = 0; i < rep->num_peers; i++) {
+        peer = &rep->peers[i];
+        if (peer->in_flight && now - peer->sent_ms < REPLICA_RESEND_MS) continue;
+
+        if (peer->phase == DNS_SYNC) {
+            if (peer->image == NULL) {
+                peer->image = get_image(rep, db);
+                peer->image->refs++;
+            }
+            pkt = sync_packet(rep, peer);
+        } else {
+            // The log no longer has the changes the peer is missing
+            if (rep->next_seq - peer->position > REPLICA_LOG_SIZE) {
+                start_sync(rep, peer);
+                continue;
+            }
+            pkt = log_packet(rep, peer);
+        }
+        if (pkt == NULL) continue;
+
+        rep->send(rep->send_arg, pkt);
+        peer->in_flight = true;
+        peer->sent_ms = now;
+        rep->packets_sent++;
+    }
+}
+
+bool replication_wants_table(struct replication *rep) {
+    struct replica_peer *peer;
+    uint32_t now = clock_ms();
+
+    if (rep->image != NULL && rep->image->version == rep->version) return false;
+    for (int i = 0; i < rep->num_peers; i++) {
+        peer = &rep->peers[i];
+        if (peer->phase != DNS_SYNC || peer->image != NULL) continue;
+        if (!peer->in_flight || now - peer->sent_ms >= REPLICA_RESEND_MS) return true;
+    }
+    return false;
+}
+
+int replication_wait_ms(struct replication *rep) {
+    struct replica_peer *peer;
+    uint32_t now = clock_ms();
+    int wait = -1;
+    int w;
+
+    for (int i = 0; i < rep->num_peers; i++) {
+        peer = &rep->peers[i];
+        if (peer->in_flight) {
+            // Resent once it has been out too long
+            w = now - peer->sent_ms >= REPLICA_RESEND_MS ? 0 : (int) (REPLICA_RESEND_MS - (now - peer->sent_ms));
+        } else if (peer->phase == DNS_SYNC || peer->position != rep->next_seq) {
+            w = 0;
+        } else {
+            continue;
+        }
+        if (wait < 0 || w < wait) wait = w;
+    }
+    return wait;
+}
+
+static struct replica_peer *find_peer(struct replication *rep, int id) {
+    for (int i = 0; i < rep->num_peers; i++) {
+        if (rep->peers[i].id == id) return &rep->peers[i];
+    }
+    return NULL;
+}
+
+static void send_ack(struct replication *rep, struct replica_peer *peer) {
+    struct packet *pkt = (struct packet *) calloc(1, sizeof(struct packet));
+
+    pkt->src = (char) rep->self;
+    pkt->dst = (char) peer->id;
+    pkt->type = (char) PKT_DNS_REPLICATE_ACK;
+    memcpy(pkt->payload + PKT_DNS_REP_EPOCH, &peer->recv_epoch, sizeof(uint32_t));
+    pkt->payload[PKT_DNS_REP_PHASE] = peer->recv_phase;
+    memcpy(pkt->payload + PKT_DNS_REP_POSITION, &peer->recv_position, sizeof(uint32_t));
+    pkt->length = PKT_DNS_REP_ACK_LENGTH;
+    rep->send(rep->send_arg, pkt);
+}
+
+// Apply one change from a peer, keeping the lower host id when two hosts claim a name
+static void apply(struct replication *rep, struct dns_db *db, struct dns_wal *wal, char op, const char *name,
+                  int len, int id, uint32_t expires) {
+    int owner = dns_db_lookup(db, name, len);
+
+    if (op == DNS_WAL_ADD) {
+        if (expires != 0 && expires <= atomic_load_explicit(&db->now, memory_order_relaxed)) return;
+        if (owner == id) {
+            // The host renewed its lease over there
+            dns_db_renew(db, name, len, id, expires);
+        } else {
+            if (owner >= 0 && owner < id) return;
+            if (owner >= 0) {
+                dns_db_remove(db, name, len);
+                dns_wal_append(wal, DNS_WAL_REMOVE, name, len, owner, 0);
+            }
+            dns_db_insert(db, name, len, id, expires);
+        }
+        dns_wal_append(wal, DNS_WAL_ADD, name, len, id, expires);
+    } else if (op == DNS_WAL_REMOVE) {
+        if (owner != id) return;
+        dns_db_remove(db, name, len);
+        dns_wal_append(wal, DNS_WAL_REMOVE, name, len, id, 0);
+    } else {
+        return;
+    }
+    rep->version++;
+    rep->changes_applied++;
+}
+
+void replication_recv(struct replication *rep, struct dns_db *db, struct dns_wal *wal, struct packet *pkt) {
+    struct replica_peer *peer = find_peer(rep, (int) (unsigned char) pkt->src);
+    uint32_t epoch, position;
+    char phase;
+    uint32_t expires;
+    int count, pos, len;
+
+    if (peer == NULL || pkt->length < PKT_DNS_REP_RECORDS) return;
+    memcpy(&epoch, pkt->payload + PKT_DNS_REP_EPOCH, sizeof(uint32_t));
+    memcpy(&position, pkt->payload + PKT_DNS_REP_POSITION, sizeof(uint32_t));
+    phase = pkt->payload[PKT_DNS_REP_PHASE];
+    count = (unsigned char) pkt->payload[PKT_DNS_REP_COUNT];
+
+    if (epoch != peer->recv_epoch) {
+        // The peer restarted, or we did: its stream has to begin with a copy
+        peer->recv_epoch = epoch;
+        peer->recv_phase = DNS_SYNC;
+        peer->recv_position = 0;
+    }
+
+    // Take the packet we expect, a new copy, or the first of the log once a copy is in.
+    // Anything else gets an ack saying what we expect.
+    if (!((phase == peer->recv_phase && position == peer->recv_position)
+          || (phase == DNS_SYNC && position == 0 && (peer->recv_phase == DNS_LOG || peer->recv_position == 0))
+          || (phase == DNS_LOG && peer->recv_phase == DNS_SYNC && peer->recv_position > 0))) {
+        send_ack(rep, peer);
+        return;
+    }
+
+    pos = PKT_DNS_REP_RECORDS;
+    for (int i = 0; i < count && pos + RECORD_HEADER <= pkt->length; i++) {
+        len = (unsigned char) pkt->payload[pos + 2];
+        if (pos + RECORD_HEADER + len > pkt->length) break;
+        memcpy(&expires, pkt->payload + pos + 3, sizeof(uint32_t));
+        apply(rep, db, wal, pkt->payload[pos], pkt->payload + pos + RECORD_HEADER, len,
+              (int) (unsigned char) pkt->payload[pos + 1], expires);
+        pos += RECORD_HEADER + len;
+    }
+
+    // Positions of a copy count bytes (an empty page counts one), those of the log count changes
+    peer->recv_phase = phase;
+    if (phase == DNS_SYNC) {
+        peer->recv_position = position + (count > 0 ? (uint32_t) (pos - PKT_DNS_REP_RECORDS) : 1);
+    } else {
+        peer->recv_position = position + (uint32_t) count;
+    }
+    send_ack(rep, peer);
+}
+
+void replication_recv_ack(struct replication *rep, struct packet *pkt) {
+    struct replica_peer *peer = find_peer(rep, (int) (unsigned char) pkt->src);
+    uint32_t epoch, position;
+    char phase;
+
+    if (peer == NULL || pkt->length < PKT_DNS_REP_ACK_LENGTH) return;
+    memcpy(&epoch, pkt->payload + PKT_DNS_REP_EPOCH, sizeof(uint32_t));
+    memcpy(&position, pkt->payload + PKT_DNS_REP_POSITION, sizeof(uint32_t));
+    phase = pkt->payload[PKT_DNS_REP_PHASE];
+
+    if (epoch != rep->epoch) {
+        // It has not heard from this run yet, the next packet will tell it
+        return;
+    }
+    if (phase == DNS_SYNC && position == 0 && !(peer->phase == DNS_SYNC && peer->position == 0)) {
+        // The peer lost what we sent, start over
+        start_sync(rep, peer);
+        return;
+    }
+    if (!peer->in_flight || phase != peer->phase || position != peer->position + peer->advance) return;
+
+    peer->position = position;
+    peer->in_flight = false;
+    if (peer->phase == DNS_SYNC && peer->position >= peer->image->size) {
+        // The copy is in, carry on with the changes made since it was taken
+        peer->phase = DNS_LOG;
+        peer->position = peer->image->log_seq;
+        release_image(rep, peer);
+    }
+    peer->sent_ms = 0;
+}
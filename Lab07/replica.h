@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file replica.h
+/// @version 1.0
+///
+/// Replication between DNS servers. Every server streams its own
+/// registrations to every other server (see PKT_DNS_REPLICATE in main.h),
+/// one packet in flight per peer, resent until it is acked.
+///
+/// A stream starts with a copy of the whole table. The copy is an image
+/// of records taken when the stream starts, so names changing while it
+/// is sent cannot shift it; the changes after that come from the log.
+/// Peers that fall further behind than the log reaches start over with a
+/// new copy.
+///
+/// If two hosts register the same name at two servers at once, the
+/// lower host id keeps it everywhere. A renewed lease is sent as another
+/// add by the same host; names that expire do so on every server by
+/// themselves, as each has the expiry.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_REPLICA_H
+#define NETWORK_SIMULATOR_02_REPLICA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "main.h"
+#include "dns_db.h"
+#include "dns_wal.h"
+
+#define REPLICA_MAX         16      /* DNS servers in one network */
+#define REPLICA_LOG_SIZE    4096    /* Changes kept for peers that are behind */
+#define REPLICA_RESEND_MS   200
+
+struct replica_change {
+    char op;                        // DNS_WAL_ADD or DNS_WAL_REMOVE
+    uint8_t id;
+    uint8_t len;
+    uint32_t expires;
+    char name[MAX_DNS_NAME_LENGTH];
+};
+
+// Copy of the table as replication records, shared by the peers being sent it
+struct replica_image {
+    char *buf;
+    uint32_t size;
+    uint32_t version;               // replication version it was taken at
+    uint32_t log_seq;               // First change made after it
+    int refs;
+};
+
+struct replica_peer {
+    int id;
+
+    // Our stream to the peer
+    char phase;                     // DNS_SYNC or DNS_LOG
+    uint32_t position;              // Acked so far: image bytes or change number
+    struct replica_image *image;
+    bool in_flight;
+    uint32_t advance;               // How far the packet in flight moves position
+    uint32_t sent_ms;
+
+    // The peer's stream to us
+    uint32_t recv_epoch;            // 0 until it sends something
+    char recv_phase;
+    uint32_t recv_position;
+};
+
+// Queues a packet for sending
+typedef void (*replica_send_fn)(void *arg, struct packet *pkt);
+
+struct replication {
+    int self;
+    uint32_t epoch;
+    struct replica_peer peers[REPLICA_MAX];
+    int num_peers;
+    struct replica_change *log;     // Ring of REPLICA_LOG_SIZE
+    uint32_t next_seq;
+    uint32_t version;               // Bumped by every change to the table
+    struct replica_image *image;    // Latest image, NULL if none is in use
+    replica_send_fn send;
+    void *send_arg;
+    uint32_t packets_sent;
+    uint32_t changes_applied;
+};
+
+// The peers are the other 'D' nodes of the network
+void replication_init(struct replication *rep, int self, replica_send_fn send, void *send_arg);
+
+// Record a change made here, to be sent to every peer
+void replication_log(struct replication *rep, char op, const char *name, int len, int id, uint32_t expires);
+
+// Send what each peer is owed, called once per pass of the server loop
+void replication_tick(struct replication *rep, struct dns_db *db);
+
+// True if the next replication_tick() reads the whole of db, to copy it for a peer
+bool replication_wants_table(struct replication *rep);
+
+// Milliseconds until replication_tick() has something to send, -1 if it has nothing
+int replication_wait_ms(struct replication *rep);
+
+// Handler for PKT_DNS_REPLICATE, changes are applied to db and logged to wal
+void replication_recv(struct replication *rep, struct dns_db *db, struct dns_wal *wal, struct packet *pkt);
+
+// Handler for PKT_DNS_REPLICATE_ACK
+void replication_recv_ack(struct replication *rep, struct packet *pkt);
+
+#endif //NETWORK_SIMULATOR_02_REPLICA_H
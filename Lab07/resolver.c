@@ -0,0 +1,598 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file resolver.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "resolver.h"
+#include "clock.h"
+#include "net.h"
+#include "metrics.h"
+
+void resolver_init(struct resolver *res, int host_id, struct job_queue *job_q) {
+    int ids[RESOLVER_MAX_SERVERS];
+
+    memset(res, 0, sizeof(struct resolver));
+    res->host_id = host_id;
+    res->job_q = job_q;
+    res->policy = RESOLVER_NEAREST;
+    res->reg_type = PKT_DNS_REGISTER;
+
+    // Every 'D' node in the network configuration
+    res->num_servers = net_get_server_ids(ids, RESOLVER_MAX_SERVERS);
+    for (int i = 0; i < res->num_servers; i++) res->servers[i].id = ids[i];
+}
+
+static struct dns_server *find_server(struct resolver *res, int id) {
+    for (int i = 0; i < res->num_servers; i++) {
+        if (res->servers[i].id == id) return &res->servers[i];
+    }
+    return NULL;
+}
+
+static bool server_up(struct dns_server *s, uint32_t now) {
+    if ((int32_t) (s->down_until - now) > 0) return false;
+    return s->beacon_ms == 0 || now - s->beacon_ms < RESOLVER_SILENT_MS;
+}
+
+// True if a should be asked rather than b
+static bool server_better(struct resolver *res, struct dns_server *a, struct dns_server *b) {
+    // Our own packets since its beacon count too, so a burst does not all land on one server
+    uint32_t load_a = a->load + a->sent;
+    uint32_t load_b = b->load + b->sent;
+
+    if (res->policy == RESOLVER_LEAST_LOADED && load_a != load_b) return load_a < load_b;
+
+    // Servers not timed yet go first, so each gets measured
+    if (a->timed != b->timed) return !a->timed;
+    if (a->timed && a->srtt != b->srtt) return a->srtt < b->srtt;
+    return load_a < load_b;
+}
+
+static int pick_server(struct resolver *res) {
+    struct dns_server *best = NULL;
+    uint32_t now = clock_ms();
+    bool any_up = false;
+
+    for (int i = 0; i < res->num_servers; i++) {
+        if (server_up(&res->servers[i], now)) any_up = true;
+    }
+    for (int i = 0; i < res->num_servers; i++) {
+        struct dns_server *s = &res->servers[i];
+        if (any_up && !server_up(s, now)) continue;     // If all look down, try them anyway
+        if (best == NULL || server_better(res, s, best)) best = s;
+    }
+    if (best == NULL) return BROADCAST_ID;
+    best->sent++;
+    return best->id;
+}
+
+// No reply in time, let the other servers take over for a while
+static void server_timed_out(struct resolver *res, int id, uint32_t now) {
+    struct dns_server *s = find_server(res, id);
+    if (s != NULL && res->num_servers > 1) s->down_until = now + RESOLVER_DOWN_MS;
+}
+
+static void server_answered(struct resolver *res, int id, uint32_t sent_ms, uint32_t now) {
+    struct dns_server *s = find_server(res, id);
+    uint32_t rtt = now - sent_ms;
+
+    if (s == NULL) return;
+    s->down_until = now;
+    s->srtt = s->timed ? (7 * s->srtt + rtt) / 8 : rtt;
+    s->timed = true;
+}
+
+// Time the first reply to a request
+static void request_answered(struct resolver *res, struct packet *pkt) {
+    uint16_t req_id;
+
+    memcpy(&req_id, pkt->payload + PKT_DNS_REQ_ID, sizeof(uint16_t));
+    for (int i = 0; i < RESOLVER_REQUESTS; i++) {
+        struct dns_request *r = &res->requests[i];
+        if (r->active && r->req_id == req_id && r->server == (int) (unsigned char) pkt->src) {
+            server_answered(res, r->server, r->sent_ms, clock_ms());
+            r->active = false;
+            return;
+        }
+    }
+}
+
+static struct dns_cache_entry *cache_find(struct resolver *res, const char *name) {
+    for (int i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+        if (res->cache[i].valid && strcmp(res->cache[i].name, name) == 0) return &res->cache[i];
+    }
+    return NULL;
+}
+
+// A free entry, or else the least recently used one without a query outstanding
+static struct dns_cache_entry *cache_alloc(struct resolver *res, const char *name, uint32_t now) {
+    struct dns_cache_entry *e = NULL;
+
+    for (int i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+        struct dns_cache_entry *c = &res->cache[i];
+        if (!c->valid) {
+            e = c;
+            break;
+        }
+        if (e == NULL || (e->pending && !c->pending)
+            || (e->pending == c->pending && now - c->used_ms > now - e->used_ms)) {
+            e = c;
+        }
+    }
+
+    memset(e, 0, sizeof(struct dns_cache_entry));
+    e->valid = true;
+    e->used_ms = now;
+    snprintf(e->name, sizeof(e->name), "%s", name);
+    return e;
+}
+
+// Start a batch of names, numbered so the replies can be told apart
+static struct packet *batch_start(struct resolver *res, int type) {
+    struct packet *pkt = (struct packet *) calloc(1, sizeof(struct packet));
+
+    struct dns_request *r = &res->requests[res->next_req_id % RESOLVER_REQUESTS];
+
+    pkt->src = (char) res->host_id;
+    pkt->dst = (char) pick_server(res);
+    pkt->type = (char) type;
+    memcpy(pkt->payload + PKT_DNS_REQ_ID, &res->next_req_id, sizeof(uint16_t));
+    pkt->payload[PKT_DNS_COUNT] = 0;
+    pkt->length = PKT_DNS_RECORDS;
+
+    r->active = true;
+    r->req_id = res->next_req_id;
+    r->server = (int) (unsigned char) pkt->dst;
+    r->sent_ms = clock_ms();
+    res->next_req_id++;
+    return pkt;
+}
+
+// Append a name to the batch, returns false if it is full
+static bool batch_add(struct packet *pkt, const char *name) {
+    int len = (int) strlen(name);
+
+    if (pkt->length + 1 + len > PAYLOAD_MAX) return false;
+    pkt->payload[pkt->length] = (char) len;
+    memcpy(pkt->payload + pkt->length + 1, name, len);
+    pkt->length += 1 + len;
+    pkt->payload[PKT_DNS_COUNT]++;
+    return true;
+}
+
+static void batch_send(struct resolver *res, struct packet *pkt) {
+    struct host_job *job = (struct host_job *) malloc(sizeof(struct host_job));
+
+    job->type = JOB_SEND_PKT;
+    job->packet = pkt;
+    job_q_add(res->job_q, job);
+    res->queries++;
+    res->names += (unsigned char) pkt->payload[PKT_DNS_COUNT];
+}
+
+enum resolve_status resolver_lookup(struct resolver *res, const char *name, int *id) {
+    struct dns_cache_entry *e = cache_find(res, name);
+    uint32_t now = clock_ms();
+
+    // No reply could carry the answer, so it cannot have been registered
+    if ((int) strlen(name) > DNS_NAME_MAX) {
+        res->lookups++;
+        return RESOLVE_NOT_FOUND;
+    }
+
+    if (e != NULL && e->answered && (int32_t) (e->expires_ms - now) > 0) {
+        e->used_ms = now;
+        res->lookups++;
+        metrics_add(&metrics_self()->dns_hits, 1);
+        *id = e->id;
+        return e->found ? RESOLVE_FOUND : RESOLVE_NOT_FOUND;
+    }
+
+    if (e == NULL) e = cache_alloc(res, name, now);
+    if (!e->pending) metrics_add(&metrics_self()->dns_misses, 1);     // Not again while its query is out
+
+    // Lookups of the same name share one query
+    if (!e->pending || now - e->sent_ms >= RESOLVER_RETRY_MS) {
+        if (e->pending && !e->queued) server_timed_out(res, e->server, now);
+        e->pending = true;
+        e->queued = true;
+        e->sent_ms = now;
+    }
+    return RESOLVE_PENDING;
+}
+
+void resolver_recv_reply(struct resolver *res, struct packet *pkt) {
+    char name[MAX_DNS_NAME_LENGTH + 1];
+    struct dns_cache_entry *e;
+    uint32_t now = clock_ms();
+    uint32_t ttl;
+    char *answer;
+    int count, pos, n;
+
+    if (pkt->length < PKT_DNS_RECORDS) return;
+    count = (unsigned char) pkt->payload[PKT_DNS_COUNT];
+    request_answered(res, pkt);
+
+    // Answers carry their names, so a reply to any batch will do
+    pos = PKT_DNS_RECORDS;
+    for (int i = 0; i < count && pos + (int) DNS_ANSWER_NAME <= pkt->length; i++) {
+        answer = pkt->payload + pos;
+        n = (unsigned char) answer[DNS_ANSWER_NAME_LENGTH];
+        if (pos + (int) DNS_ANSWER_NAME + n > pkt->length || n > MAX_DNS_NAME_LENGTH) break;
+        memcpy(name, answer + DNS_ANSWER_NAME, n);
+        name[n] = '\0';
+        memcpy(&ttl, answer + DNS_ANSWER_TTL, sizeof(uint32_t));
+        pos += (int) DNS_ANSWER_NAME + n;
+
+        e = cache_find(res, name);
+        if (e == NULL) e = cache_alloc(res, name, now);
+        e->answered = true;
+        e->found = answer[DNS_ANSWER_STATUS] == DNS_FOUND;
+        e->id = (int) (unsigned char) answer[DNS_ANSWER_HOST_ID];
+        e->expires_ms = now + ttl * 1000;
+        e->pending = false;
+        e->queued = false;
+    }
+}
+
+static struct dns_lease *lease_find(struct resolver *res, const char *name) {
+    for (int i = 0; i < RESOLVER_LEASES; i++) {
+        if (res->leases[i].valid && strcmp(res->leases[i].name, name) == 0) return &res->leases[i];
+    }
+    return NULL;
+}
+
+// Hold a name for lease seconds from now, renewing it halfway through
+static void lease_hold(struct resolver *res, const char *name, uint32_t lease, uint32_t now) {
+    struct dns_lease *l = lease_find(res, name);
+
+    for (int i = 0; i < RESOLVER_LEASES && l == NULL; i++) {
+        if (res->leases[i].valid) continue;
+        l = &res->leases[i];
+        memset(l, 0, sizeof(struct dns_lease));
+        l->valid = true;
+        snprintf(l->name, sizeof(l->name), "%s", name);
+    }
+    if (l == NULL) return;      // Not renewed, the server lets it expire
+    l->queued = false;
+    l->sent = false;
+    l->expires_ms = now + lease * 1000;
+    l->renew_ms = now + lease * 500;
+}
+
+static void lease_drop(struct resolver *res, const char *name) {
+    struct dns_lease *l = lease_find(res, name);
+    if (l != NULL) l->valid = false;
+}
+
+// Lease of a registration or renewal reply, after its count statuses; 0 if there is none
+static uint32_t reply_lease(struct packet *pkt, int count) {
+    uint32_t lease = 0;
+
+    if (PKT_DNS_RECORDS + count + (int) sizeof(uint32_t) <= pkt->length) {
+        memcpy(&lease, pkt->payload + PKT_DNS_RECORDS + count, sizeof(uint32_t));
+    }
+    return lease;
+}
+
+static void start_registration(struct resolver *res, const char *names, int type) {
+    const char *p = names;
+    const char *comma;
+    struct dns_reg_entry *r;
+    int len;
+
+    memset(res->reg, 0, sizeof(res->reg));
+    res->reg_count = 0;
+    res->reg_type = type;
+    while (*p != '\0' && res->reg_count < RESOLVER_REG_MAX) {
+        comma = strchr(p, ',');
+        len = comma != NULL ? (int) (comma - p) : (int) strlen(p);
+        if (len > 0) {
+            r = &res->reg[res->reg_count++];
+            if (len > MAX_DNS_NAME_LENGTH) len = MAX_DNS_NAME_LENGTH;
+            memcpy(r->name, p, len);
+            r->name[len] = '\0';
+
+            // Too long to ever be answered, the server would say so too
+            if (len > DNS_NAME_MAX) {
+                r->status = DNS_REG_TOO_LONG;
+            } else {
+                r->queued = true;
+            }
+        }
+        if (comma == NULL) break;
+        p = comma + 1;
+    }
+}
+
+void resolver_register(struct resolver *res, const char *names) {
+    start_registration(res, names, PKT_DNS_REGISTER);
+}
+
+void resolver_unregister(struct resolver *res, const char *names) {
+    start_registration(res, names, PKT_DNS_UNREGISTER);
+}
+
+bool resolver_register_done(struct resolver *res) {
+    uint32_t now = clock_ms();
+    bool done = true;
+
+    for (int i = 0; i < res->reg_count; i++) {
+        struct dns_reg_entry *r = &res->reg[i];
+        if (r->status != 0) continue;
+        done = false;
+        if (!r->queued && now - r->sent_ms >= RESOLVER_RETRY_MS) {
+            server_timed_out(res, r->server, now);
+            r->queued = true;
+        }
+    }
+    return done;
+}
+
+void resolver_recv_register(struct resolver *res, struct packet *pkt) {
+    bool unregister = pkt->type == (char) PKT_DNS_UNREGISTER_REPLY;
+    uint32_t now = clock_ms();
+    uint32_t lease;
+    uint16_t req_id;
+    int count, k = 0;
+
+    if (pkt->length < PKT_DNS_RECORDS) return;
+    if (unregister != (res->reg_type == PKT_DNS_UNREGISTER)) return;     // Reply to an earlier request
+    memcpy(&req_id, pkt->payload + PKT_DNS_REQ_ID, sizeof(uint16_t));
+    count = (unsigned char) pkt->payload[PKT_DNS_COUNT];
+    if (PKT_DNS_RECORDS + count > pkt->length) return;
+    lease = reply_lease(pkt, count);
+    request_answered(res, pkt);
+
+    // Statuses come back in the order the names were sent in that request
+    for (int i = 0; i < res->reg_count && k < count; i++) {
+        struct dns_reg_entry *r = &res->reg[i];
+        if (!r->sent || r->queued || r->req_id != req_id) continue;
+        if (r->status == 0) {
+            r->status = pkt->payload[PKT_DNS_RECORDS + k];
+            if (unregister) {
+                lease_drop(res, r->name);
+            } else if (r->status == DNS_REG_OK && lease > 0) {
+                lease_hold(res, r->name, lease, now);
+            }
+        }
+        k++;
+    }
+}
+
+void resolver_recv_renew(struct resolver *res, struct packet *pkt) {
+    uint32_t now = clock_ms();
+    uint32_t lease;
+    uint16_t req_id;
+    int count, k = 0;
+
+    if (pkt->length < PKT_DNS_RECORDS) return;
+    memcpy(&req_id, pkt->payload + PKT_DNS_REQ_ID, sizeof(uint16_t));
+    count = (unsigned char) pkt->payload[PKT_DNS_COUNT];
+    if (PKT_DNS_RECORDS + count > pkt->length) return;
+    lease = reply_lease(pkt, count);
+    request_answered(res, pkt);
+
+    // Statuses in the order the leases were sent in; a name the server does not have for us is gone
+    for (int i = 0; i < RESOLVER_LEASES && k < count; i++) {
+        struct dns_lease *l = &res->leases[i];
+        if (!l->valid || !l->sent || l->req_id != req_id) continue;
+        if (pkt->payload[PKT_DNS_RECORDS + k] == DNS_REG_OK && lease > 0) {
+            lease_hold(res, l->name, lease, now);
+        } else {
+            l->valid = false;
+        }
+        k++;
+    }
+}
+
+void resolver_flush(struct resolver *res) {
+    struct packet *pkt = NULL;
+    uint32_t now = clock_ms();
+
+    for (int i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+        struct dns_cache_entry *e = &res->cache[i];
+        if (!e->valid || !e->queued) continue;
+        if (pkt == NULL) pkt = batch_start(res, PKT_DNS_LOOKUP);
+        if (!batch_add(pkt, e->name)) {
+            batch_send(res, pkt);
+            pkt = batch_start(res, PKT_DNS_LOOKUP);
+            batch_add(pkt, e->name);
+        }
+        e->queued = false;
+        e->sent_ms = now;
+        e->server = (int) (unsigned char) pkt->dst;
+    }
+    if (pkt != NULL) batch_send(res, pkt);
+
+    pkt = NULL;
+    for (int i = 0; i < res->reg_count; i++) {
+        struct dns_reg_entry *r = &res->reg[i];
+        if (!r->queued) continue;
+        if (pkt == NULL) pkt = batch_start(res, res->reg_type);
+        if (!batch_add(pkt, r->name)) {
+            batch_send(res, pkt);
+            pkt = batch_start(res, res->reg_type);
+            batch_add(pkt, r->name);
+        }
+        memcpy(&r->req_id, pkt->payload + PKT_DNS_REQ_ID, sizeof(uint16_t));
+        r->queued = false;
+        r->sent = true;
+        r->sent_ms = now;
+        r->server = (int) (unsigned char) pkt->dst;
+    }
+    if (pkt != NULL) batch_send(res, pkt);
+
+    // Renew the names held once half their lease is gone, and again if no reply came
+    pkt = NULL;
+    for (int i = 0; i < RESOLVER_LEASES; i++) {
+        struct dns_lease *l = &res->leases[i];
+        if (!l->valid) continue;
+        if ((int32_t) (now - l->expires_ms) >= 0) {
+            l->valid = false;       // Too late, the server has dropped it
+            continue;
+        }
+        if (l->sent && now - l->sent_ms >= RESOLVER_RETRY_MS) {
+            server_timed_out(res, l->server, now);
+            l->queued = true;
+        } else if (!l->sent && (int32_t) (now - l->renew_ms) >= 0) {
+            l->queued = true;
+        }
+        if (!l->queued) continue;
+        if (pkt == NULL) pkt = batch_start(res, PKT_DNS_RENEW);
+        if (!batch_add(pkt, l->name)) {
+            batch_send(res, pkt);
+            pkt = batch_start(res, PKT_DNS_RENEW);
+            batch_add(pkt, l->name);
+        }
+        memcpy(&l->req_id, pkt->payload + PKT_DNS_REQ_ID, sizeof(uint16_t));
+        l->queued = false;
+        l->sent = true;
+        l->sent_ms = now;
+        l->server = (int) (unsigned char) pkt->dst;
+    }
+    if (pkt != NULL) batch_send(res, pkt);
+}
+
+static void send_match_query(struct resolver *res) {
+    struct packet *pkt = (struct packet *) calloc(1, sizeof(struct packet));
+    struct host_job *job = (struct host_job *) malloc(sizeof(struct host_job));
+    int n;
+
+    pkt->src = (char) res->host_id;
+    pkt->dst = (char) res->match.server;
+    pkt->type = (char) PKT_DNS_QUERY;
+    memcpy(pkt->payload + PKT_DNS_QUERY_SKIP, &res->match.skip, sizeof(uint16_t));
+    n = snprintf(pkt->payload + PKT_DNS_QUERY_PATTERN, PAYLOAD_MAX - PKT_DNS_QUERY_PATTERN, "%s",
+                 res->match.pattern);
+    if (n > (int) (PAYLOAD_MAX - PKT_DNS_QUERY_PATTERN - 1)) n = (int) (PAYLOAD_MAX - PKT_DNS_QUERY_PATTERN - 1);
+    pkt->length = (int) PKT_DNS_QUERY_PATTERN + n;
+
+    job->type = JOB_SEND_PKT;
+    job->packet = pkt;
+    job_q_add(res->job_q, job);
+    res->match.sent_ms = clock_ms();
+    res->queries++;
+}
+
+void resolver_match_start(struct resolver *res, const char *pattern) {
+    memset(&res->match, 0, sizeof(struct dns_match));
+    res->match.active = true;
+    snprintf(res->match.pattern, sizeof(res->match.pattern), "%s", pattern);
+    res->match.server = pick_server(res);     // Every page from the same server
+    send_match_query(res);
+}
+
+bool resolver_match_done(struct resolver *res) {
+    uint32_t now = clock_ms();
+
+    if (res->match.done) return true;
+    if (res->match.active && now - res->match.sent_ms >= RESOLVER_RETRY_MS) {
+        server_timed_out(res, res->match.server, now);
+        res->match.server = pick_server(res);
+        send_match_query(res);
+    }
+    return false;
+}
+
+void resolver_recv_match(struct resolver *res, struct packet *pkt) {
+    struct dns_match *m = &res->match;
+    struct dns_cache_entry *e;
+    char name[MAX_DNS_NAME_LENGTH + 1];
+    uint32_t now = clock_ms();
+    uint32_t ttl;
+    uint16_t skip;
+    int count, pos, id, len, n;
+
+    if (!m->active || m->done || pkt->length < (int) PKT_DNS_MATCH_LIST) return;
+    memcpy(&skip, pkt->payload + PKT_DNS_MATCH_SKIP, sizeof(uint16_t));
+    if (skip != m->skip) return;    // Reply to an older page
+    if (pkt->src == (char) m->server) server_answered(res, m->server, m->sent_ms, now);
+    memcpy(&ttl, pkt->payload + PKT_DNS_MATCH_TTL, sizeof(uint32_t));
+    count = (unsigned char) pkt->payload[PKT_DNS_MATCH_COUNT];
+
+    pos = (int) PKT_DNS_MATCH_LIST;
+    for (int i = 0; i < count && pos + 2 <= pkt->length; i++) {
+        id = (unsigned char) pkt->payload[pos];
+        len = (unsigned char) pkt->payload[pos + 1];
+        if (pos + 2 + len > pkt->length || len > MAX_DNS_NAME_LENGTH) break;
+        memcpy(name, pkt->payload + pos + 2, len);
+        name[len] = '\0';
+        pos += 2 + len;
+
+        // Whoever asked for the pattern is likely to look these up next
+        e = cache_find(res, name);
+        if (e == NULL) e = cache_alloc(res, name, now);
+        e->answered = true;
+        e->found = true;
+        e->id = id;
+        e->expires_ms = now + ttl * 1000;
+        e->pending = false;
+
+        n = snprintf(m->text + m->text_len, RESOLVER_MATCH_TEXT - m->text_len, "%s is at %d\n", name, id);
+        if (n >= RESOLVER_MATCH_TEXT - m->text_len) {
+            m->text[m->text_len] = '\0';
+            m->truncated = true;
+            m->done = true;
+            return;
+        }
+        m->text_len += n;
+    }
+
+    m->skip += (uint16_t) count;
+    if (pkt->payload[PKT_DNS_MATCH_MORE] && count > 0) {
+        send_match_query(res);
+    } else {
+        m->done = true;
+    }
+}
+
+int resolver_report(struct resolver *res, char *buf, int size) {
+    uint32_t now = clock_ms();
+    int cached = 0;
+    int n;
+
+    for (int i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+        struct dns_cache_entry *e = &res->cache[i];
+        if (e->valid && e->answered && (int32_t) (e->expires_ms - now) > 0) cached++;
+    }
+    n = snprintf(buf, size, "    DNS cache: %d names, %u lookups answered, %u names asked for in %u packets\n",
+                 cached, res->lookups, res->names, res->queries);
+    if (n >= size) return size - 1;
+    for (int i = 0; i < RESOLVER_LEASES && n < size; i++) {
+        struct dns_lease *l = &res->leases[i];
+        if (!l->valid) continue;
+        n += snprintf(buf + n, size - n, "    DNS name held: %s, lease ends in %d s\n", l->name,
+                      (int32_t) (l->expires_ms - now) / 1000);
+    }
+    if (n >= size) return size - 1;
+    n += snprintf(buf + n, size - n, "    DNS servers (%s first):\n",
+                  res->policy == RESOLVER_NEAREST ? "nearest" : "least loaded");
+    for (int i = 0; i < res->num_servers && n < size; i++) {
+        struct dns_server *s = &res->servers[i];
+        n += snprintf(buf + n, size - n, "      %d: %s, %u requests/s, cpu %u.%u%%, reply time %u ms%s\n", s->id,
+                      server_up(s, now) ? "up" : "down", s->load, s->cpu / 10, s->cpu % 10, s->srtt,
+                      s->timed ? "" : " (not timed)");
+    }
+    return n < size ? n : size - 1;
+}
+
+void resolver_recv_beacon(struct resolver *res, struct packet *pkt) {
+    struct dns_server *s = find_server(res, (int) (unsigned char) pkt->src);
+
+    if (s == NULL || pkt->length < PKT_DNS_BEACON_LENGTH) return;
+    memcpy(&s->load, pkt->payload + PKT_DNS_BEACON_LOAD, sizeof(uint32_t));
+    memcpy(&s->cpu, pkt->payload + PKT_DNS_BEACON_CPU, sizeof(uint32_t));
+    s->beacon_ms = clock_ms();
+    s->sent = 0;
+}
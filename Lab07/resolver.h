@@ -0,0 +1,194 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file resolver.h
+/// @version 1.0
+///
+/// Per host cache of DNS lookups. Answers are kept for the ttl the server
+/// gave them, names that are not registered included. Only one query per
+/// name is outstanding at a time; every job waiting on that name polls
+/// resolver_lookup() and picks up the same reply.
+///
+/// Lookups and registrations are not sent right away. resolver_flush(),
+/// called once per pass of the host loop, packs every name queued since
+/// the last pass into as few packets as they fit in.
+///
+/// Names this host registered are held for the lease the server gave
+/// them. resolver_flush() renews each at half its lease, so it does not
+/// expire while the host is up; a name the server no longer has for the
+/// host is dropped.
+///
+/// Pattern queries list the registered names matching "*.rack1.dc" and
+/// the like, one PKT_DNS_QUERY per reply's worth of matches.
+///
+/// Every packet goes to one of the DNS servers, picked by policy: the
+/// nearest (lowest smoothed reply time; servers not yet timed are tried
+/// first) or the least loaded (by the requests per second in its
+/// beacon). A server that lets a request time out, or whose beacons
+/// stop, is skipped for a while.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_RESOLVER_H
+#define NETWORK_SIMULATOR_02_RESOLVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "main.h"
+#include "host.h"
+
+#define RESOLVER_CACHE_SIZE     64
+#define RESOLVER_RETRY_MS       500     /* Send the query again if nothing came back */
+#define RESOLVER_MATCH_TEXT     900     /* Room for the answer to a pattern query */
+#define RESOLVER_REG_MAX        16      /* Names in one registration */
+#define RESOLVER_MAX_SERVERS    16
+#define RESOLVER_DOWN_MS        3000    /* A server that timed out is skipped this long */
+#define RESOLVER_SILENT_MS      3500    /* A server whose beacons stopped this long ago is down */
+#define RESOLVER_REQUESTS       32      /* Requests timed at once */
+#define RESOLVER_LEASES         32      /* Names held at once */
+
+enum resolver_policy {
+    RESOLVER_NEAREST,
+    RESOLVER_LEAST_LOADED
+};
+
+struct dns_server {
+    int id;
+    uint32_t load;      // Requests per second in its last beacon
+    uint32_t cpu;       // Its CPU use then, tenths of a percent of one core
+    uint32_t beacon_ms; // 0 until a beacon is heard
+    uint32_t sent;      // Packets sent to it since that beacon
+    bool timed;         // srtt holds a measurement
+    uint32_t srtt;      // Smoothed reply time in ms
+    uint32_t down_until;
+};
+
+// A packet sent, kept to time its reply
+struct dns_request {
+    bool active;
+    uint16_t req_id;
+    int server;
+    uint32_t sent_ms;
+};
+
+enum resolve_status {
+    RESOLVE_FOUND,
+    RESOLVE_NOT_FOUND,
+    RESOLVE_PENDING
+};
+
+struct dns_cache_entry {
+    bool valid;
+    bool answered;      // found/id/expires_ms hold a reply
+    bool found;
+    int id;
+    uint32_t expires_ms;
+    bool queued;        // Waiting for resolver_flush() to send it
+    bool pending;       // A query is on its way to the server
+    uint32_t sent_ms;
+    int server;         // It went to
+    uint32_t used_ms;
+    char name[MAX_DNS_NAME_LENGTH + 1];
+};
+
+// A pattern query, which may take several replies
+struct dns_match {
+    bool active;
+    bool done;
+    char pattern[MAX_DNS_NAME_LENGTH + 1];
+    uint16_t skip;      // Matches received so far
+    bool truncated;     // More matches than fit in text
+    uint32_t sent_ms;
+    int server;
+    char text[RESOLVER_MATCH_TEXT];
+    int text_len;
+};
+
+// One name of a registration
+struct dns_reg_entry {
+    bool queued;
+    bool sent;
+    char status;        // DNS_REG_ status, 0 until the server answers
+    uint16_t req_id;    // Request the name was last sent in
+    uint32_t sent_ms;
+    int server;
+    char name[MAX_DNS_NAME_LENGTH + 1];
+};
+
+// A name this host holds
+struct dns_lease {
+    bool valid;
+    bool queued;        // Renewal waiting for resolver_flush() to send it
+    bool sent;          // Renewal on its way to the server
+    uint16_t req_id;
+    uint32_t sent_ms;
+    int server;
+    uint32_t renew_ms;
+    uint32_t expires_ms;
+    char name[MAX_DNS_NAME_LENGTH + 1];
+};
+
+struct resolver {
+    int host_id;
+    struct job_queue *job_q;
+    struct dns_cache_entry cache[RESOLVER_CACHE_SIZE];
+    struct dns_match match;
+    struct dns_reg_entry reg[RESOLVER_REG_MAX];
+    int reg_count;
+    int reg_type;       // PKT_DNS_REGISTER or PKT_DNS_UNREGISTER
+    struct dns_lease leases[RESOLVER_LEASES];
+    struct dns_server servers[RESOLVER_MAX_SERVERS];
+    int num_servers;
+    enum resolver_policy policy;
+    struct dns_request requests[RESOLVER_REQUESTS];
+    uint16_t next_req_id;
+    uint32_t queries;   // Lookup and query packets sent
+    uint32_t names;     // Names asked for in those packets
+    uint32_t lookups;   // Lookups answered, from the cache or a reply
+};
+
+void resolver_init(struct resolver *res, int host_id, struct job_queue *job_q);
+
+// Look a name up in the cache, asking the server if the answer is missing or stale
+enum resolve_status resolver_lookup(struct resolver *res, const char *name, int *id);
+
+// Handler for PKT_DNS_LOOKUP_REPLY
+void resolver_recv_reply(struct resolver *res, struct packet *pkt);
+
+// Register a comma separated list of names, replacing any registration still running
+void resolver_register(struct resolver *res, const char *names);
+
+// The same to give names up, the statuses go to res->reg just the same
+void resolver_unregister(struct resolver *res, const char *names);
+
+// True once every name in res->reg has a status, resends the ones whose reply is overdue
+bool resolver_register_done(struct resolver *res);
+
+// Handler for PKT_DNS_REGISTER_REPLY and PKT_DNS_UNREGISTER_REPLY
+void resolver_recv_register(struct resolver *res, struct packet *pkt);
+
+// Handler for PKT_DNS_RENEW_REPLY
+void resolver_recv_renew(struct resolver *res, struct packet *pkt);
+
+// Send the lookups and registrations queued since the last call, and the renewals due
+void resolver_flush(struct resolver *res);
+
+// Handler for PKT_DNS_BEACON
+void resolver_recv_beacon(struct resolver *res, struct packet *pkt);
+
+// Start a pattern query, e.g. "*.rack1.dc", replacing any that is still running
+void resolver_match_start(struct resolver *res, const char *pattern);
+
+// True once every match is in res->match.text, resends the query if its reply is overdue
+bool resolver_match_done(struct resolver *res);
+
+// Handler for PKT_DNS_QUERY_REPLY, the matches are also cached
+void resolver_recv_match(struct resolver *res, struct packet *pkt);
+
+// The number of cached names and queries sent, the names held, and a line per server, returns the length written
+int resolver_report(struct resolver *res, char *buf, int size);
+
+#endif //NETWORK_SIMULATOR_02_RESOLVER_H
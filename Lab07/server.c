@@ -13,33 +13,30 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
-#include <ctype.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
 
 #include "server.h"
+#include "service.h"
 #include "packet.h"
 #include "net.h"
-
-#define NAME_TABLE_SIZE 256
-
-typedef enum {
-    SUCCESS,
-    NAME_TOO_LONG,
-    INVALID_NAME,
-    ALREADY_REGISTERED
-} RegisterAttempt;
+#include "man.h"
+#include "clock.h"
+#include "ports.h"
+#include "metrics.h"
+#include "trace.h"
 
 typedef enum {
-    JOB_SEND_PKT_ALL_PORTS,
-    JOB_PING_SEND_REPLY,
-    JOB_REGISTER_NEW_DOMAIN,
-    JOB_DNS_PING_REQ,
+    JOB_SEND_PKT,
+    JOB_SERVICE_PKT,
 } ServerJobType;
 
 struct server_job {
     ServerJobType type;
     struct packet *packet;
-    int in_port_index;
-    int out_port_index;
+    int service;                    // Index of the service a JOB_SERVICE_PKT goes to
+    uint64_t queued_us;
     struct server_job *next;
 };
 
@@ -50,13 +47,14 @@ typedef struct {
 } ServerJobQueue;
 
 void server_add_job_queue(ServerJobQueue *job_q, struct server_job *job) {
+    job->next = NULL;
+    job->queued_us = clock_us();
     if (job_q->head == NULL) {
         job_q->head = job;
         job_q->tail = job;
         job_q->occ = 1;
     } else {
         job_q->tail->next = job;
-        job->next = NULL;
         job_q->tail = job;
         job_q->occ++;
     }
@@ -68,6 +66,8 @@ struct server_job *server_job_queue_remove(ServerJobQueue *job_q) {
     job = job_q->head;
     job_q->head = (job_q->head)->next;
     job_q->occ--;
+    metrics_observe(&metrics_self()->job_wait_us, clock_us() - job->queued_us);
+    trace_dequeued(job->packet);
     return job;
 }
 
@@ -81,268 +81,286 @@ int server_job_q_num(ServerJobQueue *job_q) {
     return job_q->occ;
 }
 
-void server_main(int server_id) {
-    if (server_id != DNS_SERVER_ID) {
-        fprintf(stderr, "Invalid DNS server ID\n");
-        exit(EXIT_FAILURE);
-    }
-    struct net_port *node_port_list;
-    struct net_port **node_port;
+struct server {
+    int id;
+    struct net_port **port;
+    int num_ports;
+    struct port_table ports;        // Port each node was last heard on
+    ServerJobQueue job_q;
 
-    int node_port_num;
+    const struct service *services[SERVER_MAX_SERVICES];
+    void *state[SERVER_MAX_SERVICES];
+    int num_services;
+    signed char by_type[256];       // Service index per packet type, -1 if none claimed it
 
-    int i, k, n;
-    int dns_host_id_return;
+    // Counts the manager can ask for
+    unsigned long rx;
+    unsigned long tx;
+    unsigned long ignored;          // Not for this node or of a type no service claimed
+    int jobs_peak;                  // Most jobs run in one pass
+};
 
-    size_t control_count = 0;
+int server_id(struct server *srv) {
+    return srv->id;
+}
 
-    struct packet *in_packet;
-    struct packet *new_packet;
+void server_send(struct server *srv, struct packet *pkt) {
+    struct server_job *job = (struct server_job *) malloc(sizeof(struct server_job));
 
-    struct net_port *p;
-    struct server_job *new_job;
-    struct server_job *new_job2;
+    job->type = JOB_SEND_PKT;
+    job->packet = pkt;
+    server_add_job_queue(&srv->job_q, job);
+}
 
-    RegisterAttempt registration_attempt_status;
+struct packet *server_packet(struct server *srv, int dst, int type) {
+    struct packet *pkt = (struct packet *) calloc(1, sizeof(struct packet));
 
-    ServerJobQueue job_q;
+    pkt->src = (char) srv->id;
+    pkt->dst = (char) dst;
+    pkt->type = (char) type;
+    pkt->length = 0;
+    return pkt;
+}
+
+// Start a service and give it its packet types, returns false if it cannot run
+static bool server_add_service(struct server *srv, const struct service *svc) {
+    int i, t;
+    int index = srv->num_services;
+
+    if (index >= SERVER_MAX_SERVICES) return false;
+    for (i = 0; i < SERVICE_MAX_RANGES; i++) {
+        for (t = svc->types[i].first; t != 0 && t <= svc->types[i].last; t++) {
+            if (srv->by_type[t & 0xff] >= 0) {
+                fprintf(stderr, "Server %d: %s and %s both want packet type %d, %s not started\n", srv->id,
+                        srv->services[srv->by_type[t & 0xff]]->name, svc->name, t, svc->name);
+                return false;
+            }
+        }
+    }
+    srv->state[index] = svc->start(srv);
+    if (srv->state[index] == NULL) {
+        fprintf(stderr, "Server %d: cannot start %s\n", srv->id, svc->name);
+        return false;
+    }
+    srv->services[index] = svc;
+    srv->num_services++;
+    for (i = 0; i < SERVICE_MAX_RANGES; i++) {
+        for (t = svc->types[i].first; t != 0 && t <= svc->types[i].last; t++) {
+            srv->by_type[t & 0xff] = (signed char) index;
+        }
+    }
+    return true;
+}
 
-    // Create DNS naming table
-    bool is_registered[NAME_TABLE_SIZE];
-    char name_table[NAME_TABLE_SIZE][MAX_DNS_NAME_LENGTH + 1];
+// State of the server and of each service, for the manager
+static int server_report(struct server *srv, char *buf, int size) {
+    int n, s;
 
-    // Initialize values
-    for (size_t iter = 0; iter < NAME_TABLE_SIZE; iter++) {
-        memset(name_table[iter], 0, MAX_DNS_NAME_LENGTH);
-        is_registered[iter] = false;
+    n = snprintf(buf, size, "Server %d: %d ports, rx %lu tx %lu packets, %lu ignored, at most %d jobs a pass\n",
+                 srv->id, srv->num_ports, srv->rx, srv->tx, srv->ignored, srv->jobs_peak);
+    for (s = 0; s < srv->num_services && n < size - 1; s++) {
+        if (srv->services[s]->report != NULL) n += srv->services[s]->report(srv->state[s], buf + n, size - n);
     }
+    return n < size ? n : size - 1;
+}
 
-    // Create an array node_port to store the network link ports at the host.
-    node_port_list = net_get_port_list(server_id);
+// Port each node was last heard on
+static int ports_report(struct server *srv, uint32_t now, char *buf, int size) {
+    int n = snprintf(buf, size, "Ports of server %d:\n", srv->id);
+    int i;
 
-    // Count the number of network link ports
-    node_port_num = 0;
-    for (p = node_port_list; p != NULL; p = p->next) {
-        node_port_num++;
+    for (i = 0; i < PORTS_MAX_ID && n < size - 1; i++) {
+        if (srv->ports.port[i] < 0) continue;
+        n += snprintf(buf + n, size - n, "  node %d -> port %d, heard %u ms ago\n", i, srv->ports.port[i],
+                      now - srv->ports.heard_ms[i]);
     }
+    return n < size ? n : size - 1;
+}
 
-    // Create memory space for the array
-    node_port = (struct net_port **) malloc(node_port_num * sizeof(struct net_port *));
+// Milliseconds left of a period that started at since
+static int until(uint32_t now, uint32_t since, uint32_t period) {
+    return now - since >= period ? 0 : (int) (period - (now - since));
+}
 
-    /* Load ports into the array */
-    p = node_port_list;
+_Noreturn void server_main(int server_id) {
+    static const struct service *builtin[] = {&dns_service, &echo_service, &kv_service, &store_service};
 
-    for (k = 0; k < node_port_num; k++) {
-        node_port[k] = p;
+    struct net_port *node_port_list;
+    struct net_port *p;
+    struct server srv;
+    struct server_job *new_job;
+    struct packet *in_packet;
+    struct packet *new_packet;
+    const struct service *svc;
+
+    struct pollfd *fds;             // One per link, then one per service, then the manager's
+    int num_fds;
+    struct man_port_at_host *man_port;
+    char man_msg[MAN_MSG_LENGTH];
+    char man_reply_msg[MAN_MSG_LENGTH];
+    char man_cmd;
+    uint32_t man_tag;
+    int jobs;
+    int ready;
+    int timeout;
+    uint32_t control_ms;
+    uint32_t now;
+    int i, k, n, s;
+
+    memset(&srv, 0, sizeof(srv));
+    srv.id = server_id;
+    metrics_set_self(server_id);
+    memset(srv.by_type, -1, sizeof(srv.by_type));
+    server_job_q_init(&srv.job_q);
+    ports_init(&srv.ports);
+
+    // Create an array of the network link ports at the server
+    node_port_list = net_get_port_list(server_id);
+    srv.num_ports = 0;
+    for (p = node_port_list; p != NULL; p = p->next) {
+        srv.num_ports++;
+    }
+    srv.port = (struct net_port **) malloc(srv.num_ports * sizeof(struct net_port *));
+    p = node_port_list;
+    for (k = 0; k < srv.num_ports; k++) {
+        srv.port[k] = p;
         p = p->next;
     }
 
-    // Initialize job queue
-    server_job_q_init(&job_q);
+    for (i = 0; i < (int) (sizeof(builtin) / sizeof(builtin[0])); i++) {
+        server_add_service(&srv, builtin[i]);
+    }
+
+    // Wait on every link at once instead of scanning them in turn, and on what the services wait on
+    man_port = net_get_host_port(server_id);
+    num_fds = srv.num_ports + srv.num_services + 1;
+    fds = (struct pollfd *) malloc(num_fds * sizeof(struct pollfd));
+    for (k = 0; k < srv.num_ports; k++) {
+        fds[k].fd = srv.port[k]->pipe_recv_fd;
+        fds[k].events = POLLIN;
+    }
+    for (s = 0; s < srv.num_services; s++) {
+        svc = srv.services[s];
+        fds[srv.num_ports + s].fd = svc->fd != NULL ? svc->fd(srv.state[s]) : -1;
+        fds[srv.num_ports + s].events = POLLIN;
+    }
+    fds[num_fds - 1].fd = man_port != NULL ? man_port->recv_fd : -1;
+    fds[num_fds - 1].events = POLLIN;
+    control_ms = clock_ms();
 
     while (true) {
+        // Sleep until a packet comes in or the next timer is due
+        now = clock_ms();
+        timeout = until(now, control_ms, SERVER_CONTROL_MS);
+        for (s = 0; s < srv.num_services; s++) {
+            svc = srv.services[s];
+            if (svc->wait_ms == NULL) continue;
+            n = svc->wait_ms(srv.state[s], now);
+            if (n >= 0 && n < timeout) timeout = n;
+        }
+        if (server_job_q_num(&srv.job_q) > 0) timeout = 0;
+        ready = poll(fds, num_fds, timeout);
+        now = clock_ms();
 
-        control_count++;
-        if (control_count >= CONTROL_COUNT_MAX) {
-            control_count = 0;
+        if (now - control_ms >= SERVER_CONTROL_MS) {
+            control_ms = now;
 
             // Create a control packet
-            new_packet = (struct packet *) malloc(sizeof(struct packet));
-            new_packet->src = (char) server_id;
-            new_packet->type = (char) PKT_CONTROL_PKT;
+            new_packet = server_packet(&srv, 10, PKT_CONTROL_PKT);
             new_packet->length = PKT_CONTROL_LENGTH;
             new_packet->payload[PKT_SENDER_TYPE] = 'H';
             new_packet->payload[PKT_SENDER_CHILD] = 'Y';
-            new_packet->dst = (char) 10;
+            server_send(&srv, new_packet);
+        }
 
-            new_job = (struct server_job *) malloc(sizeof(struct server_job));
-            new_job->packet = new_packet;
-            new_job->type = JOB_SEND_PKT_ALL_PORTS;
-            server_add_job_queue(&job_q, new_job);
+        // Answer a query from the manager
+        if (man_port != NULL && get_man_command(man_port, man_msg, &man_cmd, &man_tag) > 0) {
+            switch (man_cmd) {
+                case 's':
+                    n = server_report(&srv, man_reply_msg, MAN_MSG_LENGTH);
+                    break;
+                case 'f':
+                    n = ports_report(&srv, now, man_reply_msg, MAN_MSG_LENGTH);
+                    break;
+                default:
+                    n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Invalid server query %c", man_cmd);
+            }
+            man_reply(man_port, man_tag, man_reply_msg, n);
+        } else if (fds[num_fds - 1].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+            fds[num_fds - 1].fd = -1;   // The manager is gone
         }
 
-        // Get Packets and handle them
-        for (k = 0; k < node_port_num; k++) {
-            in_packet = (struct packet *) malloc(sizeof(struct packet));
-            n = packet_recv(node_port[k], in_packet);
-            if (n > 0 && in_packet->dst == server_id) {
-                // Handle packets
+        // Read the packets waiting on the links poll found ready, each goes to the service of its type
+        for (k = 0; k < srv.num_ports && ready > 0; k++) {
+            if (fds[k].revents == 0) continue;
+            for (i = 0; i < SERVER_READ_MAX; i++) {
+                in_packet = (struct packet *) calloc(1, sizeof(struct packet));
+                if (packet_recv(srv.port[k], in_packet) <= 0) {
+                    free(in_packet);
+                    break;
+                }
+                srv.rx++;
+                ports_learn(&srv.ports, in_packet, k);
+                s = srv.by_type[(unsigned char) in_packet->type];
+                if (in_packet->dst != server_id || in_packet->type == (char) PKT_CONTROL_PKT || s < 0) {
+                    if (in_packet->type != (char) PKT_CONTROL_PKT) srv.ignored++;
+                    free(in_packet);
+                    continue;
+                }
                 new_job = (struct server_job *) malloc(sizeof(struct server_job));
-                new_job->in_port_index = k;
+                new_job->type = JOB_SERVICE_PKT;
                 new_job->packet = in_packet;
-
-                switch (in_packet->type) {
-                    case (char) PKT_PING_REQ: {
-                        new_job->type = JOB_PING_SEND_REPLY;
-                        server_add_job_queue(&job_q, new_job);
-                        break;
-                    }
-                    case (char) PKT_DNS_REGISTER: {
-                        new_job->type = JOB_REGISTER_NEW_DOMAIN;
-                        server_add_job_queue(&job_q, new_job);
-                        break;
-                    }
-                    case (char) PKT_DNS_LOOKUP: {
-                        new_job->type = JOB_DNS_PING_REQ;
-                        server_add_job_queue(&job_q, new_job);
-                        break;
-                    }
-                    case (char) PKT_CONTROL_PKT: {
-                        free(new_job->packet);
-                        free(new_job);
-                        break;
-                    }
-                    default: {
-                        free(in_packet);
-                        free(new_job);
-                        break;
-                    }
-                }
-            } else {
-                free(in_packet);
+                new_job->service = s;
+                server_add_job_queue(&srv.job_q, new_job);
             }
+            // The other end is gone, stop waiting on it
+            if (i == 0 && (fds[k].revents & (POLLHUP | POLLERR | POLLNVAL))) fds[k].fd = -1;
+        }
+
+        for (s = 0; s < srv.num_services; s++) {
+            svc = srv.services[s];
+            if (svc->tick != NULL) svc->tick(srv.state[s], now);
         }
 
-        // Execute job in job queue
-        if (server_job_q_num(&job_q) > 0) {
-            // Get a job from the queue
-            new_job = server_job_queue_remove(&job_q);
+        // Run every job queued, the replies they make included; the depth is what waited for this pass
+        metrics_set(&metrics_self()->queue_depth, (uint64_t) server_job_q_num(&srv.job_q));
+        jobs = 0;
+        while (server_job_q_num(&srv.job_q) > 0) {
+            new_job = server_job_queue_remove(&srv.job_q);
+            jobs++;
 
-            // Process the job
             switch (new_job->type) {
-                case JOB_SEND_PKT_ALL_PORTS: {
-                    for (k = 0; k < node_port_num; k++) {
-                        packet_send(node_port[k], new_job->packet);
-                    }
-                    free(new_job->packet);
-                    free(new_job);
-                    break;
-                }
-                case JOB_PING_SEND_REPLY: {
-                    new_packet = (struct packet *) malloc(sizeof(struct packet));
-                    new_packet->dst = new_job->packet->src;
-                    new_packet->src = (char) server_id;
-                    new_packet->type = PKT_PING_REPLY;
-                    new_packet->length = 0;
-
-                    // Create job to send the reply
-                    new_job2 = (struct server_job *) malloc(sizeof(struct server_job));
-                    new_job2->type = JOB_SEND_PKT_ALL_PORTS;
-                    new_job2->packet = new_packet;
-
-                    // Add new job to queue
-                    server_add_job_queue(&job_q, new_job2);
-
-                    // free old job from memory
-                    free(new_job->packet);
-                    free(new_job);
-                    break;
-                }
-                case JOB_REGISTER_NEW_DOMAIN: {
-                    if (strnlen(new_job->packet->payload, PAYLOAD_MAX) > MAX_DNS_NAME_LENGTH) {
-                        registration_attempt_status = NAME_TOO_LONG;
-                    } else if (is_registered[(int) new_job->packet->src]) {
-                        registration_attempt_status = ALREADY_REGISTERED;
+                case JOB_SEND_PKT: {
+                    // Unicast to a node we have heard from, flood otherwise
+                    k = ports_lookup(&srv.ports, new_job->packet);
+                    if (k >= 0 && k < srv.num_ports) {
+                        packet_send(srv.port[k], new_job->packet);
+                        srv.tx++;
                     } else {
-                        registration_attempt_status = SUCCESS;
-                        for (i = 0; i < PAYLOAD_MAX && i < new_job->packet->length; i++) {
-                            if (!isprint(new_job->packet->payload[i])) {
-                                registration_attempt_status = INVALID_NAME;
-                                break;
-                            }
-                        }
-                    }
-                    // if successful, store name in name_table
-                    if (registration_attempt_status == SUCCESS) {
-                        n = snprintf(name_table[(int) new_job->packet->src], PAYLOAD_MAX, "%s",
-                                     new_job->packet->payload);
-                        name_table[(int) new_job->packet->src][n] = '\0';
-                        is_registered[(int) new_job->packet->src] = true;
-                    }
-
-                    // Create DNS registration reply packet
-                    new_packet = (struct packet *) malloc(sizeof(struct packet));
-                    new_packet->dst = new_job->packet->src;
-                    new_packet->src = (char) server_id;
-                    new_packet->type = PKT_DNS_REGISTER_REPLY;
-                    memset(new_packet->payload, 0, PAYLOAD_MAX);
-
-                    // Create job for DNS reply
-                    new_job2 = (struct server_job *) malloc(sizeof(struct server_job));
-                    new_job2->type = JOB_SEND_PKT_ALL_PORTS;
-                    new_job2->packet = new_packet;
-
-                    switch (registration_attempt_status) {
-                        case SUCCESS: {
-                            new_packet->length = 1;
-                            new_packet->payload[0] = 'S';
-                            break;
-                        }
-                        case NAME_TOO_LONG: {
-                            new_packet->length = 1;
-                            new_packet->payload[0] = 'L';
-                            break;
-                        }
-                        case INVALID_NAME: {
-                            new_packet->length = 1;
-                            new_packet->payload[0] = 'I';
-                            break;
-                        }
-                        case ALREADY_REGISTERED: {
-                            new_packet->length = 1;
-                            new_packet->payload[0] = 'A';
-                            break;
-                        }
-                        default: {
-                            free(new_packet);
-                            free(new_job2);
-                            goto done;
+                        for (k = 0; k < srv.num_ports; k++) {
+                            packet_send(srv.port[k], new_job->packet);
+                            srv.tx++;
                         }
                     }
-                    server_add_job_queue(&job_q, new_job2);
-                    done:
                     free(new_job->packet);
-                    free(new_job);
                     break;
                 }
-                case JOB_DNS_PING_REQ: {
-                    for (i = 0; i < NAME_TABLE_SIZE; i++) {
-                        if (strncmp(new_job->packet->payload, name_table[i], new_job->packet->length) == 0) {
-                            dns_host_id_return = i;
-                            break;
-                        }
-                    }
-
-                    // Create reply packet
-                    new_packet = (struct packet *) malloc(sizeof(struct packet));
-                    new_packet->dst = new_job->packet->src;
-                    new_packet->src = (char) server_id;
-                    new_packet->type = PKT_DNS_LOOKUP_REPLY;
-                    if (dns_host_id_return > NAME_TABLE_SIZE || is_registered[dns_host_id_return] == false) {
-                        new_packet->length = 4;
-                        n = snprintf(new_packet->payload, PAYLOAD_MAX, "FAIL");
-                        new_packet->payload[n] = '\0';
-                    } else {
-                        new_packet->length = 1;
-                        new_packet->payload[0] = (char) dns_host_id_return;
-                    }
-
-                    // Create job for DNS lookup reply
-                    new_job2 = (struct server_job *) malloc(sizeof(struct server_job));
-                    new_job2->type = JOB_SEND_PKT_ALL_PORTS;
-                    new_job2->packet = new_packet;
-
-                    // Add job to queue
-                    server_add_job_queue(&job_q, new_job2);
-                    free(new_job->packet);
-                    free(new_job);
+                case JOB_SERVICE_PKT: {
+                    s = new_job->service;
+                    srv.services[s]->recv(srv.state[s], new_job->packet);
                     break;
                 }
                 default: {
                     free(new_job->packet);
-                    free(new_job);
                 }
             }
+            free(new_job);
+        }
+        if (jobs > srv.jobs_peak) srv.jobs_peak = jobs;
+
+        for (s = 0; s < srv.num_services; s++) {
+            svc = srv.services[s];
+            if (svc->flush != NULL) svc->flush(srv.state[s]);
         }
     }
 }
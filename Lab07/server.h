@@ -13,6 +13,37 @@
 
 #pragma once
 
+#define DNS_TTL             30  /* Seconds a host may cache a lookup */
+#define DNS_NEGATIVE_TTL    5   /* Seconds a host may cache a name that is not registered */
+#define DNS_LEASE           60  /* Seconds a registration lasts unless the host renews it */
+
+// Worker threads answering lookups and registrations, each with its own shard of the names.
+// 0 answers them on the server's own thread. Set with cmake -DDNS_WORKERS=n
+#ifndef DNS_WORKERS
+#define DNS_WORKERS         0
+#endif
+
+#define DNS_BEACON_MS       1000    /* How often a server tells the hosts its load */
+#define SERVER_CONTROL_MS   500     /* Control packets, as often as hosts and switches send them */
+#define SERVER_READ_MAX     64      /* Packets read from one link per wakeup */
+
+// Registrations are kept across restarts in the current directory, by server id
+#define DNS_SNAPSHOT_FILE   "dns_db.%d.snap"
+#define DNS_WAL_FILE        "dns_db.%d.wal"
+#define DNS_WAL_COMPACT     (256 * 1024)    /* Log size that triggers a new snapshot */
+#define DNS_WARM_NAMES      4096            /* Snapshot names put in the trie per pass */
+#define DNS_SWEEP_MS        100             /* How often some expired names are dropped */
+#define DNS_SWEEP_NAMES     1024            /* Records looked at for that, per shard */
+
+// Key-value store, in memory only
+#define KV_MIN_BUCKETS      64
+#define KV_MAX_KEYS         65536
+
+// Files uploaded to a server are kept in this directory, by server id
+#define STORE_DIR           "store.%d"
+#define STORE_TICK_MS       10      /* The file store runs its jobs as often as a host loop does */
+
+// Also answers the manager: s for the state of the server and its services, f the port each node was heard on
 _Noreturn void server_main(int server_id);
 
 #endif //NETWORK_SIMULATOR_02_SERVER_H
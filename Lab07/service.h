@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file service.h
+/// @version 1.0
+///
+/// Services run by a server node ('D' in the network configuration).
+/// The server loop in server.c owns the links: it waits on all of them
+/// with one poll(), reads what arrives and queues each packet for the
+/// service that claimed its type. Jobs are run in order once per pass,
+/// and packets the services send go out through the same queue.
+///
+/// A service is a table of handlers. Besides the packets it is handed,
+/// it says how long the loop may sleep before its tick is due and may
+/// give one more fd to wait on, so every service shares the one loop.
+/// Each claims one or more ranges of packet types, which must not
+/// overlap those of another service.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_SERVICE_H
+#define NETWORK_SIMULATOR_02_SERVICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "main.h"
+
+#define SERVICE_MAX_RANGES  4
+#define SERVER_MAX_SERVICES 8
+
+struct server;
+
+struct service_range {
+    int first;
+    int last;                       // Included
+};
+
+struct service {
+    const char *name;
+    struct service_range types[SERVICE_MAX_RANGES];     // Packet types handled, unused ranges are {0, 0}
+
+    // Returns the service's state, NULL if it cannot run
+    void *(*start)(struct server *srv);
+
+    // A packet of one of its types addressed to this node, the handler frees it
+    void (*recv)(void *state, struct packet *pkt);
+
+    // Called once per pass of the loop, before the jobs are run; may be NULL
+    void (*tick)(void *state, uint32_t now);
+
+    // Called once per pass after every job ran; may be NULL
+    void (*flush)(void *state);
+
+    // Milliseconds until tick has something to do, -1 if it has nothing; may be NULL
+    int (*wait_ms)(void *state, uint32_t now);
+
+    // Another fd for the loop to wait on, -1 if there is none; may be NULL
+    int (*fd)(void *state);
+
+    // Lines about its state for the manager, returns their length; may be NULL
+    int (*report)(void *state, char *buf, int size);
+};
+
+// The services every server node runs
+extern const struct service dns_service;
+extern const struct service echo_service;
+extern const struct service kv_service;
+extern const struct service store_service;
+
+// Id of the node the service runs on
+int server_id(struct server *srv);
+
+// Queue a packet to be sent, unicast if the destination was heard from; the server frees it
+void server_send(struct server *srv, struct packet *pkt);
+
+// A new packet from this node to dst
+struct packet *server_packet(struct server *srv, int dst, int type);
+
+#endif //NETWORK_SIMULATOR_02_SERVICE_H
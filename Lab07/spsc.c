@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file spsc.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+
+#include "spsc.h"
+
+bool spsc_init(struct spsc_ring *ring, uint32_t size) {
+    uint32_t n = 2;
+
+    while (n < size) n *= 2;
+    ring->slots = (void **) calloc(n, sizeof(void *));
+    if (ring->slots == NULL) return false;
+    ring->size = n;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return true;
+}
+
+void spsc_free(struct spsc_ring *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+bool spsc_push(struct spsc_ring *ring, void *item) {
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) >= ring->size) return false;
+    ring->slots[tail & (ring->size - 1)] = item;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+void *spsc_pop(struct spsc_ring *ring) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    void *item;
+
+    if (head == atomic_load_explicit(&ring->tail, memory_order_acquire)) return NULL;
+    item = ring->slots[head & (ring->size - 1)];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return item;
+}
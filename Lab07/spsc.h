@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file spsc.h
+/// @version 1.0
+///
+/// Lock-free ring of pointers between two threads: one only pushes, the
+/// other only pops. Each side owns its index and reads the other's with
+/// acquire, so whatever was written before a push is seen after the pop.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_SPSC_H
+#define NETWORK_SIMULATOR_02_SPSC_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct spsc_ring {
+    atomic_uint head __attribute__((aligned(64)));  // Next slot to pop, moved by the consumer
+    atomic_uint tail __attribute__((aligned(64)));  // Next slot to push, moved by the producer
+    void **slots __attribute__((aligned(64)));
+    uint32_t size;                                  // Power of two
+};
+
+// Returns false if there is no memory for size slots, size is rounded up to a power of two
+bool spsc_init(struct spsc_ring *ring, uint32_t size);
+void spsc_free(struct spsc_ring *ring);
+
+// Returns false if the ring is full
+bool spsc_push(struct spsc_ring *ring, void *item);
+
+// Returns NULL if the ring is empty
+void *spsc_pop(struct spsc_ring *ring);
+
+#endif //NETWORK_SIMULATOR_02_SPSC_H
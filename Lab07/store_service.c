@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file store_service.c
+/// @version 1.0
+///
+/// A file store on a server node. Hosts upload files to it and download
+/// them from it as they would to and from another host: the transfers
+/// are those of transfer.c, run from the server loop. Files are kept in
+/// the directory STORE_DIR of the server.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "service.h"
+#include "server.h"
+#include "host.h"
+#include "transfer.h"
+
+struct store_state {
+    struct server *srv;
+    char dir[MAX_PATH_LENGTH];
+    bool dir_valid;
+    struct job_queue job_q;         // Jobs of the transfers, as a host has them
+    struct transfer_ctx xfer;
+    uint32_t tick_ms;
+};
+
+static void *store_start(struct server *srv) {
+    struct store_state *st = (struct store_state *) calloc(1, sizeof(struct store_state));
+
+    if (st == NULL) return NULL;
+    st->srv = srv;
+    snprintf(st->dir, sizeof(st->dir), STORE_DIR, server_id(srv));
+    st->dir_valid = mkdir(st->dir, 0755) == 0 || errno == EEXIST;
+    if (!st->dir_valid) fprintf(stderr, "Server %d: cannot make %s, files will not be stored\n", server_id(srv), st->dir);
+    job_q_init(&st->job_q);
+    transfer_init(&st->xfer, server_id(srv), st->dir, &st->dir_valid, &st->job_q);
+    return st;
+}
+
+static void store_recv(void *state, struct packet *pkt) {
+    struct store_state *st = (struct store_state *) state;
+    char name[MAX_NAME_LENGTH];
+    uint32_t offset, length;
+    int i;
+
+    switch (pkt->type) {
+        case (char) PKT_FILE_UPLOAD_START: {
+            transfer_recv_start(&st->xfer, pkt);
+            break;
+        }
+        case (char) PKT_FILE_UPLOAD_MIDDLE:
+        case (char) PKT_FILE_UPLOAD_MIDDLE_LZ: {
+            transfer_recv_chunk(&st->xfer, pkt);
+            break;
+        }
+        case (char) PKT_FILE_UPLOAD_END: {
+            transfer_recv_end(&st->xfer, pkt);
+            break;
+        }
+        case (char) PKT_FILE_ACK: {
+            transfer_recv_ack(&st->xfer, pkt);
+            break;
+        }
+        case (char) PKT_FILE_DOWNLOAD_REQ: {
+            // Payload is [offset][length][stripe][stripe count][flags][file name]
+            if (pkt->length < (int) PKT_FILE_REQ_NAME || pkt->length > PAYLOAD_MAX) break;
+            memcpy(&offset, pkt->payload + PKT_FILE_REQ_OFFSET, sizeof(int));
+            memcpy(&length, pkt->payload + PKT_FILE_REQ_LENGTH, sizeof(int));
+            for (i = 0; i + (int) PKT_FILE_REQ_NAME < pkt->length && i < MAX_NAME_LENGTH - 1; i++) {
+                name[i] = pkt->payload[i + PKT_FILE_REQ_NAME];
+            }
+            name[i] = '\0';
+            transfer_start_send(&st->xfer, (int) (unsigned char) pkt->src, name, offset, length,
+                                (int) pkt->payload[PKT_FILE_REQ_STRIPE], (int) pkt->payload[PKT_FILE_REQ_STRIPES],
+                                (int) pkt->payload[PKT_FILE_REQ_FLAGS]);
+            break;
+        }
+        default:
+            break;
+    }
+    free(pkt);
+}
+
+// True while a transfer needs its jobs run or its receive watched
+static bool store_busy(struct store_state *st) {
+    int i;
+
+    if (job_q_num(&st->job_q) > 0) return true;
+    for (i = 0; i < MAX_TRANSFERS; i++) {
+        if (st->xfer.recv[i].active) return true;
+    }
+    return false;
+}
+
+// Each job queued when the tick starts runs once, so a sender puts out one chunk per tick
+static void store_tick(void *state, uint32_t now) {
+    struct store_state *st = (struct store_state *) state;
+    struct host_job *job;
+    int n;
+
+    if (now - st->tick_ms < STORE_TICK_MS) return;
+    st->tick_ms = now;
+
+    for (n = job_q_num(&st->job_q); n > 0; n--) {
+        job = job_q_remove(&st->job_q);
+        switch (job->type) {
+            case JOB_SEND_PKT: {
+                server_send(st->srv, job->packet);
+                free(job);
+                break;
+            }
+            case JOB_FILE_UPLOAD_SEND_CHUNK: {
+                transfer_send_chunk(&st->xfer, job);
+                break;
+            }
+            default: {
+                if (job->packet != NULL) free(job->packet);
+                free(job);
+            }
+        }
+    }
+    transfer_tick(&st->xfer);
+}
+
+static int store_wait_ms(void *state, uint32_t now) {
+    struct store_state *st = (struct store_state *) state;
+
+    if (!store_busy(st)) return -1;
+    return now - st->tick_ms >= STORE_TICK_MS ? 0 : (int) (STORE_TICK_MS - (now - st->tick_ms));
+}
+
+static int store_report(void *state, char *buf, int size) {
+    struct store_state *st = (struct store_state *) state;
+    int n = snprintf(buf, size, "store: %s, %d jobs queued\n", st->dir_valid ? st->dir : "no directory",
+                     job_q_num(&st->job_q));
+
+    if (n >= size) return size - 1;
+    return n + transfer_report(&st->xfer, buf + n, size - n);
+}
+
+const struct service store_service = {
+    .name = "store",
+    .types = {{PKT_FILE_UPLOAD_START, PKT_FILE_DOWNLOAD_REQ},
+              {PKT_FILE_UPLOAD_MIDDLE_LZ, PKT_FILE_ACK}},
+    .start = store_start,
+    .recv = store_recv,
+    .tick = store_tick,
+    .wait_ms = store_wait_ms,
+    .report = store_report,
+};
@@ -14,10 +14,15 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdarg.h>
 
 #include "switch.h"
 #include "net.h"
+#include "man.h"
 #include "packet.h"
+#include "metrics.h"
+#include "trace.h"
+#include "clock.h"
 
 enum switch_job_type {
     JOB_SEND_PKT_ALL_SWITCH_PORTS, JOB_FORWARD_PACKET
@@ -28,6 +33,7 @@ struct switch_job {
     struct packet *packet;
     int in_port_index;
     int out_port_index;
+    uint64_t queued_us;
     struct switch_job *next;
 };
 
@@ -44,13 +50,14 @@ struct LookupTable {
 
 // Add a job to the switch job queue
 void switch_job_q_add(struct switch_job_queue *j_q, struct switch_job *j) {
+    j->next = NULL;
+    j->queued_us = clock_us();
     if (j_q->head == NULL) {
         j_q->head = j;
         j_q->tail = j;
         j_q->occ = 1;
     } else {
         (j_q->tail)->next = j;
-        j->next = NULL;
         j_q->tail = j;
         j_q->occ++;
     }
@@ -63,6 +70,8 @@ struct switch_job *switch_job_q_remove(struct switch_job_queue *j_q) {
     j = j_q->head;
     j_q->head = (j_q->head)->next;
     j_q->occ--;
+    metrics_observe(&metrics_self()->job_wait_us, clock_us() - j->queued_us);
+    trace_dequeued(j->packet);
     return (j);
 }
 
@@ -77,6 +86,49 @@ int switch_job_q_num(struct switch_job_queue *j_q) {
     return j_q->occ;
 }
 
+// Append to a reply to the manager, marking it cut short once it is full
+static int report_add(char *buf, int n, int size, const char *fmt, ...) {
+    va_list args;
+    int k;
+
+    if (n >= size - 4) return n;
+    va_start(args, fmt);
+    k = vsnprintf(buf + n, size - n, fmt, args);
+    va_end(args);
+    if (k >= size - 4 - n) return n + snprintf(buf + n, size - n, "...\n");
+    return n + k;
+}
+
+// Forwarding table, the port each node was learned on
+static int fdb_report(struct LookupTable *table, int switch_id, char *buf, int size) {
+    int n = snprintf(buf, size, "Forwarding table of switch %d:\n", switch_id);
+    int i;
+
+    for (i = 0; i < MAX_LOOKUP_TABLE_SIZE; i++) {
+        if (table->isValid[i]) n = report_add(buf, n, size, "  node %d -> port %d\n", i, table->port_number[i]);
+    }
+    return n;
+}
+
+// Spanning tree role and packet counts of each port
+static int ports_report(int switch_id, int num_ports, int parent, const bool *tree, const unsigned long *rx,
+                        const unsigned long *tx, char *buf, int size) {
+    int n = snprintf(buf, size, "Ports of switch %d:\n", switch_id);
+    int k;
+
+    for (k = 0; k < num_ports; k++) {
+        // A root switch forwards on every port until it hears from the others
+        if (parent == k) {
+            n = report_add(buf, n, size, "  port %d: root, rx %lu tx %lu\n", k, rx[k], tx[k]);
+        } else if (tree[k] || parent == -1) {
+            n = report_add(buf, n, size, "  port %d: forwarding, rx %lu tx %lu\n", k, rx[k], tx[k]);
+        } else {
+            n = report_add(buf, n, size, "  port %d: blocked, rx %lu tx %lu\n", k, rx[k], tx[k]);
+        }
+    }
+    return n;
+}
+
 _Noreturn void switch_main(int switch_id) {
     // State
     struct net_port *node_port_list;
@@ -100,6 +152,17 @@ _Noreturn void switch_main(int switch_id) {
 
     struct switch_job_queue job_q;
 
+    // Queries from the manager
+    struct man_port_at_host *man_port;
+    char man_msg[MAN_MSG_LENGTH];
+    char man_reply_msg[MAN_MSG_LENGTH];
+    char man_cmd;
+    uint32_t man_tag;
+    unsigned long dropped = 0;      // Packets dropped with the queue full
+    int queue_peak = 0;
+
+    man_port = net_get_host_port(switch_id);
+    metrics_set_self(switch_id);
     node_port_list = net_get_port_list(switch_id);
 
     // Count the number of network link ports
@@ -112,6 +175,8 @@ _Noreturn void switch_main(int switch_id) {
     node_port = (struct net_port **) malloc(node_port_num * sizeof(struct net_port *));
 
     bool local_port_tree[node_port_num];
+    unsigned long rx_count[node_port_num];
+    unsigned long tx_count[node_port_num];
 
     // Load ports into the array
     p = node_port_list;
@@ -119,6 +184,8 @@ _Noreturn void switch_main(int switch_id) {
         node_port[k] = p;
         p = p->next;
         local_port_tree[k] = false;
+        rx_count[k] = 0;
+        tx_count[k] = 0;
     }
 
     // Initialize the lookup table
@@ -131,14 +198,41 @@ _Noreturn void switch_main(int switch_id) {
     switch_job_q_init(&job_q);
 
     while (true) {
-        // No need to get commands from the manager
+        // Answer a query from the manager
+        if (get_man_command(man_port, man_msg, &man_cmd, &man_tag) > 0) {
+            switch (man_cmd) {
+                case 's':
+                    n = snprintf(man_reply_msg, MAN_MSG_LENGTH,
+                                 "Switch %d: root %d, distance %d, parent port %d\n"
+                                 "Queue %d of %d, peak %d, dropped %lu\n", switch_id, local_root_id,
+                                 local_root_dist, local_parent, switch_job_q_num(&job_q), SWITCH_QUEUE_MAX,
+                                 queue_peak, dropped);
+                    if (trace_on) {
+                        n = report_add(man_reply_msg, n, MAN_MSG_LENGTH,
+                                       "Traced packets p99: queue under %llu us, forward under %llu us\n",
+                                       (unsigned long long) metrics_quantile(&metrics_self()->hop_queue_us, 0.99),
+                                       (unsigned long long) metrics_quantile(&metrics_self()->hop_forward_us, 0.99));
+                    }
+                    break;
+                case 'f':
+                    n = fdb_report(&table, switch_id, man_reply_msg, MAN_MSG_LENGTH);
+                    break;
+                case 't':
+                    n = ports_report(switch_id, node_port_num, local_parent, local_port_tree, rx_count, tx_count,
+                                     man_reply_msg, MAN_MSG_LENGTH);
+                    break;
+                default:
+                    n = snprintf(man_reply_msg, MAN_MSG_LENGTH, "Invalid switch query %c", man_cmd);
+            }
+            man_reply(man_port, man_tag, man_reply_msg, n);
+        }
 
         // Handle sending control packets
         control_count++;
         if (control_count >= CONTROL_COUNT_MAX) {
             control_count = 0;
             // Create a control packet to send
-            new_packet = (struct packet *) malloc(sizeof(struct packet));
+            new_packet = (struct packet *) calloc(1, sizeof(struct packet));
             new_packet->src = (char) switch_id;
             new_packet->type = (char) PKT_CONTROL_PKT;
             new_packet->length = PKT_CONTROL_LENGTH;
@@ -156,21 +250,47 @@ _Noreturn void switch_main(int switch_id) {
 
         // Scan all ports
         for (k = 0; k < node_port_num; k++) {
-            in_packet = (struct packet *) malloc(sizeof(struct packet));
+            in_packet = (struct packet *) calloc(1, sizeof(struct packet));
             n = packet_recv(node_port[k], in_packet);
 
             if (n > 0) {    // If n > 0 there is a packet to process
+                rx_count[k]++;
                 switch (in_packet->type) {
                     case (char) PKT_PING_REQ:
                     case (char) PKT_PING_REPLY:
                     case (char) PKT_FILE_UPLOAD_START:
                     case (char) PKT_FILE_UPLOAD_MIDDLE:
+                    case (char) PKT_FILE_UPLOAD_MIDDLE_LZ:
                     case (char) PKT_FILE_UPLOAD_END:
+                    case (char) PKT_FILE_ACK:
                     case (char) PKT_FILE_DOWNLOAD_REQ:
                     case (char) PKT_DNS_REGISTER:
                     case (char) PKT_DNS_REGISTER_REPLY:
                     case (char) PKT_DNS_LOOKUP:
-                    case (char) PKT_DNS_LOOKUP_REPLY: {
+                    case (char) PKT_DNS_LOOKUP_REPLY:
+                    case (char) PKT_DNS_QUERY:
+                    case (char) PKT_DNS_QUERY_REPLY:
+                    case (char) PKT_DNS_BEACON:
+                    case (char) PKT_DNS_REPLICATE:
+                    case (char) PKT_DNS_REPLICATE_ACK:
+                    case (char) PKT_DNS_UNREGISTER:
+                    case (char) PKT_DNS_UNREGISTER_REPLY:
+                    case (char) PKT_DNS_RENEW:
+                    case (char) PKT_DNS_RENEW_REPLY:
+                    case (char) PKT_ECHO_REQ:
+                    case (char) PKT_ECHO_REPLY:
+                    case (char) PKT_KV_PUT:
+                    case (char) PKT_KV_GET:
+                    case (char) PKT_KV_DELETE:
+                    case (char) PKT_KV_REPLY:
+                    case (char) PKT_TRAFFIC: {
+                        // Queue is full, drop the packet so senders see the loss and back off
+                        if (switch_job_q_num(&job_q) >= SWITCH_QUEUE_MAX) {
+                            dropped++;
+                            metrics_add(&metrics_self()->drops, 1);
+                            free(in_packet);
+                            break;
+                        }
                         new_job = (struct switch_job *) malloc(sizeof(struct switch_job));
                         new_job->in_port_index = k;
                         new_job->packet = in_packet;
@@ -193,6 +313,7 @@ _Noreturn void switch_main(int switch_id) {
 
                         // Add the job to the queue
                         switch_job_q_add(&job_q, new_job);
+                        if (switch_job_q_num(&job_q) > queue_peak) queue_peak = switch_job_q_num(&job_q);
                         break;
                     }
                     case (char) PKT_CONTROL_PKT: {
@@ -255,10 +376,12 @@ _Noreturn void switch_main(int switch_id) {
                                 new_job->packet->payload[PKT_SENDER_CHILD] = 'N';
                             }
                             packet_send(node_port[k], new_job->packet);
+                            tx_count[k]++;
                         } else {
                             if (local_port_tree[k] == true || local_parent == -1) {
                                 if (k != new_job->in_port_index) {
                                     packet_send(node_port[k], new_job->packet);
+                                    tx_count[k]++;
                                 }
                             }
                         }
@@ -269,6 +392,7 @@ _Noreturn void switch_main(int switch_id) {
                 }
                 case JOB_FORWARD_PACKET: {
                     packet_send(node_port[new_job->out_port_index], new_job->packet);
+                    tx_count[new_job->out_port_index]++;
                     free(new_job->packet);
                     free(new_job);
                     break;
@@ -280,6 +404,8 @@ _Noreturn void switch_main(int switch_id) {
             }
         }
 
+        metrics_set(&metrics_self()->queue_depth, switch_job_q_num(&job_q));
+
         // Go to sleep for 10 ms
         usleep(TENMILLISEC);
     }
@@ -12,7 +12,9 @@
 #define NETWORK_SIMULATOR_02_SWITCH_H
 
 #define MAX_LOOKUP_TABLE_SIZE 256
+#define SWITCH_QUEUE_MAX 64     /* Packets waiting to be forwarded before new ones are dropped */
 
+// Also answers the manager: s for its state, f its forwarding table, t its ports in the spanning tree
 _Noreturn void switch_main(int switch_id);
 
 #endif //NETWORK_SIMULATOR_02_SWITCH_H
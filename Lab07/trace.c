@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file trace.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#include "trace.h"
+#include "clock.h"
+#include "metrics.h"
+
+#define TRACE_SEQ_MASK  0xffffff
+
+bool trace_on = false;
+
+static uint32_t g_seq = 0;      // Of the last packet this node started
+
+void trace_dequeued(struct packet *p) {
+    if (p == NULL || p->trace.ingress_us == 0) return;
+    p->trace.dequeued_us = clock_us();
+    metrics_observe(&metrics_self()->hop_queue_us, p->trace.dequeued_us - p->trace.ingress_us);
+}
+
+int trace_put(int node, struct packet *p, char *trailer) {
+    uint64_t now = clock_us();
+    uint64_t since;
+
+    if (p->trace.id == 0) {
+        g_seq = (g_seq + 1) & TRACE_SEQ_MASK;
+        if (g_seq == 0) g_seq = 1;
+        p->trace.id = ((uint32_t) (node & 0xff) << 24) | g_seq;
+    } else if (p->trace.ingress_us != 0 && !p->trace.forwarded) {
+        since = p->trace.dequeued_us != 0 ? p->trace.dequeued_us : p->trace.ingress_us;
+        metrics_observe(&metrics_self()->hop_forward_us, now - since);
+        p->trace.forwarded = true;
+    }
+    memcpy(trailer, &p->trace.id, 4);
+    memcpy(trailer + 4, &p->trace.ingress_us, 8);
+    memcpy(trailer + 12, &now, 8);
+    return TRACE_BYTES;
+}
+
+void trace_get(struct packet *p, const char *trailer) {
+    memcpy(&p->trace.id, trailer, 4);
+    p->trace.ingress_us = clock_us();
+    p->trace.dequeued_us = 0;
+    p->trace.forwarded = false;
+}
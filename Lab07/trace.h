@@ -0,0 +1,48 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file trace.h
+/// @version 1.0
+///
+/// Tracing of packets hop by hop. With it on, every packet a node sends
+/// carries a trace after its payload, and PKT_TRACED is set in its type
+/// byte on the pipe:
+///
+///     bytes 0-3   packet id, the node it started at in the top byte
+///     bytes 4-11  when it arrived at the sending node, in us (0 at the first hop)
+///     bytes 12-19 when the sending node sent it, in us
+///
+/// The nodes share one clock, so these compare across nodes. A capture
+/// (capture.h) then shows each packet at every hop with both times.
+///
+/// Each node also keeps two histograms in its metrics: how long traced
+/// packets waited in its job queue, from arrival to being taken out, and
+/// how long it took from there to send them (to the first port, for one
+/// that is flooded).
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_TRACE_H
+#define NETWORK_SIMULATOR_02_TRACE_H
+
+#include <stdbool.h>
+
+#include "main.h"
+
+#define PKT_TRACED      0x80    /* Bit of the type byte on the pipe, types are below it */
+#define TRACE_BYTES     20      /* After the payload */
+
+extern bool trace_on;           // Set before the nodes are forked
+
+// A received packet was taken from the job queue to be handled
+void trace_dequeued(struct packet *p);
+
+// Write the trace of a packet node is sending into trailer, giving it an id if it has none; returns its length
+int trace_put(int node, struct packet *p, char *trailer);
+
+// Read the trace of a packet that just arrived
+void trace_get(struct packet *p, const char *trailer);
+
+#endif //NETWORK_SIMULATOR_02_TRACE_H
@@ -0,0 +1,256 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file traffic.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "traffic.h"
+#include "net.h"
+#include "man.h"
+#include "clock.h"
+#include "metrics.h"
+
+static const char *pattern_names[] = {"cbr", "poisson", "onoff", "shuffle"};
+
+// splitmix64, to spread a seed over the state
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// xorshift64*
+static uint64_t next_random(struct traffic_gen *g) {
+    g->rng ^= g->rng >> 12;
+    g->rng ^= g->rng << 25;
+    g->rng ^= g->rng >> 27;
+    return g->rng * 0x2545f4914f6cdd1dull;
+}
+
+// Uniform in [0, 1)
+static double next_uniform(struct traffic_gen *g) {
+    return (double) (next_random(g) >> 11) * 0x1.0p-53;
+}
+
+// Exponential with the given mean
+static uint64_t next_exp(struct traffic_gen *g, double mean) {
+    return (uint64_t) (-log(1.0 - next_uniform(g)) * mean);
+}
+
+void traffic_init(struct traffic_gen *g, int host_id) {
+    memset(g, 0, sizeof(struct traffic_gen));
+    g->host_id = host_id;
+}
+
+// Every host but this one, for dst=all and shuffles
+static void all_hosts(struct traffic_gen *g) {
+    struct net_node *node;
+
+    g->num_dst = 0;
+    for (node = net_get_node_list(); node != NULL && g->num_dst < TRAFFIC_MAX_DST; node = node->next) {
+        if (node->type != HOST || node->id == g->host_id) continue;
+        g->dst[g->num_dst] = node->id;
+        g->weight[g->num_dst++] = 1;
+    }
+}
+
+// "id[:weight],..." into the destinations, returns false if it is not that
+static bool parse_dst(struct traffic_gen *g, const char *list) {
+    char *end;
+    long id, w;
+
+    if (strcmp(list, "all") == 0) {
+        all_hosts(g);
+        return true;
+    }
+    g->num_dst = 0;
+    while (*list != '\0') {
+        id = strtol(list, &end, 10);
+        if (end == list || id < 0 || id > 127 || g->num_dst == TRAFFIC_MAX_DST) return false;
+        w = 1;
+        if (*end == ':') {
+            list = end + 1;
+            w = strtol(list, &end, 10);
+            if (end == list || w < 1) return false;
+        }
+        g->dst[g->num_dst] = (int) id;
+        g->weight[g->num_dst++] = (uint32_t) w;
+        if (*end == ',') end++;
+        else if (*end != '\0') return false;
+        list = end;
+    }
+    return true;
+}
+
+bool traffic_start(struct traffic_gen *g, const char *spec, char *err, int size) {
+    char text[MAN_MSG_LENGTH];
+    char *token, *save;
+    char *value;
+    uint32_t time_ms = 0;
+    int p, k;
+
+    traffic_init(g, g->host_id);
+    g->rate = TRAFFIC_RATE;
+    g->size_min = g->size_max = PAYLOAD_MAX;
+    g->seed = 1;
+    g->burst_ms = TRAFFIC_BURST_MS;
+    g->idle_ms = TRAFFIC_IDLE_MS;
+    all_hosts(g);
+
+    snprintf(text, sizeof(text), "%s", spec);
+    token = strtok_r(text, " ", &save);
+    for (p = 0; token != NULL && p <= TRAFFIC_SHUFFLE && strcmp(token, pattern_names[p]) != 0; p++);
+    if (token == NULL || p > TRAFFIC_SHUFFLE) {
+        snprintf(err, size, "Invalid traffic pattern, use cbr, poisson, onoff or shuffle");
+        return false;
+    }
+    g->pattern = (enum traffic_pattern) p;
+
+    while ((token = strtok_r(NULL, " ", &save)) != NULL) {
+        value = strchr(token, '=');
+        if (value == NULL) {
+            snprintf(err, size, "Invalid traffic option %s", token);
+            return false;
+        }
+        *value++ = '\0';
+        if (strcmp(token, "rate") == 0) {
+            g->rate = atof(value);
+        } else if (strcmp(token, "size") == 0) {
+            if (sscanf(value, "%d-%d", &g->size_min, &g->size_max) != 2) g->size_min = g->size_max = atoi(value);
+        } else if (strcmp(token, "dst") == 0) {
+            if (!parse_dst(g, value)) {
+                snprintf(err, size, "Invalid traffic destinations %s", value);
+                return false;
+            }
+        } else if (strcmp(token, "seed") == 0) {
+            g->seed = strtoull(value, NULL, 10);
+        } else if (strcmp(token, "time") == 0) {
+            time_ms = (uint32_t) atoi(value);
+        } else if (strcmp(token, "burst") == 0) {
+            g->burst_ms = (uint32_t) atoi(value);
+        } else if (strcmp(token, "idle") == 0) {
+            g->idle_ms = (uint32_t) atoi(value);
+        } else {
+            snprintf(err, size, "Invalid traffic option %s", token);
+            return false;
+        }
+    }
+    if (g->rate <= 0 || g->size_min < 0 || g->size_max > PAYLOAD_MAX || g->size_min > g->size_max
+        || g->num_dst == 0 || (g->pattern == TRAFFIC_ONOFF && g->burst_ms == 0)) {
+        snprintf(err, size, "Invalid traffic: rate above 0, size 0 to %d, at least one destination", PAYLOAD_MAX);
+        return false;
+    }
+    for (g->weight_sum = 0, k = 0; k < g->num_dst; k++) g->weight_sum += g->weight[k];
+
+    g->rng = mix(g->seed ^ mix((uint64_t) g->host_id));
+    if (g->rng == 0) g->rng = 1;
+    g->start_us = clock_us();
+    g->stop_us = time_ms > 0 ? g->start_us + (uint64_t) time_ms * 1000 : 0;
+    g->next_us = g->start_us;
+    g->on = true;
+    g->phase_end_us = g->start_us + next_exp(g, g->burst_ms * 1000.0);
+    g->active = true;
+    return true;
+}
+
+void traffic_stop(struct traffic_gen *g) {
+    if (!g->active) return;
+    g->active = false;
+    g->end_us = clock_us();
+}
+
+static int pick_dst(struct traffic_gen *g) {
+    uint32_t r;
+    int k;
+
+    if (g->pattern == TRAFFIC_SHUFFLE) {
+        k = g->next_dst;
+        g->next_dst = (g->next_dst + 1) % g->num_dst;
+        return g->dst[k];
+    }
+    r = (uint32_t) (next_random(g) % g->weight_sum);
+    for (k = 0; r >= g->weight[k]; k++) r -= g->weight[k];
+    return g->dst[k];
+}
+
+bool traffic_next(struct traffic_gen *g, uint64_t now, struct packet *p) {
+    double gap = 1e6 / g->rate;
+    uint64_t start;
+    uint32_t seq;
+
+    if (!g->active) return false;
+    if (g->stop_us != 0 && now >= g->stop_us) {
+        traffic_stop(g);
+        return false;
+    }
+
+    // Bursts and the gaps between them
+    if (g->pattern == TRAFFIC_ONOFF) {
+        while (now >= g->phase_end_us) {
+            start = g->phase_end_us;
+            g->on = !g->on;
+            g->phase_end_us = start + next_exp(g, (g->on ? g->burst_ms : g->idle_ms) * 1000.0);
+            if (g->on && g->next_us < start) g->next_us = start;
+        }
+        if (!g->on) return false;
+    }
+    if (g->next_us > now) return false;
+
+    // Too far behind to catch up in one pass: all but the last TRAFFIC_TICK_MAX due are skipped
+    if (now - g->next_us > (uint64_t) (gap * TRAFFIC_TICK_MAX)) {
+        g->skipped += (uint64_t) ((double) (now - g->next_us) / gap) - TRAFFIC_TICK_MAX;
+        g->next_us = now - (uint64_t) (gap * TRAFFIC_TICK_MAX);
+    }
+    g->next_us += g->pattern == TRAFFIC_POISSON ? next_exp(g, gap) : (uint64_t) gap;
+
+    memset(p, 0, sizeof(struct packet));
+    p->src = (char) g->host_id;
+    p->dst = (char) pick_dst(g);
+    p->type = (char) PKT_TRAFFIC;
+    p->length = g->size_min + (int) (next_random(g) % (uint64_t) (g->size_max - g->size_min + 1));
+    seq = (uint32_t) g->sent_packets;
+    if (p->length >= (int) sizeof(seq)) memcpy(p->payload, &seq, sizeof(seq));
+
+    g->sent_packets++;
+    g->sent_bytes += (uint64_t) p->length + 4;
+    metrics_add(&metrics_self()->traffic_offered_packets, 1);
+    metrics_add(&metrics_self()->traffic_offered_bytes, (uint64_t) p->length + 4);
+    return true;
+}
+
+void traffic_received(struct traffic_gen *g, struct packet *p) {
+    g->recv_packets++;
+    g->recv_bytes += (uint64_t) p->length + 4;
+    metrics_add(&metrics_self()->traffic_delivered_packets, 1);
+    metrics_add(&metrics_self()->traffic_delivered_bytes, (uint64_t) p->length + 4);
+}
+
+int traffic_report(struct traffic_gen *g, char *buf, int size) {
+    double s;
+    int n = 0;
+
+    if (g->start_us != 0) {
+        s = (double) ((g->active ? clock_us() : g->end_us) - g->start_us) / 1e6;
+        n += snprintf(buf + n, size - n,
+                      "    Traffic %s at %.1f pkt/s%s: offered %llu packets, %llu bytes in %.2f s (%.1f pkt/s), "
+                      "%llu skipped\n", pattern_names[g->pattern], g->rate, g->active ? "" : ", stopped",
+                      (unsigned long long) g->sent_packets, (unsigned long long) g->sent_bytes, s,
+                      s > 0 ? (double) g->sent_packets / s : 0.0, (unsigned long long) g->skipped);
+    }
+    if (g->recv_packets > 0 && n < size) {
+        n += snprintf(buf + n, size - n, "    Traffic delivered here: %llu packets, %llu bytes\n",
+                      (unsigned long long) g->recv_packets, (unsigned long long) g->recv_bytes);
+    }
+    return n < size ? n : size - 1;
+}
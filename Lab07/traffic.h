@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file traffic.h
+/// @version 1.0
+///
+/// Traffic generator of a host, for load tests. The host's loop asks it
+/// every pass for the PKT_TRAFFIC packets that are due and sends them
+/// straight out, next to its jobs; the hosts they go to count them and
+/// drop them. Started with the manager command "g <spec>":
+///
+///     cbr rate=200 size=100 dst=1,2 time=5000
+///     poisson rate=50 size=20-100 dst=1:3,2:1 seed=7
+///     onoff rate=400 burst=50 idle=200 dst=all
+///     shuffle rate=100 size=100
+///
+/// cbr sends evenly spaced packets, poisson with exponential gaps, onoff
+/// at rate during bursts and nothing in between (both exponential, with
+/// means burst= and idle= in ms), and shuffle goes round every other
+/// host in turn, so it is an all to all shuffle once every host runs it.
+/// rate is packets per second, size a payload length or a min-max range,
+/// dst the host ids to pick from, with a weight after ':' (all if not
+/// given), time the ms to run for (until "g stop" if not given). The
+/// same seed= gives the same packets; each host mixes in its id.
+///
+/// Offered load is what the generator sends, delivered load what reaches
+/// the hosts it sends to; both go to the metrics of the nodes.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_TRAFFIC_H
+#define NETWORK_SIMULATOR_02_TRAFFIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "main.h"
+
+#define TRAFFIC_MAX_DST     64
+#define TRAFFIC_TICK_MAX    64      /* Packets sent in one pass of the host's loop, the rest are skipped */
+#define TRAFFIC_RATE        100     /* Default packets per second */
+#define TRAFFIC_BURST_MS    100     /* Default mean length of an onoff burst */
+#define TRAFFIC_IDLE_MS     400     /* Default mean gap between onoff bursts */
+
+enum traffic_pattern {
+    TRAFFIC_CBR,
+    TRAFFIC_POISSON,
+    TRAFFIC_ONOFF,
+    TRAFFIC_SHUFFLE
+};
+
+struct traffic_gen {
+    bool active;
+    int host_id;
+    enum traffic_pattern pattern;
+    double rate;                    // Packets per second, while on
+    int size_min, size_max;
+    int dst[TRAFFIC_MAX_DST];
+    uint32_t weight[TRAFFIC_MAX_DST];
+    uint32_t weight_sum;
+    int num_dst;
+    int next_dst;                   // Of a shuffle
+    uint64_t seed;
+    uint64_t rng;
+    uint32_t burst_ms, idle_ms;
+    bool on;                        // In a burst
+    uint64_t phase_end_us;          // Of the burst or the gap
+    uint64_t start_us;
+    uint64_t stop_us;               // 0 to run until stopped
+    uint64_t next_us;               // When the next packet is due
+    uint64_t end_us;                // When it last stopped
+
+    // Offered by this host, and delivered to it
+    uint64_t sent_packets, sent_bytes;
+    uint64_t skipped;               // Due while the host was behind, never sent
+    uint64_t recv_packets, recv_bytes;
+};
+
+void traffic_init(struct traffic_gen *g, int host_id);
+
+// Start generating as spec says, returns false with why in err if it cannot be parsed
+bool traffic_start(struct traffic_gen *g, const char *spec, char *err, int size);
+
+void traffic_stop(struct traffic_gen *g);
+
+// Fill p with the next packet due by now, returns false once none is
+bool traffic_next(struct traffic_gen *g, uint64_t now, struct packet *p);
+
+// A PKT_TRAFFIC packet arrived for this host
+void traffic_received(struct traffic_gen *g, struct packet *p);
+
+// Offered and delivered load in a line, returns the length written
+int traffic_report(struct traffic_gen *g, char *buf, int size);
+
+#endif //NETWORK_SIMULATOR_02_TRAFFIC_H
@@ -0,0 +1,994 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file transfer.c
+/// @version 1.0
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "transfer.h"
+#include "clock.h"
+#include "crc32c.h"
+#include "lz.h"
+#include "metrics.h"
+
+#define MAP_MAGIC   0x50414D46u     // "FMAP"
+#define NO_OFFSET   0xFFFFFFFFu
+
+// Header of "<name>.part.map", followed by num_blocks uint16_t fill counts
+struct part_map_header {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t file_crc;
+    uint32_t block;
+    uint32_t num_blocks;
+};
+
+// Queue a packet to be sent on all ports
+static void transfer_queue_packet(struct transfer_ctx *ctx, struct packet *pkt) {
+    struct host_job *job = (struct host_job *) malloc(sizeof(struct host_job));
+    job->type = JOB_SEND_PKT;
+    job->packet = pkt;
+    job_q_add(ctx->job_q, job);
+}
+
+static void put_u32(char *buf, uint32_t value) {
+    memcpy(buf, &value, sizeof(uint32_t));
+}
+
+static uint32_t get_u32(const char *buf) {
+    uint32_t value;
+    memcpy(&value, buf, sizeof(uint32_t));
+    return value;
+}
+
+// Id of a file in the packets of its transfer
+static uint32_t file_id(const char *name) {
+    return crc32c(name, strlen(name));
+}
+
+static void transfer_path(struct transfer_ctx *ctx, char path[], const char *name, const char *suffix) {
+    snprintf(path, MAX_PATH_LENGTH, "./%s/%s%s", ctx->dir, name, suffix);
+}
+
+// CRC32C of the first len bytes of an open file, -1 if the file is shorter
+static int file_crc_prefix(FILE *fp, uint32_t len, uint32_t *crc) {
+    char buffer[4096];
+    uint32_t left = len;
+    size_t n;
+
+    *crc = 0;
+    rewind(fp);
+    while (left > 0) {
+        n = fread(buffer, 1, left < sizeof(buffer) ? left : sizeof(buffer), fp);
+        if (n == 0) return -1;
+        *crc = crc32c_update(*crc, buffer, n);
+        left -= (uint32_t) n;
+    }
+    return 0;
+}
+
+static uint32_t file_size(FILE *fp) {
+    long size;
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    return size < 0 ? 0 : (uint32_t) size;
+}
+
+void transfer_init(struct transfer_ctx *ctx, int host_id, char *dir, bool *dir_valid, struct job_queue *job_q) {
+    memset(ctx, 0, sizeof(struct transfer_ctx));
+    ctx->host_id = host_id;
+    ctx->dir = dir;
+    ctx->dir_valid = dir_valid;
+    ctx->job_q = job_q;
+    ctx->compress = true;
+}
+
+// Forget how an earlier transfer of the same file ended, a new one starts
+static void done_forget(struct transfer_ctx *ctx, bool outgoing, int dst, const char *name) {
+    struct file_done *d;
+
+    for (int i = 0; i < TRANSFER_DONE_MAX; i++) {
+        d = &ctx->done[i];
+        if (d->used && d->outgoing == outgoing && (!outgoing || d->dst == dst) && strcmp(d->name, name) == 0) {
+            d->used = false;
+        }
+    }
+}
+
+// Keep how a transfer ended for the host's state, over the oldest entry
+static struct file_done *done_record(struct transfer_ctx *ctx, bool outgoing, int dst, const char *name, bool ok) {
+    struct file_done *d;
+
+    done_forget(ctx, outgoing, dst, name);
+    d = &ctx->done[ctx->done_next];
+    ctx->done_next = (ctx->done_next + 1) % TRANSFER_DONE_MAX;
+    d->used = true;
+    d->outgoing = outgoing;
+    d->ok = ok;
+    d->dst = dst;
+    d->size = 0;
+    d->us = 0;
+    snprintf(d->name, MAX_NAME_LENGTH, "%s", name);
+    return d;
+}
+
+static void send_range_request(struct transfer_ctx *ctx, int src, const char *name, uint32_t offset,
+                               int stripe, int stripes) {
+    struct packet *pkt = (struct packet *) calloc(1, sizeof(struct packet));
+    int n;
+
+    pkt->src = (char) ctx->host_id;
+    pkt->dst = (char) src;
+    pkt->type = (char) PKT_FILE_DOWNLOAD_REQ;
+    put_u32(pkt->payload + PKT_FILE_REQ_OFFSET, offset);
+    put_u32(pkt->payload + PKT_FILE_REQ_LENGTH, 0);
+    pkt->payload[PKT_FILE_REQ_STRIPE] = (char) stripe;
+    pkt->payload[PKT_FILE_REQ_STRIPES] = (char) stripes;
+    pkt->payload[PKT_FILE_REQ_FLAGS] = (char) (ctx->compress ? FILE_FLAG_COMPRESS : 0);
+    n = snprintf(pkt->payload + PKT_FILE_REQ_NAME, PAYLOAD_MAX - PKT_FILE_REQ_NAME, "%s", name);
+    if (n > (int) (PAYLOAD_MAX - PKT_FILE_REQ_NAME - 1)) n = (int) (PAYLOAD_MAX - PKT_FILE_REQ_NAME - 1);
+    pkt->length = (int) PKT_FILE_REQ_NAME + n;
+    transfer_queue_packet(ctx, pkt);
+}
+
+/*
+ * Sender side
+ */
+
+// Move the send offset forward to the next block that belongs to our stripe
+static void send_align(struct file_send *s) {
+    uint32_t block = s->offset / PKT_FILE_BLOCK;
+
+    if (s->stripes <= 1) return;
+    while (block % s->stripes != (uint32_t) s->stripe) {
+        block++;
+        s->offset = block * PKT_FILE_BLOCK;
+    }
+    if (s->offset > s->end) s->offset = s->end;
+}
+
+static void cc_init(struct file_send *s) {
+    s->flight_head = 0;
+    s->flight_count = 0;
+    s->high = 0;
+    s->cwnd = TRANSFER_INIT_CWND;
+    s->ssthresh = TRANSFER_INIT_SSTHRESH;
+    s->srtt = 0;
+    s->rttvar = 0;
+    s->min_rtt = 0;
+    s->last_rtt = 0;
+    s->rto = TRANSFER_RTO_INIT;
+    s->last_cut_ms = 0;
+    s->timeouts = 0;
+    s->cuts = 0;
+}
+
+// Multiplicative decrease, at most once per round trip since one loss or queue shows up in several signals
+static void cc_cut(struct file_send *s, uint32_t now) {
+    if (s->cuts > 0 && now - s->last_cut_ms < (s->srtt > 0 ? s->srtt : s->rto)) return;
+    s->ssthresh = s->cwnd / 2 < 2 ? 2 : s->cwnd / 2;
+    s->cwnd = s->ssthresh;
+    s->last_cut_ms = now;
+    s->cuts++;
+}
+
+// Nothing came back for a whole RTO, go back to the oldest chunk with a window of one
+static void cc_timeout(struct file_send *s, uint32_t now) {
+    s->ssthresh = s->cwnd / 2 < 2 ? 2 : s->cwnd / 2;
+    s->cwnd = 1;
+    s->rto = s->rto * 2 > TRANSFER_RTO_MAX ? TRANSFER_RTO_MAX : s->rto * 2;
+    s->offset = s->flight[s->flight_head].offset;
+    s->flight_count = 0;
+    s->last_cut_ms = now;
+    s->cuts++;
+    s->timeouts++;
+}
+
+// Slow start below ssthresh, one chunk per window after that. A window
+// the sender is not filling anyway is not grown any further.
+static void cc_acked(struct file_send *s, bool limited) {
+    if (!limited) return;
+    if (s->cwnd < s->ssthresh) {
+        s->cwnd += 1;
+    } else {
+        s->cwnd += 1 / s->cwnd;
+    }
+    if (s->cwnd > TRANSFER_MAX_WINDOW) s->cwnd = TRANSFER_MAX_WINDOW;
+}
+
+// Smoothed RTT and retransmit timeout as in TCP
+static void cc_rtt_sample(struct file_send *s, uint32_t rtt) {
+    uint32_t diff;
+
+    if (rtt == 0) rtt = 1;
+    if (s->srtt == 0) {
+        s->srtt = rtt;
+        s->rttvar = rtt / 2;
+    } else {
+        diff = s->srtt > rtt ? s->srtt - rtt : rtt - s->srtt;
+        s->rttvar = (3 * s->rttvar + diff) / 4;
+        s->srtt = (7 * s->srtt + rtt) / 8;
+    }
+    if (s->min_rtt == 0 || rtt < s->min_rtt) s->min_rtt = rtt;
+    s->last_rtt = rtt;
+
+    s->rto = s->srtt + 4 * s->rttvar;
+    if (s->rto < TRANSFER_RTO_MIN) s->rto = TRANSFER_RTO_MIN;
+    if (s->rto > TRANSFER_RTO_MAX) s->rto = TRANSFER_RTO_MAX;
+}
+
+bool transfer_start_send(struct transfer_ctx *ctx, int dst, const char *name, uint32_t offset, uint32_t length,
+                         int stripe, int stripes, int flags) {
+    char path[MAX_PATH_LENGTH];
+    struct file_send *s = NULL;
+    struct packet *pkt;
+    struct host_job *job;
+    FILE *fp;
+    int i, n;
+
+    if (!*ctx->dir_valid) return false;
+    if (stripes < 1 || stripe < 0 || stripe >= stripes) {
+        stripe = 0;
+        stripes = 1;
+    }
+
+    transfer_path(ctx, path, name, "");
+    fp = fopen(path, "r");
+    if (fp == NULL) return false;
+
+    // A new request for the same stripe of a file replaces the one in progress
+    for (i = 0; i < MAX_TRANSFERS; i++) {
+        if (ctx->send[i].active && ctx->send[i].dst == dst && ctx->send[i].stripe == stripe
+            && strcmp(ctx->send[i].name, name) == 0) {
+            fclose(ctx->send[i].fp);
+            s = &ctx->send[i];
+            break;
+        }
+    }
+    for (i = 0; s == NULL && i < MAX_TRANSFERS; i++) {
+        if (!ctx->send[i].active) s = &ctx->send[i];
+    }
+    if (s == NULL) {
+        fclose(fp);
+        return false;
+    }
+    done_forget(ctx, true, dst, name);
+
+    if (!s->active) {
+        cc_init(s);
+    } else if (s->flight_count > 0 || offset < s->high) {
+        cc_cut(s, clock_ms());    // The receiver wants data again, some of it was lost
+    }
+    s->flight_count = 0;
+    s->timeouts = 0;
+
+    s->fp = fp;
+    s->dst = dst;
+    if (!s->active) {
+        // A resume keeps the size and digest of the send in progress, only a new send reads the whole file
+        s->id = file_id(name);
+        s->size = file_size(fp);
+        file_crc_prefix(fp, s->size, &s->file_crc);
+    }
+    snprintf(s->name, MAX_NAME_LENGTH, "%s", name);
+    s->stripe = stripe;
+    s->stripes = stripes;
+    s->compress = ctx->compress && (flags & FILE_FLAG_COMPRESS);
+    s->lz_raw = PKT_FILE_CHUNK_MAX * 2;
+    s->lz_skip = 0;
+    s->offset = offset > s->size ? s->size : offset;
+    s->end = (length == 0 || s->offset + length > s->size) ? s->size : s->offset + length;
+    send_align(s);
+    fseek(fp, s->offset, SEEK_SET);
+
+    // First packet has the file name, size and digest
+    pkt = (struct packet *) calloc(1, sizeof(struct packet));
+    pkt->src = (char) ctx->host_id;
+    pkt->dst = (char) dst;
+    pkt->type = (char) PKT_FILE_UPLOAD_START;
+    put_u32(pkt->payload + PKT_FILE_ID, s->id);
+    put_u32(pkt->payload + PKT_FILE_SIZE, s->size);
+    put_u32(pkt->payload + PKT_FILE_DIGEST, s->file_crc);
+    put_u32(pkt->payload + PKT_FILE_START_OFFSET, s->offset);
+    pkt->payload[PKT_FILE_START_FLAGS] = (char) (s->compress ? FILE_FLAG_COMPRESS : 0);
+    n = snprintf(pkt->payload + PKT_FILE_START_NAME, PAYLOAD_MAX - PKT_FILE_START_NAME, "%s", name);
+    if (n > (int) (PAYLOAD_MAX - PKT_FILE_START_NAME - 1)) n = (int) (PAYLOAD_MAX - PKT_FILE_START_NAME - 1);
+    pkt->length = (int) PKT_FILE_START_NAME + n;
+    transfer_queue_packet(ctx, pkt);
+
+    // A job that sends one chunk each time it runs
+    if (!s->active) {
+        s->active = true;
+        job = (struct host_job *) malloc(sizeof(struct host_job));
+        job->type = JOB_FILE_UPLOAD_SEND_CHUNK;
+        job->packet = NULL;
+        job->transfer_index = (int) (s - ctx->send);
+        job_q_add(ctx->job_q, job);
+    }
+    return true;
+}
+
+/*
+ * Try to fit more than a plain chunk worth of file into one compressed
+ * packet. Matches may reach back to the start of the block, which the
+ * receiver already has on disk. Returns the raw bytes the packet covers,
+ * 0 if the data did not shrink enough and a plain chunk should be sent.
+ */
+static uint32_t send_compressed(struct file_send *s, struct packet *pkt, uint32_t avail) {
+    char buf[PKT_FILE_BLOCK * 2];
+    uint32_t block_start = (s->offset / PKT_FILE_BLOCK) * PKT_FILE_BLOCK;
+    uint32_t prefix = s->offset - block_start;
+    uint16_t raw_len;
+    uint32_t try_len;
+    size_t n;
+    int c;
+
+    if (s->lz_skip > 0) {
+        s->lz_skip--;
+        return 0;
+    }
+    if (avail <= PKT_FILE_CHUNK_MAX) return 0;
+
+    try_len = avail < s->lz_raw ? avail : s->lz_raw;
+    fseek(s->fp, block_start, SEEK_SET);
+    n = fread(buf, 1, prefix + try_len, s->fp);
+    try_len = n > prefix ? (uint32_t) n - prefix : 0;
+
+    while (try_len > PKT_FILE_CHUNK_MAX) {
+        c = lz_compress_prefix(buf, (int) prefix, (int) try_len, pkt->payload + PKT_FILE_LZ_DATA,
+                               (int) PKT_FILE_LZ_MAX);
+        if (c > 0) {
+            raw_len = (uint16_t) try_len;
+            pkt->type = (char) PKT_FILE_UPLOAD_MIDDLE_LZ;
+            put_u32(pkt->payload + PKT_FILE_OFFSET, s->offset);
+            put_u32(pkt->payload + PKT_FILE_CHUNK_CRC, crc32c(buf + prefix, try_len));
+            memcpy(pkt->payload + PKT_FILE_RAW_LENGTH, &raw_len, sizeof(uint16_t));
+            pkt->length = (int) PKT_FILE_LZ_DATA + c;
+
+            // It fit, try a bit more next time
+            if (try_len == s->lz_raw && s->lz_raw < PKT_FILE_BLOCK) {
+                s->lz_raw += s->lz_raw / 4;
+                if (s->lz_raw > PKT_FILE_BLOCK) s->lz_raw = PKT_FILE_BLOCK;
+            } else if (try_len < s->lz_raw) {
+                s->lz_raw = try_len;
+            }
+            fseek(s->fp, s->offset + try_len, SEEK_SET);
+            return try_len;
+        }
+        try_len = try_len * 3 / 4;
+    }
+
+    // Data does not compress, send plain chunks for a while
+    s->lz_raw = PKT_FILE_CHUNK_MAX * 2;
+    s->lz_skip = TRANSFER_LZ_BACKOFF;
+    fseek(s->fp, s->offset, SEEK_SET);
+    return 0;
+}
+
+void transfer_send_chunk(struct transfer_ctx *ctx, struct host_job *job) {
+    struct file_send *s = &ctx->send[job->transfer_index];
+    struct sent_chunk *c;
+    struct packet *pkt;
+    uint32_t now = clock_ms();
+    uint32_t block_end;
+    uint32_t len;
+    size_t n;
+
+    if (!s->active) {
+        free(job);
+        return;
+    }
+
+    if (s->flight_count > 0 && now - s->flight[s->flight_head].sent_ms > s->rto) {
+        if (s->timeouts >= TRANSFER_MAX_RETRIES) {
+            // The receiver is gone, it can resume from its .part file later
+            fclose(s->fp);
+            s->active = false;
+            done_record(ctx, true, s->dst, s->name, false);
+            free(job);
+            return;
+        }
+        cc_timeout(s, now);
+        fseek(s->fp, s->offset, SEEK_SET);
+    }
+
+    if (s->offset >= s->end) {
+        if (s->flight_count > 0) {
+            job_q_add(ctx->job_q, job);     // Wait for the last chunks to be acknowledged
+            return;
+        }
+
+        // Nothing left, tell the receiver to check what it has
+        pkt = (struct packet *) calloc(1, sizeof(struct packet));
+        pkt->src = (char) ctx->host_id;
+        pkt->dst = (char) s->dst;
+        pkt->type = (char) PKT_FILE_UPLOAD_END;
+        put_u32(pkt->payload + PKT_FILE_ID, s->id);
+        put_u32(pkt->payload + PKT_FILE_SIZE, s->size);
+        put_u32(pkt->payload + PKT_FILE_DIGEST, s->file_crc);
+        pkt->length = (int) PKT_FILE_END_LENGTH;
+        transfer_queue_packet(ctx, pkt);
+
+        fclose(s->fp);
+        s->active = false;
+        done_record(ctx, true, s->dst, s->name, true);
+        free(job);
+        return;
+    }
+
+    // Window is full, try again on the next pass
+    if (s->flight_count >= (int) s->cwnd || s->flight_count == TRANSFER_MAX_WINDOW) {
+        job_q_add(ctx->job_q, job);
+        return;
+    }
+
+    pkt = (struct packet *) calloc(1, sizeof(struct packet));
+    pkt->src = (char) ctx->host_id;
+    pkt->dst = (char) s->dst;
+    put_u32(pkt->payload + PKT_FILE_ID, s->id);
+
+    // Chunks never cross a block boundary
+    block_end = (s->offset / PKT_FILE_BLOCK + 1) * PKT_FILE_BLOCK;
+    len = (block_end < s->end ? block_end : s->end) - s->offset;
+
+    n = s->compress ? send_compressed(s, pkt, len) : 0;
+    if (n == 0) {
+        if (len > PKT_FILE_CHUNK_MAX) len = PKT_FILE_CHUNK_MAX;
+        n = fread(pkt->payload + PKT_FILE_CHUNK_DATA, 1, len, s->fp);
+        if (n > 0) {
+            pkt->type = (char) PKT_FILE_UPLOAD_MIDDLE;
+            put_u32(pkt->payload + PKT_FILE_OFFSET, s->offset);
+            put_u32(pkt->payload + PKT_FILE_CHUNK_CRC, crc32c(pkt->payload + PKT_FILE_CHUNK_DATA, n));
+            pkt->length = (int) (PKT_FILE_CHUNK_DATA + n);
+        }
+    }
+
+    if (n == 0) {
+        // The file got shorter while we were sending it
+        free(pkt);
+        s->end = s->offset;
+        job_q_add(ctx->job_q, job);
+        return;
+    }
+
+    c = &s->flight[(s->flight_head + s->flight_count) % TRANSFER_MAX_WINDOW];
+    c->offset = s->offset;
+    c->len = (uint32_t) n;
+    c->sent_ms = now;
+    c->resent = s->offset < s->high;
+    s->flight_count++;
+
+    s->offset += (uint32_t) n;
+    if (s->offset > s->high) s->high = s->offset;
+    if (s->offset == block_end && s->stripes > 1) {
+        send_align(s);
+        fseek(s->fp, s->offset, SEEK_SET);
+    }
+    transfer_queue_packet(ctx, pkt);
+    job_q_add(ctx->job_q, job);
+}
+
+void transfer_recv_ack(struct transfer_ctx *ctx, struct packet *pkt) {
+    struct file_send *s = NULL;
+    struct sent_chunk *c;
+    uint32_t id, offset, next, block, rtt;
+    uint32_t now = clock_ms();
+    bool limited;
+    int i;
+
+    if (pkt->length < (int) PKT_FILE_ACK_LENGTH) return;
+    id = get_u32(pkt->payload + PKT_FILE_ID);
+    offset = get_u32(pkt->payload + PKT_FILE_ACK_OFFSET);
+    next = get_u32(pkt->payload + PKT_FILE_ACK_NEXT);
+    block = offset / PKT_FILE_BLOCK;
+
+    for (i = 0; i < MAX_TRANSFERS; i++) {
+        s = &ctx->send[i];
+        if (s->active && s->dst == pkt->src && s->id == id
+            && (s->stripes <= 1 || block % (uint32_t) s->stripes == (uint32_t) s->stripe)) break;
+    }
+    if (i == MAX_TRANSFERS) return;
+
+    // RTT sample from the chunk this answers, unless it was sent more than once
+    for (i = 0; i < s->flight_count; i++) {
+        c = &s->flight[(s->flight_head + i) % TRANSFER_MAX_WINDOW];
+        if (c->offset != offset) continue;
+        if (!c->resent) {
+            rtt = now - c->sent_ms;
+            cc_rtt_sample(s, rtt);
+            if (rtt > s->min_rtt + TRANSFER_DELAY_TARGET) cc_cut(s, now);   // Queue building up on the path
+        }
+        break;
+    }
+
+    // Everything before next has arrived
+    limited = s->flight_count * 2 >= (int) s->cwnd;
+    while (s->flight_count > 0) {
+        c = &s->flight[s->flight_head];
+        if (next != NO_OFFSET && c->offset + c->len > next) break;
+        s->flight_head = (s->flight_head + 1) % TRANSFER_MAX_WINDOW;
+        s->flight_count--;
+        s->timeouts = 0;
+        cc_acked(s, limited);
+    }
+}
+
+/*
+ * Receiver side
+ */
+
+static uint32_t block_len(struct file_recv *r, uint32_t block) {
+    uint32_t start = block * PKT_FILE_BLOCK;
+    return r->size - start < PKT_FILE_BLOCK ? r->size - start : PKT_FILE_BLOCK;
+}
+
+// First byte of stripe k we do not have yet, NO_OFFSET when the stripe is complete
+static uint32_t next_missing(struct file_recv *r, int k) {
+    if (!r->sized) return 0;
+    for (uint32_t b = (uint32_t) k; b < r->num_blocks; b += (uint32_t) r->num_sources) {
+        if (r->fill[b] < block_len(r, b)) return b * PKT_FILE_BLOCK + r->fill[b];
+    }
+    return NO_OFFSET;
+}
+
+// Tell the sender a chunk of stripe k arrived and where the stripe continues
+static void send_ack(struct transfer_ctx *ctx, struct file_recv *r, int dst, uint32_t offset, int k) {
+    struct packet *pkt = (struct packet *) calloc(1, sizeof(struct packet));
+
+    pkt->src = (char) ctx->host_id;
+    pkt->dst = (char) dst;
+    pkt->type = (char) PKT_FILE_ACK;
+    put_u32(pkt->payload + PKT_FILE_ID, r->id);
+    put_u32(pkt->payload + PKT_FILE_ACK_OFFSET, offset);
+    put_u32(pkt->payload + PKT_FILE_ACK_NEXT, next_missing(r, k));
+    pkt->length = (int) PKT_FILE_ACK_LENGTH;
+    transfer_queue_packet(ctx, pkt);
+}
+
+static struct file_recv *find_recv_by_name(struct transfer_ctx *ctx, const char *name) {
+    for (int i = 0; i < MAX_TRANSFERS; i++) {
+        if (ctx->recv[i].active && strcmp(ctx->recv[i].name, name) == 0) return &ctx->recv[i];
+    }
+    return NULL;
+}
+
+// The receive a chunk or end of file id from host src belongs to
+static struct file_recv *find_recv(struct transfer_ctx *ctx, int src, uint32_t id) {
+    for (int i = 0; i < MAX_TRANSFERS; i++) {
+        if (!ctx->recv[i].active || ctx->recv[i].id != id) continue;
+        for (int k = 0; k < ctx->recv[i].num_sources; k++) {
+            if (ctx->recv[i].source[k].src == src) return &ctx->recv[i];
+        }
+    }
+    return NULL;
+}
+
+static void map_save(struct transfer_ctx *ctx, struct file_recv *r) {
+    char path[MAX_PATH_LENGTH];
+    struct part_map_header h;
+    FILE *fp;
+
+    if (!r->sized) return;
+    transfer_path(ctx, path, r->name, ".part.map");
+    fp = fopen(path, "w");
+    if (fp == NULL) return;
+
+    fflush(r->fp);
+    h.magic = MAP_MAGIC;
+    h.size = r->size;
+    h.file_crc = r->file_crc;
+    h.block = PKT_FILE_BLOCK;
+    h.num_blocks = r->num_blocks;
+    fwrite(&h, sizeof(h), 1, fp);
+    fwrite(r->fill, sizeof(uint16_t), r->num_blocks, fp);
+    fclose(fp);
+    r->blocks_saved = r->blocks_done;
+}
+
+// Forget everything received so far and expect a file of this size
+static void recv_reset(struct file_recv *r, uint32_t size, uint32_t file_crc) {
+    free(r->fill);
+    r->size = size;
+    r->file_crc = file_crc;
+    r->num_blocks = (size + PKT_FILE_BLOCK - 1) / PKT_FILE_BLOCK;
+    r->fill = (uint16_t *) calloc(r->num_blocks + 1, sizeof(uint16_t));
+    r->blocks_done = 0;
+    r->blocks_saved = 0;
+    r->sized = true;
+    fflush(r->fp);
+    ftruncate(fileno(r->fp), 0);
+}
+
+static void recv_close(struct transfer_ctx *ctx, struct file_recv *r, bool keep_progress) {
+    if (keep_progress) map_save(ctx, r);
+    if (r->fp != NULL) fclose(r->fp);
+    free(r->fill);
+    r->fill = NULL;
+    r->fp = NULL;
+    r->active = false;
+}
+
+// Open "<name>.part" and pick up the progress saved in its map, if any
+static struct file_recv *recv_open(struct transfer_ctx *ctx, const char *name) {
+    char path[MAX_PATH_LENGTH];
+    struct part_map_header h;
+    struct file_recv *r;
+    FILE *map;
+    int i;
+
+    for (i = 0; i < MAX_TRANSFERS && ctx->recv[i].active; i++);
+    if (i == MAX_TRANSFERS) return NULL;
+    r = &ctx->recv[i];
+    memset(r, 0, sizeof(struct file_recv));
+
+    transfer_path(ctx, path, name, ".part");
+    r->fp = fopen(path, "r+");
+    if (r->fp == NULL) r->fp = fopen(path, "w+");
+    if (r->fp == NULL) return NULL;
+    r->active = true;
+    r->id = file_id(name);
+    r->start_us = clock_us();
+    snprintf(r->name, MAX_NAME_LENGTH, "%s", name);
+    done_forget(ctx, false, 0, name);
+
+    transfer_path(ctx, path, name, ".part.map");
+    map = fopen(path, "r");
+    if (map != NULL && fread(&h, sizeof(h), 1, map) == 1 && h.magic == MAP_MAGIC && h.block == PKT_FILE_BLOCK
+        && h.num_blocks == (h.size + PKT_FILE_BLOCK - 1) / PKT_FILE_BLOCK) {
+        r->size = h.size;
+        r->file_crc = h.file_crc;
+        r->num_blocks = h.num_blocks;
+        r->fill = (uint16_t *) calloc(r->num_blocks + 1, sizeof(uint16_t));
+        if (fread(r->fill, sizeof(uint16_t), r->num_blocks, map) == r->num_blocks) {
+            r->sized = true;
+            for (uint32_t b = 0; b < r->num_blocks; b++) {
+                if (r->fill[b] > block_len(r, b)) r->fill[b] = 0;
+                if (r->fill[b] == block_len(r, b)) r->blocks_done++;
+            }
+            r->blocks_saved = r->blocks_done;
+        } else {
+            free(r->fill);
+            r->fill = NULL;
+        }
+    }
+    if (map != NULL) fclose(map);
+
+    // Without a map nothing in the .part file can be trusted
+    if (!r->sized) {
+        fflush(r->fp);
+        ftruncate(fileno(r->fp), 0);
+    }
+    return r;
+}
+
+// Ask source k to continue its stripe from the first missing byte
+static void source_resume(struct transfer_ctx *ctx, struct file_recv *r, int k, bool force) {
+    struct file_source *src = &r->source[k];
+    uint32_t offset = next_missing(r, k);
+
+    if (offset == NO_OFFSET) return;
+    if (!force && src->resume_sent && src->resume_at == offset) return;
+    src->resume_sent = true;
+    src->resume_at = offset;
+    send_range_request(ctx, src->src, r->name, offset, k, r->num_sources);
+}
+
+// Hand the stripes of a host that keeps failing to one that still works
+static void source_give_up(struct transfer_ctx *ctx, struct file_recv *r, int bad_src) {
+    int k, j;
+    int good_src = -1;
+
+    for (j = 0; j < r->num_sources; j++) {
+        if (r->source[j].src != bad_src && r->source[j].retries <= TRANSFER_MAX_RETRIES) {
+            good_src = r->source[j].src;
+            break;
+        }
+    }
+    if (good_src < 0) {
+        // Nobody left to ask, the .part file lets a later request pick it up
+        done_record(ctx, false, 0, r->name, false);
+        recv_close(ctx, r, true);
+        return;
+    }
+    for (k = 0; k < r->num_sources; k++) {
+        if (r->source[k].src == bad_src) {
+            r->source[k].src = good_src;
+            r->source[k].retries = 0;
+            source_resume(ctx, r, k, true);
+        }
+    }
+}
+
+// All blocks are in, check the whole file against the sender's digest
+static void recv_finish(struct transfer_ctx *ctx, struct file_recv *r) {
+    char part[MAX_PATH_LENGTH];
+    char path[MAX_PATH_LENGTH];
+    struct file_done *d;
+    uint32_t crc;
+
+    fflush(r->fp);
+    transfer_path(ctx, part, r->name, ".part");
+    if (file_crc_prefix(r->fp, r->size, &crc) == 0 && crc == r->file_crc) {
+        transfer_path(ctx, path, r->name, "");
+        d = done_record(ctx, false, 0, r->name, true);
+        d->size = r->size;
+        d->us = clock_us() - r->start_us;
+        recv_close(ctx, r, false);
+        rename(part, path);
+        transfer_path(ctx, path, r->name, ".part.map");
+        remove(path);
+        return;
+    }
+
+    // Every chunk checked out but the file does not, start over
+    if (++r->retries > TRANSFER_MAX_RETRIES) {
+        done_record(ctx, false, 0, r->name, false);
+        recv_close(ctx, r, false);
+        remove(part);
+        transfer_path(ctx, path, r->name, ".part.map");
+        remove(path);
+        return;
+    }
+    recv_reset(r, r->size, r->file_crc);
+    for (int k = 0; k < r->num_sources; k++) {
+        source_resume(ctx, r, k, true);
+    }
+}
+
+bool transfer_request(struct transfer_ctx *ctx, const int src[], int num_src, const char *name) {
+    struct file_recv *r;
+    int k;
+
+    if (!*ctx->dir_valid || num_src < 1) return false;
+    if (num_src > MAX_SOURCES) num_src = MAX_SOURCES;
+
+    // A new request replaces the sources of one in progress
+    r = find_recv_by_name(ctx, name);
+    if (r != NULL) recv_close(ctx, r, true);
+    r = recv_open(ctx, name);
+    if (r == NULL) return false;
+
+    r->num_sources = num_src;
+    for (k = 0; k < num_src; k++) {
+        r->source[k].src = src[k];
+        source_resume(ctx, r, k, true);
+    }
+    return true;
+}
+
+void transfer_recv_start(struct transfer_ctx *ctx, struct packet *pkt) {
+    char name[MAX_NAME_LENGTH];
+    struct file_recv *r;
+    uint32_t size, file_crc;
+    bool known = false;
+    int k, n;
+
+    if (!*ctx->dir_valid || pkt->length < (int) PKT_FILE_START_NAME) return;
+
+    n = pkt->length - (int) PKT_FILE_START_NAME;
+    if (n >= MAX_NAME_LENGTH) n = MAX_NAME_LENGTH - 1;
+    memcpy(name, pkt->payload + PKT_FILE_START_NAME, n);
+    name[n] = '\0';
+    size = get_u32(pkt->payload + PKT_FILE_SIZE);
+    file_crc = get_u32(pkt->payload + PKT_FILE_DIGEST);
+
+    r = find_recv_by_name(ctx, name);
+    if (r == NULL) {
+        r = recv_open(ctx, name);
+        if (r == NULL) return;
+    }
+    for (k = 0; k < r->num_sources; k++) {
+        if (r->source[k].src == pkt->src) known = true;
+    }
+    if (!known) {
+        // An upload we did not ask for, it comes from this one host
+        r->num_sources = 1;
+        memset(&r->source[0], 0, sizeof(struct file_source));
+        r->source[0].src = pkt->src;
+    }
+    r->idle_ticks = 0;
+
+    // Sender offers compression we do not want, ask again without it
+    if ((pkt->payload[PKT_FILE_START_FLAGS] & FILE_FLAG_COMPRESS) && !ctx->compress) {
+        for (k = 0; k < r->num_sources; k++) {
+            if (r->source[k].src == pkt->src) source_resume(ctx, r, k, true);
+        }
+    }
+
+    if (!r->sized) {
+        recv_reset(r, size, file_crc);
+    } else if (r->size != size || r->file_crc != file_crc) {
+        if (r->num_sources == 1) {
+            recv_reset(r, size, file_crc);     // The file changed since the .part was written
+        } else {
+            source_give_up(ctx, r, pkt->src);  // This host has a different file
+            return;
+        }
+    }
+
+    // Skip ahead if the sender starts somewhere other than where we need it
+    for (k = 0; k < r->num_sources; k++) {
+        if (r->source[k].src == pkt->src
+            && next_missing(r, k) != get_u32(pkt->payload + PKT_FILE_START_OFFSET)) {
+            source_resume(ctx, r, k, false);
+        }
+    }
+}
+
+void transfer_recv_chunk(struct transfer_ctx *ctx, struct packet *pkt) {
+    struct file_recv *r = find_recv(ctx, pkt->src, get_u32(pkt->payload + PKT_FILE_ID));
+    char buf[PKT_FILE_BLOCK * 2];
+    uint32_t offset, expected, block, len;
+    uint16_t raw_len;
+    const char *data;
+    bool lz;
+    int k;
+
+    if (r == NULL || !r->sized || pkt->length <= (int) PKT_FILE_CHUNK_DATA) return;
+    r->idle_ticks = 0;
+
+    lz = pkt->type == (char) PKT_FILE_UPLOAD_MIDDLE_LZ;
+    offset = get_u32(pkt->payload + PKT_FILE_OFFSET);
+    if (lz) {
+        if (pkt->length <= (int) PKT_FILE_LZ_DATA) return;
+        memcpy(&raw_len, pkt->payload + PKT_FILE_RAW_LENGTH, sizeof(uint16_t));
+        len = raw_len;
+    } else {
+        len = (uint32_t) pkt->length - PKT_FILE_CHUNK_DATA;
+    }
+    block = offset / PKT_FILE_BLOCK;
+    if (block >= r->num_blocks || offset - block * PKT_FILE_BLOCK + len > block_len(r, block)) return;
+    k = (int) (block % (uint32_t) r->num_sources);
+    expected = block * PKT_FILE_BLOCK + r->fill[block];
+
+    if (offset < expected) {
+        send_ack(ctx, r, pkt->src, offset, k);  // Duplicate, the ack we sent for it may have been lost
+        return;
+    }
+    if (offset > expected) {
+        source_resume(ctx, r, k, false);    // Something in between was lost
+        return;
+    }
+
+    if (lz) {
+        // The compressed data may refer back to the start of this block
+        fflush(r->fp);
+        fseek(r->fp, block * PKT_FILE_BLOCK, SEEK_SET);
+        if (fread(buf, 1, r->fill[block], r->fp) != r->fill[block]
+            || lz_decompress_prefix(pkt->payload + PKT_FILE_LZ_DATA, pkt->length - (int) PKT_FILE_LZ_DATA,
+                                    buf, r->fill[block], r->fill[block] + (int) len) != (int) len) {
+            source_resume(ctx, r, k, false);
+            return;
+        }
+        data = buf + r->fill[block];
+    } else {
+        data = pkt->payload + PKT_FILE_CHUNK_DATA;
+    }
+
+    if (crc32c(data, len) != get_u32(pkt->payload + PKT_FILE_CHUNK_CRC)) {
+        source_resume(ctx, r, k, false);    // Corrupted chunk, go back to the last good byte
+        return;
+    }
+
+    fseek(r->fp, offset, SEEK_SET);
+    if (fwrite(data, 1, len, r->fp) != len) return;
+    metrics_add(&metrics_self()->goodput_bytes, len);
+    r->fill[block] += (uint16_t) len;
+    r->source[k].resume_sent = false;
+    r->source[k].retries = 0;
+    r->retries = 0;
+
+    // Ack every other chunk, transfer_tick() sends one that was held back too long
+    if (++r->source[k].unacked >= TRANSFER_ACK_EVERY || r->fill[block] == block_len(r, block)) {
+        r->source[k].unacked = 0;
+        send_ack(ctx, r, pkt->src, offset, k);
+    } else {
+        r->source[k].ack_offset = offset;
+        r->source[k].ack_ticks = 0;
+    }
+
+    if (r->fill[block] == block_len(r, block)) {
+        r->blocks_done++;
+        if (r->blocks_done == r->num_blocks) {
+            recv_finish(ctx, r);
+        } else if (r->blocks_done - r->blocks_saved >= TRANSFER_MAP_SAVE) {
+            map_save(ctx, r);
+        }
+    }
+}
+
+void transfer_recv_end(struct transfer_ctx *ctx, struct packet *pkt) {
+    struct file_recv *r = find_recv(ctx, pkt->src, get_u32(pkt->payload + PKT_FILE_ID));
+
+    if (r == NULL || !r->sized || pkt->length < (int) PKT_FILE_END_LENGTH) return;
+    r->idle_ticks = 0;
+
+    if (r->blocks_done == r->num_blocks) {
+        recv_finish(ctx, r);
+        return;
+    }
+
+    // Chunks of this sender's stripes went missing, ask for the rest
+    for (int k = 0; r->active && k < r->num_sources; k++) {
+        if (r->source[k].src != pkt->src || next_missing(r, k) == NO_OFFSET) continue;
+        if (++r->source[k].retries > TRANSFER_MAX_RETRIES) {
+            source_give_up(ctx, r, pkt->src);
+        } else {
+            source_resume(ctx, r, k, true);
+        }
+    }
+}
+
+void transfer_tick(struct transfer_ctx *ctx) {
+    struct file_recv *r;
+
+    for (int i = 0; i < MAX_TRANSFERS; i++) {
+        r = &ctx->recv[i];
+        if (!r->active) continue;
+
+        for (int k = 0; k < r->num_sources; k++) {
+            if (r->source[k].unacked > 0 && ++r->source[k].ack_ticks >= TRANSFER_ACK_DELAY) {
+                r->source[k].unacked = 0;
+                send_ack(ctx, r, r->source[k].src, r->source[k].ack_offset, k);
+            }
+        }
+        if (++r->idle_ticks < TRANSFER_IDLE_TICKS) continue;
+
+        r->idle_ticks = 0;
+        map_save(ctx, r);
+        for (int k = 0; r->active && k < r->num_sources; k++) {
+            if (next_missing(r, k) == NO_OFFSET) continue;
+            if (++r->source[k].retries > TRANSFER_MAX_RETRIES) {
+                source_give_up(ctx, r, r->source[k].src);
+            } else {
+                source_resume(ctx, r, k, true);
+            }
+        }
+    }
+}
+
+int transfer_report(struct transfer_ctx *ctx, char *buf, int size) {
+    struct file_send *s;
+    struct file_recv *r;
+    struct file_done *d;
+    int n = 0;
+
+    for (int i = 0; i < MAX_TRANSFERS && n < size; i++) {
+        s = &ctx->send[i];
+        if (!s->active) continue;
+        n += snprintf(buf + n, size - n,
+                      "    Sending %s to host %d: cwnd %.1f, ssthresh %.1f, rtt %u ms (srtt %u, min %u), "
+                      "rto %u ms, %d in flight, %u of %u bytes\n",
+                      s->name, s->dst, s->cwnd, s->ssthresh, s->last_rtt, s->srtt, s->min_rtt, s->rto,
+                      s->flight_count, s->offset, s->size);
+    }
+    for (int i = 0; i < MAX_TRANSFERS && n < size; i++) {
+        r = &ctx->recv[i];
+        if (!r->active) continue;
+        n += snprintf(buf + n, size - n, "    Receiving %s: %u of %u blocks\n",
+                      r->name, r->blocks_done, r->num_blocks);
+    }
+    for (int i = 0; i < TRANSFER_DONE_MAX && n < size; i++) {
+        d = &ctx->done[i];
+        if (!d->used) continue;
+        if (d->outgoing) {
+            n += snprintf(buf + n, size - n, "    %s %s to host %d\n", d->ok ? "Sent" : "Gave up sending", d->name,
+                          d->dst);
+        } else if (d->ok) {
+            n += snprintf(buf + n, size - n, "    Received %s, %u bytes in %.3f ms\n", d->name, d->size, d->us / 1e3);
+        } else {
+            n += snprintf(buf + n, size - n, "    Gave up receiving %s\n", d->name);
+        }
+    }
+    return n < size ? n : size - 1;
+}
@@ -0,0 +1,185 @@
+///////////////////////////////////////////////////////////////////////////////
+///         University of Hawaii, College of Engineering
+/// @brief  Network_simulator_02 - 2024
+///
+/// @file transfer.h
+/// @version 1.0
+///
+/// File transfers between hosts. Every chunk carries the id of its file,
+/// its offset and a CRC32C, and the whole file is checked against a
+/// digest at the end.
+/// The receiver keeps what it has verified in "<name>.part" (progress in
+/// "<name>.part.map") and asks the sender to continue from there with a
+/// ranged PKT_FILE_DOWNLOAD_REQ.
+///
+/// Chunks are LZ compressed when both ends agree to it (FILE_FLAG_COMPRESS)
+/// and the data shrinks enough to carry more than a plain chunk.
+///
+/// A download can be split across several hosts that hold the same file.
+/// Each one is asked for one stripe of PKT_FILE_BLOCK sized blocks and the
+/// blocks are written in place as they arrive.
+///
+/// Senders keep a TCP like congestion window per flow. The receiver
+/// answers every second chunk it accepts, and every duplicate, with a
+/// PKT_FILE_ACK and the sender measures the RTT from it. The window grows by slow
+/// start and then additively, and is halved when a resume request shows
+/// a lost chunk or when the RTT climbs well above the smallest one seen
+/// (a switch queue is building up). A retransmit timeout drops it to one
+/// chunk.
+///
+/// @author Joshua Brewer <brewerj3@hawaii.edu> <joshuabrewer784@gmail.com>
+/// @date   19_Oct_2026
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NETWORK_SIMULATOR_02_TRANSFER_H
+#define NETWORK_SIMULATOR_02_TRANSFER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "main.h"
+#include "host.h"
+
+#define MAX_TRANSFERS           8
+#define MAX_SOURCES             8     /* Hosts one download can be split across */
+#define MAX_PATH_LENGTH         256
+#define TRANSFER_IDLE_TICKS     300   /* Ask to resume after 3 s without data */
+#define TRANSFER_MAX_RETRIES    5
+#define TRANSFER_MAP_SAVE       8     /* Save progress every 8 finished blocks */
+#define TRANSFER_LZ_BACKOFF     8     /* Plain chunks to send after one did not compress */
+#define TRANSFER_DONE_MAX       8     /* Finished transfers the host's state still lists */
+
+#define TRANSFER_MAX_WINDOW     64    /* Chunks in flight per flow */
+#define TRANSFER_INIT_CWND      2
+#define TRANSFER_INIT_SSTHRESH  32
+#define TRANSFER_RTO_INIT       1000  /* ms */
+#define TRANSFER_RTO_MIN        200
+#define TRANSFER_RTO_MAX        8000
+#define TRANSFER_DELAY_TARGET   100   /* Queueing delay in ms above the min RTT that counts as congestion */
+#define TRANSFER_ACK_EVERY      2     /* In order chunks per PKT_FILE_ACK */
+#define TRANSFER_ACK_DELAY      3     /* Host loops an ack may be held back */
+
+// A chunk sent but not acknowledged yet
+struct sent_chunk {
+    uint32_t offset;
+    uint32_t len;
+    uint32_t sent_ms;
+    bool resent;        // No RTT sample from retransmissions
+};
+
+// Outgoing file, read from disk one chunk at a time
+struct file_send {
+    bool active;
+    FILE *fp;
+    int dst;
+    uint32_t id;        // Of the file, in its packets
+    uint32_t size;
+    uint32_t file_crc;
+    uint32_t offset;    // Next byte to send
+    uint32_t end;       // One past the last byte to send
+    int stripe;         // Only send blocks with index % stripes == stripe
+    int stripes;
+    bool compress;      // Receiver accepts PKT_FILE_UPLOAD_MIDDLE_LZ
+    uint32_t lz_raw;    // Raw bytes to try to fit in the next compressed chunk
+    int lz_skip;        // Plain chunks left before trying compression again
+    char name[MAX_NAME_LENGTH];
+
+    // Congestion control
+    struct sent_chunk flight[TRANSFER_MAX_WINDOW];  // Ring of unacknowledged chunks
+    int flight_head;
+    int flight_count;
+    uint32_t high;      // One past the highest byte ever sent
+    double cwnd;        // Chunks
+    double ssthresh;
+    uint32_t srtt;      // ms, 0 until the first sample
+    uint32_t rttvar;
+    uint32_t min_rtt;
+    uint32_t last_rtt;
+    uint32_t rto;
+    uint32_t last_cut_ms;
+    int timeouts;       // Timeouts in a row without progress
+    int cuts;           // Window decreases so far
+};
+
+// One host sending us a stripe of a file
+struct file_source {
+    int src;
+    uint32_t resume_at; // Offset of the last resume request, if any
+    bool resume_sent;
+    int retries;
+    int unacked;        // Chunks received since the last ack
+    uint32_t ack_offset;
+    int ack_ticks;
+};
+
+// Incoming file, written to "<name>.part" until it is complete
+struct file_recv {
+    bool active;
+    FILE *fp;
+    uint32_t id;            // Of the file, its packets carry it
+    bool sized;             // Size and digest known, fill[] allocated
+    uint32_t size;
+    uint32_t file_crc;
+    uint32_t num_blocks;
+    uint16_t *fill;         // Verified bytes from the start of each block
+    uint32_t blocks_done;
+    uint32_t blocks_saved;
+    int num_sources;        // Stripe k comes from source[k]
+    struct file_source source[MAX_SOURCES];
+    int idle_ticks;
+    int retries;
+    uint64_t start_us;      // When it was requested, or its first packet came in
+    char name[MAX_NAME_LENGTH];
+};
+
+// How a transfer ended, kept until the same file is sent or received again
+struct file_done {
+    bool used;
+    bool outgoing;
+    bool ok;            // Sent to the end / received and verified, else given up
+    int dst;            // Of an outgoing one
+    uint32_t size;      // Of a received one, and the us it took
+    uint64_t us;
+    char name[MAX_NAME_LENGTH];
+};
+
+struct transfer_ctx {
+    int host_id;
+    char *dir;
+    bool *dir_valid;
+    struct job_queue *job_q;
+    bool compress;      // Offer and accept compressed chunks
+    struct file_send send[MAX_TRANSFERS];
+    struct file_recv recv[MAX_TRANSFERS];
+    struct file_done done[TRANSFER_DONE_MAX];
+    int done_next;      // Oldest entry, the next to reuse
+};
+
+void transfer_init(struct transfer_ctx *ctx, int host_id, char *dir, bool *dir_valid, struct job_queue *job_q);
+
+// Start sending one stripe of bytes [offset, offset + length), length 0 means to the end; false if it cannot be sent
+bool transfer_start_send(struct transfer_ctx *ctx, int dst, const char *name, uint32_t offset, uint32_t length,
+                         int stripe, int stripes, int flags);
+
+// Send the next chunk of the transfer owned by job, re-queue the job until done
+void transfer_send_chunk(struct transfer_ctx *ctx, struct host_job *job);
+
+// Ask one or more hosts for a file, resuming from "<name>.part" if one is on disk; false if it cannot be received
+bool transfer_request(struct transfer_ctx *ctx, const int src[], int num_src, const char *name);
+
+// Handlers for incoming transfer packets
+void transfer_recv_start(struct transfer_ctx *ctx, struct packet *pkt);
+void transfer_recv_chunk(struct transfer_ctx *ctx, struct packet *pkt);
+void transfer_recv_end(struct transfer_ctx *ctx, struct packet *pkt);
+
+// Sender side handler for PKT_FILE_ACK, called as soon as the packet arrives
+void transfer_recv_ack(struct transfer_ctx *ctx, struct packet *pkt);
+
+// Called once per host loop to notice stalled receives
+void transfer_tick(struct transfer_ctx *ctx);
+
+// One line per transfer in progress (cwnd and RTT of each outgoing flow) and per recent end
+// ("Sent", "Gave up sending", "Received" with its size and time, "Gave up receiving"), returns the length written
+int transfer_report(struct transfer_ctx *ctx, char *buf, int size);
+
+#endif //NETWORK_SIMULATOR_02_TRANSFER_H